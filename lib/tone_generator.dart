@@ -1,4 +1,5 @@
 import 'dart:async';
+import 'dart:typed_data';
 import 'package:flutter/services.dart';
 import 'package:riverpod_annotation/riverpod_annotation.dart';
 
@@ -9,10 +10,238 @@ ToneGenerator toneGenerator(ToneGeneratorRef ref) {
   return ToneGenerator(const MethodChannel('ahts4962.com/binaural_beats/tone_generator'));
 }
 
+/// Waveforms of the tones.
+///
+/// The index of each value is sent to the platform, so the order must match the native code.
+enum Waveform { sine, square, triangle, sawtooth }
+
+/// Ways a value moves over a segment of a [TimelineTrack].
+///
+/// The index of each value is sent to the platform, so the order must match the native code.
+enum SegmentShape {
+  /// The value does not change.
+  hold,
+
+  /// The value changes linearly.
+  linear,
+
+  /// The value changes by a constant ratio per second. Both ends must be positive.
+  exponential,
+}
+
+/// Scheduling of the audio rendering thread.
+///
+/// The index of each value is received from the platform, so the order must match the native code.
+enum SchedulingClass {
+  /// The scheduling is unchanged.
+  normal,
+
+  /// The priority is raised within the normal scheduling.
+  elevatedPriority,
+
+  /// The "Pro Audio" task of the Multimedia Class Scheduler Service (Windows).
+  mmcss,
+
+  /// `SCHED_FIFO` (Linux).
+  fifo,
+
+  /// `SCHED_RR` (Linux).
+  roundRobin,
+}
+
+/// A segment of a [TimelineTrack].
+class TimelineSegment {
+  /// Length of the segment in seconds.
+  final double duration;
+
+  /// How the value moves to [endValue].
+  final SegmentShape shape;
+
+  /// Value at the end of the segment. Ignored by [SegmentShape.hold].
+  final double endValue;
+
+  const TimelineSegment(this.duration, this.shape, [this.endValue = 0]);
+}
+
+/// The program of a value: a start value followed by segments.
+///
+/// After the last segment, the value stays at the end value of the segment.
+class TimelineTrack {
+  final double startValue;
+  final List<TimelineSegment> segments;
+
+  const TimelineTrack(this.startValue, [this.segments = const []]);
+
+  Float64List _encode() => Float64List.fromList([
+        startValue,
+        for (final segment in segments) ...[
+          segment.duration,
+          segment.shape.index.toDouble(),
+          segment.endValue,
+        ],
+      ]);
+}
+
+/// The progress of a timeline in seconds.
+class TimelineProgress {
+  final double position;
+  final double duration;
+
+  const TimelineProgress(this.position, this.duration);
+
+  /// Whether the timeline has reached its end.
+  bool get isFinished => position >= duration;
+}
+
+/// The arguments of the wave parameters sent to the platform.
+Map<String, Object> _waveParameters(double binauralBeatsFrequency, double baseFrequency,
+    double leftVolume, double rightVolume, Waveform leftWaveform, Waveform rightWaveform) {
+  double leftFrequency = (baseFrequency - binauralBeatsFrequency / 2).ceilToDouble();
+  double rightFrequency = (baseFrequency + binauralBeatsFrequency / 2).ceilToDouble();
+  assert(leftFrequency < 22050 && rightFrequency < 22050);
+
+  if (leftFrequency < 1) {
+    leftFrequency = 1;
+  }
+  if (rightFrequency < 1) {
+    rightFrequency = 1;
+  }
+
+  return <String, Object>{
+    'leftFrequency': leftFrequency,
+    'rightFrequency': rightFrequency,
+    'leftVolume': leftVolume,
+    'rightVolume': rightVolume,
+    'leftWaveform': leftWaveform.index,
+    'rightWaveform': rightWaveform.index,
+  };
+}
+
+/// A change of the binaural beats scheduled by [ToneGenerator.scheduleCommands].
+///
+/// The type is sent as the index of `ToneCommand::Type` of the native code.
+class ToneCommand {
+  final Map<String, Object> _arguments;
+
+  /// Sets the parameters as [ToneGenerator.setParameters] does.
+  ToneCommand.setParameters(
+      double binauralBeatsFrequency, double baseFrequency, double leftVolume, double rightVolume,
+      {Waveform leftWaveform = Waveform.sine, Waveform rightWaveform = Waveform.sine})
+      : _arguments = {
+          'type': 0,
+          ..._waveParameters(binauralBeatsFrequency, baseFrequency, leftVolume, rightVolume,
+              leftWaveform, rightWaveform),
+        };
+
+  /// Sets the volumes of the noise as [ToneGenerator.setNoiseParameters] does.
+  ToneCommand.setNoiseParameters(
+      double whiteNoiseVolume, double pinkNoiseVolume, double brownNoiseVolume)
+      : _arguments = {
+          'type': 1,
+          'whiteNoiseVolume': whiteNoiseVolume,
+          'pinkNoiseVolume': pinkNoiseVolume,
+          'brownNoiseVolume': brownNoiseVolume,
+        };
+
+  /// Starts playing the binaural beats.
+  ToneCommand.start() : _arguments = {'type': 2};
+
+  /// Stops playing the binaural beats.
+  ToneCommand.stop() : _arguments = {'type': 3};
+}
+
+/// The state of the binaural beats actually being played.
+class LiveParameters {
+  /// Volumes and frequencies of the next sample. They follow [ToneGenerator.setParameters]
+  /// smoothly, or the timeline.
+  final double leftVolume;
+  final double rightVolume;
+  final double leftFrequency;
+  final double rightFrequency;
+  final Waveform leftWaveform;
+  final Waveform rightWaveform;
+  final double whiteNoiseVolume;
+  final double pinkNoiseVolume;
+  final double brownNoiseVolume;
+
+  /// Whether the audio device is playing.
+  final bool isPlaying;
+
+  /// Samples written to the audio devices so far, and the current sample rate in Hz.
+  ///
+  /// [ToneGenerator.scheduleCommands] can schedule commands at a stream position.
+  final int streamPosition;
+  final double samplesPerSecond;
+
+  /// Whether a timeline is running, and its progress in seconds.
+  final bool timelineRunning;
+  final TimelineProgress timelineProgress;
+
+  /// The number of the progress reports of the timelines so far, and the progress of the last
+  /// report. A report is made about every second while a timeline is played, and once when it
+  /// ends or is stopped.
+  final int timelineReports;
+  final TimelineProgress reportedTimelineProgress;
+
+  /// The scheduling that the audio rendering thread has obtained, whether its CPU affinity has
+  /// been applied, and whether it flushes denormal floats to zero.
+  final SchedulingClass schedulingClass;
+  final bool affinityApplied;
+  final bool denormalsFlushed;
+
+  /// The render-ahead ring in samples: its capacity, the samples in it after the last device
+  /// event, and the samples the device asked for but the ring lacked. All 0 if it is not used.
+  final int renderAheadDepth;
+  final int renderAheadFill;
+  final int producerLateFrames;
+
+  /// The latency of the audio stream in milliseconds, whether it follows the load of the system
+  /// (see [ToneGenerator.setAdaptiveLatency]), and the times the audio buffer has run empty.
+  final int latency;
+  final bool adaptiveLatency;
+  final int underruns;
+
+  LiveParameters._fromMap(Map<Object?, Object?> map)
+      : leftVolume = map['leftVolume'] as double,
+        rightVolume = map['rightVolume'] as double,
+        leftFrequency = map['leftFrequency'] as double,
+        rightFrequency = map['rightFrequency'] as double,
+        leftWaveform = Waveform.values[map['leftWaveform'] as int],
+        rightWaveform = Waveform.values[map['rightWaveform'] as int],
+        whiteNoiseVolume = map['whiteNoiseVolume'] as double,
+        pinkNoiseVolume = map['pinkNoiseVolume'] as double,
+        brownNoiseVolume = map['brownNoiseVolume'] as double,
+        isPlaying = map['isPlaying'] as bool,
+        streamPosition = map['streamPosition'] as int,
+        samplesPerSecond = map['samplesPerSecond'] as double,
+        timelineRunning = map['timelineRunning'] as bool,
+        timelineProgress = TimelineProgress(
+            map['timelinePosition'] as double, map['timelineDuration'] as double),
+        timelineReports = map['timelineReports'] as int,
+        reportedTimelineProgress = TimelineProgress(map['reportedTimelinePosition'] as double,
+            map['reportedTimelineDuration'] as double),
+        schedulingClass = SchedulingClass.values[map['schedulingClass'] as int],
+        affinityApplied = map['affinityApplied'] as bool,
+        denormalsFlushed = map['denormalsFlushed'] as bool,
+        renderAheadDepth = map['renderAheadDepth'] as int,
+        renderAheadFill = map['renderAheadFill'] as int,
+        producerLateFrames = map['producerLateFrames'] as int,
+        latency = map['latency'] as int,
+        adaptiveLatency = map['adaptiveLatency'] as bool,
+        underruns = map['underruns'] as int;
+}
+
 /// A class that generates and plays binaural beats.
 class ToneGenerator {
+  /// Interval of polling the platform for the progress of the timeline.
+  static const progressPollingInterval = Duration(milliseconds: 250);
+
   final MethodChannel _methodChannel;
   final StreamController<String> _errorStreamController = StreamController<String>.broadcast();
+  final StreamController<TimelineProgress> _timelineProgressStreamController =
+      StreamController<TimelineProgress>.broadcast();
+  Timer? _progressTimer;
+  int? _timelineReports; // [LiveParameters.timelineReports] polled last.
 
   /// Creates a new ToneGenerator.
   ///
@@ -29,44 +258,249 @@ class ToneGenerator {
           throw MissingPluginException();
       }
     });
+    _timelineProgressStreamController.onListen = _startProgressPolling;
+    _timelineProgressStreamController.onCancel = _stopProgressPolling;
+  }
+
+  void _startProgressPolling() {
+    _timelineReports = null;
+    _progressTimer = Timer.periodic(progressPollingInterval, (_) => _pollProgress());
+    _pollProgress();
+  }
+
+  void _stopProgressPolling() {
+    _progressTimer?.cancel();
+    _progressTimer = null;
+  }
+
+  /// Emits the last progress report of the platform if it is new.
+  Future<void> _pollProgress() async {
+    final LiveParameters live;
+    try {
+      live = await getLiveParameters();
+    } on PlatformException catch (e) {
+      _stopProgressPolling();
+      _errorStreamController.add('Error in ToneGenerator.timelineProgressStream: ${e.message}');
+      return;
+    }
+    if (_progressTimer == null) {
+      return;
+    }
+    final reports = _timelineReports;
+    _timelineReports = live.timelineReports;
+    if (reports != null && live.timelineReports != reports) {
+      _timelineProgressStreamController.add(live.reportedTimelineProgress);
+    }
   }
 
   /// A stream that emits error messages.
   Stream<String> get errorStream => _errorStreamController.stream;
 
+  /// A stream that emits the progress of the timeline about every second while it is played,
+  /// and once when it ends or is stopped.
+  ///
+  /// The platform is polled every [progressPollingInterval] while the stream has listeners, so
+  /// that the audio rendering thread does not call back into the app. The reports made within an
+  /// interval are merged into the last one.
+  Stream<TimelineProgress> get timelineProgressStream => _timelineProgressStreamController.stream;
+
   /// Sets the parameters of the binaural beats.
   ///
   /// [binauralBeatsFrequency] and [baseFrequency] are in Hz and must be greater than 0.
   /// The actual frequencies reproduced will be approximately [baseFrequency] ±
   /// [binauralBeatsFrequency]/2, and these must be less than 22.05 kHz.
   /// [leftVolume] and [rightVolume] must be between 0 and 1.
-  Future<void> setParameters(double binauralBeatsFrequency, double baseFrequency, double leftVolume,
-      double rightVolume) async {
+  /// [leftWaveform] and [rightWaveform] select the waveforms of the channels.
+  Future<void> setParameters(
+      double binauralBeatsFrequency, double baseFrequency, double leftVolume, double rightVolume,
+      {Waveform leftWaveform = Waveform.sine, Waveform rightWaveform = Waveform.sine}) async {
     assert(binauralBeatsFrequency > 0);
     assert(baseFrequency > 0);
     assert(leftVolume >= 0 && leftVolume <= 1);
     assert(rightVolume >= 0 && rightVolume <= 1);
 
     try {
-      double leftFrequency = (baseFrequency - binauralBeatsFrequency / 2).ceilToDouble();
-      double rightFrequency = (baseFrequency + binauralBeatsFrequency / 2).ceilToDouble();
-      assert(leftFrequency < 22050 && rightFrequency < 22050);
+      await _methodChannel.invokeMethod<void>(
+          'setWaveParameters',
+          _waveParameters(binauralBeatsFrequency, baseFrequency, leftVolume, rightVolume,
+              leftWaveform, rightWaveform));
+    } on PlatformException catch (e) {
+      _errorStreamController.add('Error in ToneGenerator.setParameters: ${e.message}');
+    }
+  }
+
+  /// Sets the volumes of the noise beds played under the binaural beats.
+  ///
+  /// [whiteNoiseVolume], [pinkNoiseVolume] and [brownNoiseVolume] must be between 0 and 1.
+  /// 0 disables the noise. The noise is played and stopped together with the binaural beats.
+  Future<void> setNoiseParameters(
+      double whiteNoiseVolume, double pinkNoiseVolume, double brownNoiseVolume) async {
+    assert(whiteNoiseVolume >= 0 && whiteNoiseVolume <= 1);
+    assert(pinkNoiseVolume >= 0 && pinkNoiseVolume <= 1);
+    assert(brownNoiseVolume >= 0 && brownNoiseVolume <= 1);
+
+    try {
+      await _methodChannel.invokeMethod<void>('setNoiseParameters', <String, double>{
+        'whiteNoiseVolume': whiteNoiseVolume,
+        'pinkNoiseVolume': pinkNoiseVolume,
+        'brownNoiseVolume': brownNoiseVolume,
+      });
+    } on PlatformException catch (e) {
+      _errorStreamController.add('Error in ToneGenerator.setNoiseParameters: ${e.message}');
+    }
+  }
 
-      if (leftFrequency < 1) {
-        leftFrequency = 1;
-      }
-      if (rightFrequency < 1) {
-        rightFrequency = 1;
-      }
+  /// Sets the gains from the left and right channels to the speakers of a multichannel device.
+  ///
+  /// [leftGains] and [rightGains] are indexed by the speaker position of the channel mask of the
+  /// device: 0 is the front left, 1 the front right, 2 the front center, 3 the LFE, 4 the back
+  /// left, 5 the back right, 9 the side left, and 10 the side right (up to 18 positions). They
+  /// must have the same length, and the gains must be between 0 and 1. For example,
+  /// `[1, 0, 0, 0, 1, 0]` and `[0, 1, 0, 0, 0, 1]` play the binaural beats on both the front and
+  /// the back pairs. Positions that the device does not have are ignored. Empty lists restore the
+  /// default, which plays on the first two channels only.
+  Future<void> setChannelRouting(List<double> leftGains, List<double> rightGains) async {
+    assert(leftGains.length == rightGains.length && leftGains.length <= 18);
+    assert([...leftGains, ...rightGains].every((gain) => gain >= 0 && gain <= 1));
 
-      await _methodChannel.invokeMethod<void>('setWaveParameters', <String, double>{
-        'leftFrequency': leftFrequency,
-        'rightFrequency': rightFrequency,
-        'leftVolume': leftVolume,
-        'rightVolume': rightVolume,
+    try {
+      await _methodChannel.invokeMethod<void>('setChannelRouting', <String, Float64List>{
+        'leftGains': Float64List.fromList(leftGains),
+        'rightGains': Float64List.fromList(rightGains),
       });
     } on PlatformException catch (e) {
-      _errorStreamController.add('Error in ToneGenerator.setParameters: ${e.message}');
+      _errorStreamController.add('Error in ToneGenerator.setChannelRouting: ${e.message}');
+    }
+  }
+
+  /// Sets the tone pair [index] (0-7), a pair of sine waves played with the binaural beats.
+  ///
+  /// The frequencies are derived from [binauralBeatsFrequency] and [baseFrequency] as in
+  /// [setParameters], and [volume] must be between 0 and 1. A volume of 0 turns the pair off.
+  /// Each pair has its own phases. Without gains, the pair is added to the left and right
+  /// channels of the binaural beats, e.g., a theta layer under a delta tone. With [leftGains]
+  /// and [rightGains], which are indexed by the speaker position as in [setChannelRouting], the
+  /// pair is played on its own speakers, so that one multichannel device can play up to 8
+  /// independent stereo pairs besides the binaural beats. A pair starts and stops at the zero
+  /// crossings of its waves, and stops with the binaural beats.
+  Future<void> setTonePair(int index, double binauralBeatsFrequency, double baseFrequency,
+      double volume,
+      {List<double> leftGains = const [], List<double> rightGains = const []}) async {
+    assert(index >= 0 && index < 8);
+    assert(binauralBeatsFrequency > 0);
+    assert(baseFrequency > 0);
+    assert(volume >= 0 && volume <= 1);
+    assert(leftGains.length == rightGains.length && leftGains.length <= 18);
+    assert([...leftGains, ...rightGains].every((gain) => gain >= 0 && gain <= 1));
+
+    final waveParameters = _waveParameters(
+        binauralBeatsFrequency, baseFrequency, volume, volume, Waveform.sine, Waveform.sine);
+    try {
+      await _methodChannel.invokeMethod<void>('setTonePair', <String, Object>{
+        'index': index,
+        'volume': volume,
+        'leftFrequency': waveParameters['leftFrequency']!,
+        'rightFrequency': waveParameters['rightFrequency']!,
+        'leftGains': Float64List.fromList(leftGains),
+        'rightGains': Float64List.fromList(rightGains),
+      });
+    } on PlatformException catch (e) {
+      _errorStreamController.add('Error in ToneGenerator.setTonePair: ${e.message}');
+    }
+  }
+
+  /// Sets the latency of the audio stream in milliseconds (1-2000), and stops adapting it.
+  ///
+  /// The stream is re-created at once. While playing, the audio continues without a gap.
+  Future<void> setLatency(int latency) async {
+    assert(latency >= 1 && latency <= 2000);
+
+    try {
+      await _methodChannel.invokeMethod<void>('setLatency', <String, int>{'latency': latency});
+    } on PlatformException catch (e) {
+      _errorStreamController.add('Error in ToneGenerator.setLatency: ${e.message}');
+    }
+  }
+
+  /// Lets the latency of the audio stream follow the load of the system.
+  ///
+  /// The latency starts from [minLatency] milliseconds. It is widened when the audio buffer runs
+  /// low, up to [maxLatency], and narrowed again after a calm period. A latency that has failed
+  /// is retried less often. [setLatency] turns this off.
+  Future<void> setAdaptiveLatency({int minLatency = 20, int maxLatency = 200}) async {
+    assert(minLatency >= 1 && minLatency <= maxLatency && maxLatency <= 2000);
+
+    try {
+      await _methodChannel.invokeMethod<void>('setAdaptiveLatency', <String, int>{
+        'minLatency': minLatency,
+        'maxLatency': maxLatency,
+      });
+    } on PlatformException catch (e) {
+      _errorStreamController.add('Error in ToneGenerator.setAdaptiveLatency: ${e.message}');
+    }
+  }
+
+  /// Sets a timeline of the volumes and the frequencies, and starts it.
+  ///
+  /// The volumes must be between 0 and 1, and the frequencies in Hz must be greater than 0, e.g.,
+  /// a beat that sweeps from 14 Hz to 4 Hz over 30 minutes on a 200 Hz carrier:
+  ///
+  /// ```dart
+  /// const volume = TimelineTrack(0.5);
+  /// toneGenerator.setTimeline(volume, volume, const TimelineTrack(193),
+  ///     const TimelineTrack(207, [TimelineSegment(1800, SegmentShape.linear, 202)]));
+  /// ```
+  ///
+  /// The changes are sample accurate, and the phases of the sweeps do not drift. The timeline
+  /// advances only while the binaural beats are played. When it ends, the last values are kept.
+  /// [setParameters] and [stopTimeline] stop the timeline.
+  Future<void> setTimeline(TimelineTrack leftVolume, TimelineTrack rightVolume,
+      TimelineTrack leftFrequency, TimelineTrack rightFrequency) async {
+    try {
+      await _methodChannel.invokeMethod<void>('setTimeline', <String, Float64List>{
+        'leftVolume': leftVolume._encode(),
+        'rightVolume': rightVolume._encode(),
+        'leftFrequency': leftFrequency._encode(),
+        'rightFrequency': rightFrequency._encode(),
+      });
+    } on PlatformException catch (e) {
+      _errorStreamController.add('Error in ToneGenerator.setTimeline: ${e.message}');
+    }
+  }
+
+  /// Stops the timeline. The volumes and the frequencies ramp to the values of [setParameters].
+  Future<void> stopTimeline() async {
+    try {
+      await _methodChannel.invokeMethod<void>('stopTimeline');
+    } on PlatformException catch (e) {
+      _errorStreamController.add('Error in ToneGenerator.stopTimeline: ${e.message}');
+    }
+  }
+
+  /// Schedules a batch of commands that are applied together at the exact sample.
+  ///
+  /// The commands are applied after [delay], or at [streamPosition] if it is given (see
+  /// [LiveParameters.streamPosition]). For example, the following changes the beat exactly two
+  /// seconds later:
+  ///
+  /// ```dart
+  /// toneGenerator.scheduleCommands([ToneCommand.setParameters(4, 200, 0.5, 0.5)],
+  ///     delay: const Duration(seconds: 2));
+  /// ```
+  ///
+  /// Up to 256 commands can be waiting at once.
+  Future<void> scheduleCommands(List<ToneCommand> commands,
+      {Duration delay = Duration.zero, int? streamPosition}) async {
+    try {
+      await _methodChannel.invokeMethod<void>('scheduleCommands', <String, Object>{
+        'commands': [for (final command in commands) command._arguments],
+        if (streamPosition != null)
+          'streamPosition': streamPosition
+        else
+          'delay': delay.inMicroseconds / Duration.microsecondsPerSecond,
+      });
+    } on PlatformException catch (e) {
+      _errorStreamController.add('Error in ToneGenerator.scheduleCommands: ${e.message}');
     }
   }
 
@@ -88,6 +522,18 @@ class ToneGenerator {
     }
   }
 
+  /// Gets the state of the binaural beats actually being played.
+  ///
+  /// Throws a [PlatformException] if the method call fails.
+  Future<LiveParameters> getLiveParameters() async {
+    final map = await _methodChannel.invokeMethod<Map<Object?, Object?>>('getLiveParameters');
+    if (map == null) {
+      throw PlatformException(code: 'Error in ToneGenerator.getLiveParameters');
+    } else {
+      return LiveParameters._fromMap(map);
+    }
+  }
+
   /// Gets the current audio device information.
   ///
   /// Throws a [PlatformException] if the method call fails.
@@ -0,0 +1,141 @@
+import 'dart:typed_data';
+
+import 'package:binaural_beats/tone_generator.dart';
+import 'package:fake_async/fake_async.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+const channel = MethodChannel('ahts4962.com/binaural_beats/tone_generator');
+
+/// The map of the live parameters returned by the platform.
+Map<String, Object> liveParameters(
+    {int timelineReports = 0,
+    double reportedTimelinePosition = 0,
+    double reportedTimelineDuration = 0}) {
+  return {
+    'leftVolume': 0.5,
+    'rightVolume': 0.5,
+    'leftFrequency': 193.0,
+    'rightFrequency': 207.0,
+    'leftWaveform': 0,
+    'rightWaveform': 0,
+    'whiteNoiseVolume': 0.0,
+    'pinkNoiseVolume': 0.0,
+    'brownNoiseVolume': 0.0,
+    'isPlaying': true,
+    'streamPosition': 0,
+    'samplesPerSecond': 48000.0,
+    'timelineRunning': true,
+    'timelinePosition': reportedTimelinePosition,
+    'timelineDuration': reportedTimelineDuration,
+    'timelineReports': timelineReports,
+    'reportedTimelinePosition': reportedTimelinePosition,
+    'reportedTimelineDuration': reportedTimelineDuration,
+    'schedulingClass': 0,
+    'affinityApplied': false,
+    'denormalsFlushed': true,
+    'renderAheadDepth': 0,
+    'renderAheadFill': 0,
+    'producerLateFrames': 0,
+    'latency': 100,
+    'adaptiveLatency': false,
+    'underruns': 0,
+  };
+}
+
+void main() {
+  TestWidgetsFlutterBinding.ensureInitialized();
+
+  group('ToneGenerator', () {
+    final List<MethodCall> calls = [];
+    late Future<Object?>? Function(MethodCall) handler;
+
+    setUp(() {
+      calls.clear();
+      handler = (_) async => null;
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+          .setMockMethodCallHandler(channel, (call) {
+        calls.add(call);
+        return handler(call);
+      });
+    });
+
+    tearDown(() {
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+          .setMockMethodCallHandler(channel, null);
+    });
+
+    test('setTimeline', () {
+      fakeAsync((async) {
+        final toneGenerator = ToneGenerator(channel);
+        const volume = TimelineTrack(0.5);
+        toneGenerator.setTimeline(volume, volume, const TimelineTrack(193),
+            const TimelineTrack(207, [TimelineSegment(1800, SegmentShape.linear, 202)]));
+        async.flushMicrotasks();
+        expect(calls.length, 1);
+        expect(calls[0].method, 'setTimeline');
+        final arguments = calls[0].arguments as Map<Object?, Object?>;
+        expect(arguments['leftVolume'], Float64List.fromList([0.5]));
+        expect(arguments['leftFrequency'], Float64List.fromList([193]));
+        expect(arguments['rightFrequency'], Float64List.fromList([207, 1800, 1, 202]));
+      });
+    });
+
+    test('timelineProgressStream polls only while it is listened to', () {
+      fakeAsync((async) {
+        handler = (_) async => liveParameters();
+        final toneGenerator = ToneGenerator(channel);
+        async.elapse(const Duration(seconds: 1));
+        expect(calls, isEmpty);
+
+        final subscription = toneGenerator.timelineProgressStream.listen((_) {});
+        async.elapse(ToneGenerator.progressPollingInterval * 4);
+        expect(calls.length, 5);
+        expect(calls.every((call) => call.method == 'getLiveParameters'), true);
+
+        subscription.cancel();
+        calls.clear();
+        async.elapse(const Duration(seconds: 1));
+        expect(calls, isEmpty);
+      });
+    });
+
+    test('timelineProgressStream emits new reports', () {
+      fakeAsync((async) {
+        var live = liveParameters(
+            timelineReports: 3, reportedTimelinePosition: 9, reportedTimelineDuration: 10);
+        handler = (_) async => live;
+        final toneGenerator = ToneGenerator(channel);
+        final List<TimelineProgress> progress = [];
+        final subscription = toneGenerator.timelineProgressStream.listen(progress.add);
+
+        // The report made before the stream was listened to is not emitted.
+        async.elapse(ToneGenerator.progressPollingInterval * 2);
+        expect(progress, isEmpty);
+
+        live = liveParameters(
+            timelineReports: 4, reportedTimelinePosition: 10, reportedTimelineDuration: 10);
+        async.elapse(ToneGenerator.progressPollingInterval * 2);
+        expect(progress.length, 1);
+        expect(progress[0].position, 10);
+        expect(progress[0].duration, 10);
+        expect(progress[0].isFinished, true);
+        subscription.cancel();
+      });
+    });
+
+    test('timelineProgressStream reports an error and stops polling', () {
+      fakeAsync((async) {
+        handler = (_) async => throw PlatformException(code: 'Runtime error', message: 'Failed');
+        final toneGenerator = ToneGenerator(channel);
+        final List<String> errors = [];
+        toneGenerator.errorStream.listen(errors.add);
+        final subscription = toneGenerator.timelineProgressStream.listen((_) {});
+        async.elapse(ToneGenerator.progressPollingInterval * 4);
+        expect(calls.length, 1);
+        expect(errors, ['Error in ToneGenerator.timelineProgressStream: Failed']);
+        subscription.cancel();
+      });
+    });
+  });
+}
@@ -0,0 +1,271 @@
+/**
+ * @file dsp.cpp
+ * @brief Vectorized operations on blocks of samples.
+ */
+
+#include "dsp.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "simd.h"
+
+// Constants.
+constexpr unsigned int NOISE_BLOCK_FRAMES = 64;  // Number of frames of noise generated at once.
+constexpr unsigned int NOISE_FILTERS = 4;        // Number of filters in `NoiseState::filters`.
+
+// Coefficients of the noise filters `y[n] = pole * y[n - 1] + gain * x[n]`, where `x` is the white
+// noise in [-1, 1). The first three are the pink filter, and the last one is the brown integrator.
+constexpr float NOISE_POLES[NOISE_FILTERS] = {0.99765f, 0.96300f, 0.57000f, 0.995f};
+constexpr float NOISE_GAINS[NOISE_FILTERS] = {0.0990460f, 0.2965164f, 1.0526913f, 1.0f};
+constexpr float PINK_DIRECT_GAIN = 0.1848f;  // Gain of the white noise added to the pink noise.
+
+// Scales that make the RMS of each noise 0.25.
+constexpr float WHITE_NOISE_SCALE = 0.4330f;
+constexpr float PINK_NOISE_SCALE = 0.1453f;
+constexpr float BROWN_NOISE_SCALE = 0.04321f;
+
+void apply_gain_ramp(float *values, unsigned int frames_count, float gain, float gain_step) {
+  alignas(32) float offsets[simd::width];
+  for (unsigned int k = 0; k < simd::width; ++k) {
+    offsets[k] = static_cast<float>(k) * gain_step;
+  }
+  const simd::Float lane_offsets = simd::load(offsets);
+
+  unsigned int i = 0;
+  for (; i + simd::width <= frames_count; i += simd::width) {
+    // The gain is computed from the index, not accumulated, so the ramp ends exactly.
+    const simd::Float gains = simd::set1(gain + static_cast<float>(i) * gain_step) + lane_offsets;
+    simd::store(values + i, simd::load(values + i) * gains);
+  }
+  for (; i < frames_count; ++i) {
+    values[i] *= gain + static_cast<float>(i) * gain_step;
+  }
+}
+
+void mix_channels(const float *left, const float *right, float *output, unsigned int frames_count,
+                  float left_gain, float right_gain) {
+  const simd::Float left_gains = simd::set1(left_gain);
+  const simd::Float right_gains = simd::set1(right_gain);
+
+  unsigned int i = 0;
+  for (; i + simd::width <= frames_count; i += simd::width) {
+    simd::store(output + i,
+                simd::load(left + i) * left_gains + simd::load(right + i) * right_gains);
+  }
+  for (; i < frames_count; ++i) {
+    output[i] = left[i] * left_gain + right[i] * right_gain;
+  }
+}
+
+void add_channels(const float *left, const float *right, float *output, unsigned int frames_count,
+                  float left_gain, float right_gain) {
+  const simd::Float left_gains = simd::set1(left_gain);
+  const simd::Float right_gains = simd::set1(right_gain);
+
+  unsigned int i = 0;
+  for (; i + simd::width <= frames_count; i += simd::width) {
+    simd::store(output + i, simd::load(output + i) + simd::load(left + i) * left_gains +
+                                simd::load(right + i) * right_gains);
+  }
+  for (; i < frames_count; ++i) {
+    output[i] += left[i] * left_gain + right[i] * right_gain;
+  }
+}
+
+namespace {
+
+/**
+ * @brief Advances the xorshift32 generators and returns uniform random numbers in [0, 1).
+ */
+simd::Float next_uniform(simd::UInt &seeds) {
+  seeds = seeds ^ simd::shift_left<13>(seeds);
+  seeds = seeds ^ simd::shift_right<17>(seeds);
+  seeds = seeds ^ simd::shift_left<5>(seeds);
+  // Put the upper 23 bits in the mantissa of a float in [1, 2).
+  return simd::as_float(simd::shift_right<9>(seeds) | simd::set1(0x3f800000u)) - simd::set1(1.0f);
+}
+
+/**
+ * @brief Seeds the xorshift32 generators of the lanes.
+ */
+void seed_generators(std::uint32_t (&seeds)[8], std::uint32_t seed) {
+  for (std::uint32_t &lane_seed : seeds) {
+    // xorshift32 must not be seeded with 0.
+    seed = seed * 1664525u + 1013904223u;
+    lane_seed = seed != 0 ? seed : 1;
+  }
+}
+
+/**
+ * @brief Implementation of `add_noise` for `NOISE_BLOCK_FRAMES` frames or less.
+ */
+void add_noise_block(float *values, unsigned int frames_count, float white_gain, float pink_gain,
+                     float brown_gain, NoiseState &state) {
+  static_assert(simd::width <= sizeof(state.seeds) / sizeof(state.seeds[0]));
+
+  // Lane `j` computes the segment of the frames `j * length` to `j * length + length - 1`. The
+  // arrays below hold the frame `t` of the segments in `[t * simd::width, (t + 1) * simd::width)`.
+  const unsigned int length = (frames_count + simd::width - 1) / simd::width;
+  alignas(32) float white[NOISE_BLOCK_FRAMES];
+  alignas(32) float responses[NOISE_FILTERS][NOISE_BLOCK_FRAMES];
+  simd::UInt seeds = simd::load(state.seeds);
+  simd::Float filters[NOISE_FILTERS];
+  for (simd::Float &filter : filters) {
+    filter = simd::set1(0.0f);
+  }
+  for (unsigned int t = 0; t < length; ++t) {
+    const simd::Float x = next_uniform(seeds) * simd::set1(2.0f) - simd::set1(1.0f);
+    simd::store(white + t * simd::width, x);
+    for (unsigned int k = 0; k < NOISE_FILTERS; ++k) {
+      filters[k] = filters[k] * simd::set1(NOISE_POLES[k]) + x * simd::set1(NOISE_GAINS[k]);
+      simd::store(responses[k] + t * simd::width, filters[k]);
+    }
+  }
+  simd::store(state.seeds, seeds);
+
+  // `decays[k][t]` is the response of the filter `k` at the frame `t` to its state of 1.0 before
+  // the segment. The state before each segment is the state before the previous segment decayed
+  // over the segment plus the response within it.
+  float decays[NOISE_FILTERS][NOISE_BLOCK_FRAMES];
+  alignas(32) float initial_states[NOISE_FILTERS][simd::width];
+  const unsigned int last = frames_count - 1;
+  for (unsigned int k = 0; k < NOISE_FILTERS; ++k) {
+    float decay = 1.0f;
+    for (unsigned int t = 0; t < length; ++t) {
+      decay *= NOISE_POLES[k];
+      decays[k][t] = decay;
+    }
+    initial_states[k][0] = state.filters[k];
+    for (unsigned int j = 1; j < simd::width; ++j) {
+      initial_states[k][j] = responses[k][(length - 1) * simd::width + j - 1] +
+                             decays[k][length - 1] * initial_states[k][j - 1];
+    }
+    const unsigned int last_t = last % length;
+    const unsigned int last_j = last / length;
+    state.filters[k] = responses[k][last_t * simd::width + last_j] +
+                       decays[k][last_t] * initial_states[k][last_j];
+  }
+
+  // Mix the noises in the segment order, and then add them to the values in the frame order.
+  const simd::Float white_gains = simd::set1(white_gain * WHITE_NOISE_SCALE);
+  const simd::Float pink_gains = simd::set1(pink_gain * PINK_NOISE_SCALE);
+  const simd::Float brown_gains = simd::set1(brown_gain * BROWN_NOISE_SCALE);
+  alignas(32) float mixed[NOISE_BLOCK_FRAMES];
+  for (unsigned int t = 0; t < length; ++t) {
+    simd::Float y[NOISE_FILTERS];
+    for (unsigned int k = 0; k < NOISE_FILTERS; ++k) {
+      y[k] = simd::load(responses[k] + t * simd::width) +
+             simd::set1(decays[k][t]) * simd::load(initial_states[k]);
+    }
+    const simd::Float x = simd::load(white + t * simd::width);
+    const simd::Float pink = y[0] + y[1] + y[2] + x * simd::set1(PINK_DIRECT_GAIN);
+    simd::store(mixed + t * simd::width, x * white_gains + pink * pink_gains + y[3] * brown_gains);
+  }
+  for (unsigned int j = 0; j < simd::width; ++j) {
+    for (unsigned int t = 0; t < length && j * length + t < frames_count; ++t) {
+      values[j * length + t] += mixed[t * simd::width + j];
+    }
+  }
+}
+
+/**
+ * @brief Implementation of `quantize`.
+ * @param store `simd::store_int16`, `simd::store_uint8`, or a function that rounds and stores the
+ * scaled samples in the same way.
+ */
+template <class Sample, class Store>
+void quantize_samples(const float *values, Sample *output, unsigned int frames_count,
+                      float scale, float offset, DitherMode dither, QuantizerState &state,
+                      Store store) {
+  static_assert(simd::width <= sizeof(state.seeds) / sizeof(state.seeds[0]));
+
+  const simd::Float scales = simd::set1(scale);
+  const simd::Float offsets = simd::set1(offset);
+  simd::UInt seeds = simd::load(state.seeds);
+
+  // Full vectors are quantized directly. The tail and the noise-shaped samples, which depend on
+  // the previous sample, go through `shaped`.
+  alignas(32) float shaped[simd::width];
+  unsigned int i = 0;
+  if (dither == DitherMode::none) {
+    for (; i + simd::width <= frames_count; i += simd::width) {
+      store(output + i, simd::load(values + i) * scales + offsets);
+    }
+  } else if (dither == DitherMode::tpdf) {
+    for (; i + simd::width <= frames_count; i += simd::width) {
+      const simd::Float noise = next_uniform(seeds) - next_uniform(seeds);
+      store(output + i, simd::load(values + i) * scales + offsets + noise);
+    }
+  }
+  for (; i < frames_count; i += simd::width) {
+    const unsigned int count = std::min(simd::width, frames_count - i);
+    simd::Float noise = simd::set1(0.0f);
+    if (dither != DitherMode::none) {
+      noise = next_uniform(seeds) - next_uniform(seeds);
+    }
+    alignas(32) float input[simd::width] = {};
+    std::copy(values + i, values + i + count, input);
+    simd::store(shaped, simd::load(input) * scales + offsets + noise);
+    if (dither == DitherMode::noise_shaped) {
+      for (unsigned int k = 0; k < count; ++k) {
+        // Subtract the error of the previous sample, which shapes the error by (1 - z^-1).
+        const float target = shaped[k] - state.error;
+        shaped[k] = target;
+        state.error = std::nearbyint(target) - target;
+      }
+    }
+    Sample samples[simd::width];
+    store(samples, simd::load(shaped));
+    std::copy(samples, samples + count, output + i);
+  }
+
+  simd::store(state.seeds, seeds);
+}
+
+}  // namespace
+
+QuantizerState::QuantizerState(std::uint32_t seed) {
+  seed_generators(seeds, seed);
+}
+
+void quantize(const float *values, std::int16_t *output, unsigned int frames_count,
+              DitherMode dither, QuantizerState &state) {
+  quantize_samples(values, output, frames_count, 32767.0f, 0.0f, dither, state,
+                   simd::store_int16);
+}
+
+void quantize(const float *values, std::uint8_t *output, unsigned int frames_count,
+              DitherMode dither, QuantizerState &state) {
+  quantize_samples(values, output, frames_count, 127.0f, 128.0f, dither, state,
+                   simd::store_uint8);
+}
+
+void quantize(const float *values, std::int32_t *output, unsigned int frames_count,
+              unsigned int bits, DitherMode dither, QuantizerState &state) {
+  assert(bits >= 8 && bits <= 24);
+
+  // The bounds and the shift are powers of 2 or their neighbors below 2^24, so every step is exact
+  // in single precision.
+  const float full_scale = static_cast<float>(1u << (bits - 1));
+  const simd::Float lower = simd::set1(-full_scale);
+  const simd::Float upper = simd::set1(full_scale - 1.0f);
+  const simd::Float shift = simd::set1(static_cast<float>(1u << (32 - bits)));
+  quantize_samples(values, output, frames_count, full_scale - 1.0f, 0.0f, dither, state,
+                   [=](std::int32_t *p, simd::Float a) {
+                     simd::store_int32(p, simd::min(simd::max(simd::round(a), lower), upper) *
+                                              shift);
+                   });
+}
+
+NoiseState::NoiseState(std::uint32_t seed) {
+  seed_generators(seeds, seed);
+}
+
+void add_noise(float *values, unsigned int frames_count, float white_gain, float pink_gain,
+               float brown_gain, NoiseState &state) {
+  for (unsigned int i = 0; i < frames_count; i += NOISE_BLOCK_FRAMES) {
+    add_noise_block(values + i, std::min(NOISE_BLOCK_FRAMES, frames_count - i), white_gain,
+                    pink_gain, brown_gain, state);
+  }
+}
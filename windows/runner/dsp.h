@@ -0,0 +1,127 @@
+/**
+ * @file dsp.h
+ * @brief Vectorized operations on blocks of samples.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Multiplies a block of samples by a linear gain ramp.
+ * @param values A pointer to the samples to be multiplied in place.
+ * @param frames_count The number of samples.
+ * @param gain The gain of the first sample.
+ * @param gain_step The gain change per sample. `values[i]` is multiplied by
+ * `gain + i * gain_step`.
+ */
+void apply_gain_ramp(float *values, unsigned int frames_count, float gain, float gain_step);
+
+/**
+ * @brief Mixes two blocks of samples with constant gains.
+ * @param left A pointer to the samples of the first channel.
+ * @param right A pointer to the samples of the second channel.
+ * @param output A pointer to the buffer to write `left[i] * left_gain + right[i] * right_gain`.
+ * @param frames_count The number of samples.
+ * @param left_gain The gain of the first channel.
+ * @param right_gain The gain of the second channel.
+ */
+void mix_channels(const float *left, const float *right, float *output, unsigned int frames_count,
+                  float left_gain, float right_gain);
+
+/**
+ * @brief Adds two blocks of samples with constant gains to a block.
+ * @details The same as `mix_channels`, except that `left[i] * left_gain + right[i] * right_gain`
+ * is added to `output[i]`.
+ */
+void add_channels(const float *left, const float *right, float *output, unsigned int frames_count,
+                  float left_gain, float right_gain);
+
+/**
+ * @brief Dither applied when the samples are quantized to integers.
+ */
+enum class DitherMode {
+  none,          // Round to the nearest integer.
+  tpdf,          // Add triangular PDF noise of +-1 LSB before rounding.
+  noise_shaped,  // TPDF dither with first-order error feedback, which moves the noise upward.
+};
+
+/**
+ * @brief State of the quantizer of a channel.
+ * @details The random numbers are generated by xorshift32 generators, one per SIMD lane.
+ */
+struct QuantizerState {
+  std::uint32_t seeds[8];  // Seeds of the generators. Only `simd::width` of them are used.
+  float error = 0.0f;      // Quantization error of the last sample, used by the noise shaping.
+
+  /**
+   * @brief Construct a new `QuantizerState` object.
+   * @param seed A seed which must be different for each channel.
+   */
+  explicit QuantizerState(std::uint32_t seed);
+};
+
+/**
+ * @brief Quantizes a block of samples to 16-bit integers.
+ * @param values A pointer to the samples in [-1.0, 1.0].
+ * @param output A pointer to the buffer to write the quantized samples.
+ * @param frames_count The number of samples.
+ * @param dither The dither to apply.
+ * @param state The state of the quantizer of the channel.
+ * @details The samples are scaled by 32767, dithered, rounded, and saturated.
+ */
+void quantize(const float *values, std::int16_t *output, unsigned int frames_count,
+              DitherMode dither, QuantizerState &state);
+
+/**
+ * @brief Quantizes a block of samples to unsigned 8-bit integers.
+ * @details The same as the 16-bit version, except that the samples are scaled by 127 and offset
+ * by 128.
+ */
+void quantize(const float *values, std::uint8_t *output, unsigned int frames_count,
+              DitherMode dither, QuantizerState &state);
+
+/**
+ * @brief Quantizes a block of samples to integers left-justified in 32 bits.
+ * @param bits The number of valid bits (8 to 24). The samples are scaled by `2^(bits - 1) - 1`,
+ * dithered, rounded, saturated, and shifted left by `32 - bits`, so the lower bits are 0.
+ * @details The other parameters are the same as the 16-bit version. The samples are computed in
+ * single precision, which has 24 significant bits, so a 32-bit PCM device receives 24 valid bits.
+ */
+void quantize(const float *values, std::int32_t *output, unsigned int frames_count,
+              unsigned int bits, DitherMode dither, QuantizerState &state);
+
+/**
+ * @brief State of the noise generators of a channel.
+ * @details The white noise is generated by xorshift32 generators, one per SIMD lane. The pink
+ * noise is the white noise filtered by three first-order low-pass filters in parallel (Paul
+ * Kellet's economy filter), and the brown noise is the white noise integrated by a leaky
+ * integrator.
+ */
+struct NoiseState {
+  std::uint32_t seeds[8];  // Seeds of the generators. Only `simd::width` of them are used.
+  float filters[4] = {};   // Outputs of the filters for the last sample (0-2: pink, 3: brown).
+
+  /**
+   * @brief Construct a new `NoiseState` object.
+   * @param seed A seed which must be different for each channel.
+   */
+  explicit NoiseState(std::uint32_t seed);
+};
+
+/**
+ * @brief Adds white, pink, and brown noise to a block of samples.
+ * @param values A pointer to the samples to which the noise is added in place.
+ * @param frames_count The number of samples.
+ * @param white_gain The gain of the white noise.
+ * @param pink_gain The gain of the pink noise.
+ * @param brown_gain The gain of the brown noise.
+ * @param state The state of the noise generators of the channel.
+ * @details At the gain 1.0, the RMS of each noise is 0.25 (-12 dBFS), so that the peaks rarely
+ * exceed 1.0. The filters are run on `simd::width` segments of the block at once: each lane
+ * computes the response of its segment from 0, and the response to the state at the start of the
+ * segment is added afterwards, which is exact because the filters are linear. No memory is
+ * allocated.
+ */
+void add_noise(float *values, unsigned int frames_count, float white_gain, float pink_gain,
+               float brown_gain, NoiseState &state);
@@ -92,12 +92,197 @@ void FlutterWindow::ToneGeneratorMethodCallHandler(
       return;
     }
 
+    // The waveforms are optional, and given as the indices of `Waveform`.
+    const auto waveform_argument = [arguments](const char* key) {
+      const auto it = arguments->find(flutter::EncodableValue(key));
+      if (it == arguments->end()) {
+        return Waveform::sine;
+      }
+      const int32_t index = std::get<int32_t>(it->second);
+      if (index < static_cast<int32_t>(Waveform::sine) ||
+          index > static_cast<int32_t>(Waveform::sawtooth)) {
+        throw std::invalid_argument("Unknown waveform.");
+      }
+      return static_cast<Waveform>(index);
+    };
+
     try {
       tone_generator_->set_wave_parameters(
           std::get<double>(arguments->at(flutter::EncodableValue("leftVolume"))),
           std::get<double>(arguments->at(flutter::EncodableValue("rightVolume"))),
           std::get<double>(arguments->at(flutter::EncodableValue("leftFrequency"))),
-          std::get<double>(arguments->at(flutter::EncodableValue("rightFrequency"))));
+          std::get<double>(arguments->at(flutter::EncodableValue("rightFrequency"))),
+          waveform_argument("leftWaveform"), waveform_argument("rightWaveform"));
+      result->Success();
+    } catch (std::out_of_range&) {
+      result->Error("Bad arguments", "Missing required arguments.");
+    } catch (std::bad_variant_access&) {
+      result->Error("Bad arguments", "Invalid argument type.");
+    } catch (std::invalid_argument&) {
+      result->Error("Bad arguments", "Arguments out of range.");
+    }
+  } else if (call.method_name() == "setNoiseParameters") {
+    if (!tone_generator_) {
+      result->Error("Runtime error", "Tone generator not initialized.");
+      return;
+    }
+
+    const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
+    if (!arguments) {
+      result->Error("Bad arguments", "Arguments not an EncodableMap.");
+      return;
+    }
+
+    try {
+      tone_generator_->set_noise_parameters(
+          std::get<double>(arguments->at(flutter::EncodableValue("whiteNoiseVolume"))),
+          std::get<double>(arguments->at(flutter::EncodableValue("pinkNoiseVolume"))),
+          std::get<double>(arguments->at(flutter::EncodableValue("brownNoiseVolume"))));
+      result->Success();
+    } catch (std::out_of_range&) {
+      result->Error("Bad arguments", "Missing required arguments.");
+    } catch (std::bad_variant_access&) {
+      result->Error("Bad arguments", "Invalid argument type.");
+    } catch (std::invalid_argument&) {
+      result->Error("Bad arguments", "Arguments out of range.");
+    }
+  } else if (call.method_name() == "setChannelRouting") {
+    if (!tone_generator_) {
+      result->Error("Runtime error", "Tone generator not initialized.");
+      return;
+    }
+
+    const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
+    if (!arguments) {
+      result->Error("Bad arguments", "Arguments not an EncodableMap.");
+      return;
+    }
+
+    // The gains are sent as `Float64List`s.
+    try {
+      tone_generator_->set_channel_routing(
+          std::get<std::vector<double>>(arguments->at(flutter::EncodableValue("leftGains"))),
+          std::get<std::vector<double>>(arguments->at(flutter::EncodableValue("rightGains"))));
+      result->Success();
+    } catch (std::out_of_range&) {
+      result->Error("Bad arguments", "Missing required arguments.");
+    } catch (std::bad_variant_access&) {
+      result->Error("Bad arguments", "Invalid argument type.");
+    } catch (std::invalid_argument&) {
+      result->Error("Bad arguments", "Arguments out of range.");
+    }
+  } else if (call.method_name() == "setTonePair") {
+    if (!tone_generator_) {
+      result->Error("Runtime error", "Tone generator not initialized.");
+      return;
+    }
+
+    const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
+    if (!arguments) {
+      result->Error("Bad arguments", "Arguments not an EncodableMap.");
+      return;
+    }
+
+    // The gains are sent as `Float64List`s, which are empty if the pair is not routed.
+    try {
+      const int32_t index = std::get<int32_t>(arguments->at(flutter::EncodableValue("index")));
+      if (index < 0) {
+        throw std::invalid_argument("Negative tone pair index.");
+      }
+      tone_generator_->set_tone_pair(
+          static_cast<unsigned int>(index),
+          std::get<double>(arguments->at(flutter::EncodableValue("volume"))),
+          std::get<double>(arguments->at(flutter::EncodableValue("leftFrequency"))),
+          std::get<double>(arguments->at(flutter::EncodableValue("rightFrequency"))),
+          std::get<std::vector<double>>(arguments->at(flutter::EncodableValue("leftGains"))),
+          std::get<std::vector<double>>(arguments->at(flutter::EncodableValue("rightGains"))));
+      result->Success();
+    } catch (std::out_of_range&) {
+      result->Error("Bad arguments", "Missing required arguments.");
+    } catch (std::bad_variant_access&) {
+      result->Error("Bad arguments", "Invalid argument type.");
+    } catch (std::invalid_argument&) {
+      result->Error("Bad arguments", "Arguments out of range.");
+    }
+  } else if (call.method_name() == "setLatency" ||
+             call.method_name() == "setAdaptiveLatency") {
+    if (!tone_generator_) {
+      result->Error("Runtime error", "Tone generator not initialized.");
+      return;
+    }
+
+    const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
+    if (!arguments) {
+      result->Error("Bad arguments", "Arguments not an EncodableMap.");
+      return;
+    }
+
+    // The latencies are sent in milliseconds.
+    const auto latency_argument = [arguments](const char* key) {
+      const int32_t latency = std::get<int32_t>(arguments->at(flutter::EncodableValue(key)));
+      if (latency <= 0) {
+        throw std::invalid_argument("Latency out of range.");
+      }
+      return static_cast<unsigned int>(latency);
+    };
+
+    try {
+      if (call.method_name() == "setLatency") {
+        tone_generator_->set_latency(latency_argument("latency"));
+      } else {
+        tone_generator_->set_adaptive_latency(latency_argument("minLatency"),
+                                              latency_argument("maxLatency"));
+      }
+      result->Success();
+    } catch (std::out_of_range&) {
+      result->Error("Bad arguments", "Missing required arguments.");
+    } catch (std::bad_variant_access&) {
+      result->Error("Bad arguments", "Invalid argument type.");
+    } catch (std::invalid_argument&) {
+      result->Error("Bad arguments", "Arguments out of range.");
+    }
+  } else if (call.method_name() == "setTimeline") {
+    if (!tone_generator_) {
+      result->Error("Runtime error", "Tone generator not initialized.");
+      return;
+    }
+
+    const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
+    if (!arguments) {
+      result->Error("Bad arguments", "Arguments not an EncodableMap.");
+      return;
+    }
+
+    // Each track is sent as a `Float64List` of the start value followed by the duration, the index
+    // of `SegmentShape`, and the end value of each segment.
+    const auto track_argument = [arguments](const char* key) {
+      const auto& values =
+          std::get<std::vector<double>>(arguments->at(flutter::EncodableValue(key)));
+      if (values.empty() || values.size() % 3 != 1) {
+        throw std::invalid_argument("Malformed track.");
+      }
+      TimelineTrack track;
+      track.start_value = values[0];
+      for (size_t i = 1; i < values.size(); i += 3) {
+        const double shape = values[i + 1];
+        if (shape != static_cast<int>(SegmentShape::hold) &&
+            shape != static_cast<int>(SegmentShape::linear) &&
+            shape != static_cast<int>(SegmentShape::exponential)) {
+          throw std::invalid_argument("Unknown segment shape.");
+        }
+        track.segments.push_back(
+            {values[i], static_cast<SegmentShape>(static_cast<int>(shape)), values[i + 2]});
+      }
+      return track;
+    };
+
+    try {
+      Timeline timeline;
+      timeline.left_amplitude = track_argument("leftVolume");
+      timeline.right_amplitude = track_argument("rightVolume");
+      timeline.left_frequency = track_argument("leftFrequency");
+      timeline.right_frequency = track_argument("rightFrequency");
+      tone_generator_->set_timeline(timeline);
       result->Success();
     } catch (std::out_of_range&) {
       result->Error("Bad arguments", "Missing required arguments.");
@@ -106,6 +291,13 @@ void FlutterWindow::ToneGeneratorMethodCallHandler(
     } catch (std::invalid_argument&) {
       result->Error("Bad arguments", "Arguments out of range.");
     }
+  } else if (call.method_name() == "stopTimeline") {
+    if (!tone_generator_) {
+      result->Error("Runtime error", "Tone generator not initialized.");
+      return;
+    }
+    tone_generator_->stop_timeline();
+    result->Success();
   } else if (call.method_name() == "startPlayingTone") {
     if (!tone_generator_) {
       result->Error("Runtime error", "Tone generator not initialized.");
@@ -120,6 +312,126 @@ void FlutterWindow::ToneGeneratorMethodCallHandler(
     }
     tone_generator_->stop();
     result->Success();
+  } else if (call.method_name() == "scheduleCommands") {
+    if (!tone_generator_) {
+      result->Error("Runtime error", "Tone generator not initialized.");
+      return;
+    }
+
+    const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
+    if (!arguments) {
+      result->Error("Bad arguments", "Arguments not an EncodableMap.");
+      return;
+    }
+
+    // Each command is a map of the index of `ToneCommand::Type` and the parameters of the type,
+    // named as in the other methods.
+    const auto command_argument = [](const flutter::EncodableValue& value) {
+      const auto& map = std::get<flutter::EncodableMap>(value);
+      const auto number = [&map](const char* key) {
+        return std::get<double>(map.at(flutter::EncodableValue(key)));
+      };
+      const auto waveform = [&map](const char* key) {
+        const int32_t index = std::get<int32_t>(map.at(flutter::EncodableValue(key)));
+        if (index < static_cast<int32_t>(Waveform::sine) ||
+            index > static_cast<int32_t>(Waveform::sawtooth)) {
+          throw std::invalid_argument("Unknown waveform.");
+        }
+        return static_cast<Waveform>(index);
+      };
+      ToneCommand command;
+      const int32_t type = std::get<int32_t>(map.at(flutter::EncodableValue("type")));
+      if (type < static_cast<int32_t>(ToneCommand::Type::set_wave_parameters) ||
+          type > static_cast<int32_t>(ToneCommand::Type::stop)) {
+        throw std::invalid_argument("Unknown command.");
+      }
+      command.type = static_cast<ToneCommand::Type>(type);
+      if (command.type == ToneCommand::Type::set_wave_parameters) {
+        command.left_amplitude = number("leftVolume");
+        command.right_amplitude = number("rightVolume");
+        command.left_frequency = number("leftFrequency");
+        command.right_frequency = number("rightFrequency");
+        command.left_waveform = waveform("leftWaveform");
+        command.right_waveform = waveform("rightWaveform");
+      } else if (command.type == ToneCommand::Type::set_noise_parameters) {
+        command.white_noise_gain = number("whiteNoiseVolume");
+        command.pink_noise_gain = number("pinkNoiseVolume");
+        command.brown_noise_gain = number("brownNoiseVolume");
+      }
+      return command;
+    };
+
+    try {
+      std::vector<ToneCommand> commands;
+      for (const auto& value :
+           std::get<flutter::EncodableList>(arguments->at(flutter::EncodableValue("commands")))) {
+        commands.push_back(command_argument(value));
+      }
+      // The commands are scheduled at `streamPosition` if it is given, or `delay` seconds later.
+      const auto position = arguments->find(flutter::EncodableValue("streamPosition"));
+      if (position != arguments->end()) {
+        const int64_t stream_position = position->second.LongValue();
+        if (stream_position < 0) {
+          throw std::invalid_argument("Negative stream position.");
+        }
+        tone_generator_->schedule_commands(static_cast<uint64_t>(stream_position), commands);
+      } else {
+        const double delay = std::get<double>(arguments->at(flutter::EncodableValue("delay")));
+        if (!(delay >= 0 && delay < 1e9)) {
+          throw std::invalid_argument("Delay out of range.");
+        }
+        tone_generator_->schedule_commands(
+            std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(delay)),
+            commands);
+      }
+      result->Success();
+    } catch (std::out_of_range&) {
+      result->Error("Bad arguments", "Missing required arguments.");
+    } catch (std::bad_variant_access&) {
+      result->Error("Bad arguments", "Invalid argument type.");
+    } catch (std::invalid_argument&) {
+      result->Error("Bad arguments", "Arguments out of range.");
+    } catch (const std::runtime_error& e) {
+      result->Error("Runtime error", e.what());
+    }
+  } else if (call.method_name() == "getLiveParameters") {
+    if (!tone_generator_) {
+      result->Error("Runtime error", "Tone generator not initialized.");
+      return;
+    }
+    const LiveParameters live = tone_generator_->get_live_parameters();
+    const flutter::EncodableMap ret = {
+        {"leftVolume", live.left_amplitude},
+        {"rightVolume", live.right_amplitude},
+        {"leftFrequency", live.left_frequency},
+        {"rightFrequency", live.right_frequency},
+        {"leftWaveform", static_cast<int32_t>(live.left_waveform)},
+        {"rightWaveform", static_cast<int32_t>(live.right_waveform)},
+        {"whiteNoiseVolume", live.white_noise_gain},
+        {"pinkNoiseVolume", live.pink_noise_gain},
+        {"brownNoiseVolume", live.brown_noise_gain},
+        {"isPlaying", live.is_playing},
+        {"streamPosition", static_cast<int64_t>(live.stream_position)},
+        {"samplesPerSecond", live.samples_per_second},
+        {"timelineRunning", live.timeline_running},
+        {"timelinePosition", live.timeline_position},
+        {"timelineDuration", live.timeline_duration},
+        {"timelineReports", static_cast<int64_t>(live.timeline_reports)},
+        {"reportedTimelinePosition", live.reported_timeline_position},
+        {"reportedTimelineDuration", live.reported_timeline_duration},
+        {"schedulingClass", static_cast<int32_t>(live.scheduling.scheduling_class)},
+        {"affinityApplied", live.scheduling.affinity_applied},
+        {"denormalsFlushed", live.scheduling.denormals_flushed},
+        {"renderAheadDepth", static_cast<int32_t>(live.render_ahead_depth)},
+        {"renderAheadFill", static_cast<int32_t>(live.render_ahead_fill)},
+        {"producerLateFrames", static_cast<int64_t>(live.producer_late_frames)},
+        {"latency", static_cast<int32_t>(live.latency)},
+        {"adaptiveLatency", live.adaptive_latency},
+        {"underruns", static_cast<int64_t>(live.underruns)},
+    };
+    result->Success(ret);
   } else if (call.method_name() == "getAudioDeviceInfo") {
     if (!tone_generator_) {
       result->Error("Runtime error", "Tone generator not initialized.");
@@ -0,0 +1,133 @@
+/**
+ * @file interleave.h
+ * @brief Interleaving of the planar blocks of samples rendered by `ToneDataGenerator` into frames.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "simd.h"
+
+// Constants.
+constexpr unsigned int MAX_INTERLEAVE_FRAMES = 64;  // Frames interleaved at once at most.
+
+/**
+ * @brief A 24-bit little-endian integer packed in 3 bytes.
+ */
+struct Int24 {
+  std::uint8_t bytes[3];
+};
+static_assert(sizeof(Int24) == 3);
+
+/**
+ * @brief Interleaves the samples of the left and right channels into stereo frames.
+ * @param frames_count The number of frames.
+ * @details The 8-, 16-, and 32-bit samples are interleaved with SIMD unpacks. The 24-bit samples
+ * are copied one by one.
+ */
+template <class Sample>
+void interleave_stereo(const Sample *left, const Sample *right, Sample *output,
+                       unsigned int frames_count) {
+  unsigned int i = 0;
+  if constexpr (std::is_same_v<Sample, float>) {
+    for (; i + simd::width <= frames_count; i += simd::width) {
+      simd::store_interleaved(output + 2 * i, simd::load(left + i), simd::load(right + i));
+    }
+  } else if constexpr (std::is_same_v<Sample, std::int32_t>) {
+    // The bits of the samples are moved as they are.
+    const auto *left_words = reinterpret_cast<const std::uint32_t *>(left);
+    const auto *right_words = reinterpret_cast<const std::uint32_t *>(right);
+    auto *output_words = reinterpret_cast<std::uint32_t *>(output);
+    for (; i + simd::width <= frames_count; i += simd::width) {
+      simd::store_interleaved(output_words + 2 * i, simd::load(left_words + i),
+                              simd::load(right_words + i));
+    }
+  } else if constexpr (std::is_same_v<Sample, std::int16_t>) {
+    for (; i + 2 * simd::width <= frames_count; i += 2 * simd::width) {
+      simd::interleave_int16(left + i, right + i, output + 2 * i);
+    }
+  } else if constexpr (std::is_same_v<Sample, std::uint8_t>) {
+    for (; i + 4 * simd::width <= frames_count; i += 4 * simd::width) {
+      simd::interleave_uint8(left + i, right + i, output + 2 * i);
+    }
+  }
+  for (; i < frames_count; ++i) {
+    output[2 * i] = left[i];
+    output[2 * i + 1] = right[i];
+  }
+}
+
+/**
+ * @brief Writes the samples of the left and right channels and the silence of the other
+ * channels frame by frame.
+ * @tparam Channels The number of channels, or 0 to use `channels` at run time. When it is given,
+ * the loop over the extra channels is unrolled by the compiler.
+ */
+template <class Sample, unsigned int Channels>
+void interleave_fused(const Sample *left, const Sample *right, Sample *output,
+                      unsigned int frames_count, unsigned int channels, Sample silence) {
+  if constexpr (Channels != 0) {
+    channels = Channels;
+  }
+  for (unsigned int i = 0; i < frames_count; ++i) {
+    output[0] = left[i];
+    output[1] = right[i];
+    for (unsigned int j = 2; j < channels; ++j) {
+      output[j] = silence;
+    }
+    output += channels;
+  }
+}
+
+/**
+ * @brief Interleaves the samples of the left and right channels into frames, whose other
+ * channels are filled with the silence.
+ * @tparam Channels The number of channels, or 0 to use `channels` at run time.
+ * @param frames_count The number of frames. `MAX_INTERLEAVE_FRAMES` or less.
+ * @param silence The sample of the value 0. Its bytes must be the same.
+ * @details Stereo frames are interleaved by `interleave_stereo`. With more channels, the pairs
+ * are interleaved into a temporary buffer, the frames are filled with the silence in bulk, and
+ * then each pair is copied to its frame at once. The fused loop of `interleave_fused` is used
+ * instead where it is faster: for 24-bit stereo, and for 32-bit samples in 6 channels.
+ *
+ * Time per frame in ns of `binaural_bench interleave` (fused loop -> this function), with 64-frame
+ * blocks, on an x86-64 core with GCC:
+ *
+ * | Sample  | SSE2 2ch    | SSE2 6ch    | SSE2 8ch    | AVX2 2ch    | AVX2 6ch    | AVX2 8ch    |
+ * |---------|-------------|-------------|-------------|-------------|-------------|-------------|
+ * | 8-bit   | 0.09 - 0.08 | 0.88 - 0.58 | 1.35 - 0.56 | 0.08 - 0.06 | 0.98 - 0.55 | 1.35 - 0.55 |
+ * | 16-bit  | 0.13 - 0.13 | 0.78 - 0.64 | 1.35 - 0.65 | 0.11 - 0.09 | 0.91 - 0.62 | 1.40 - 0.59 |
+ * | 24-bit  | 0.72 - 0.72 | 2.10 - 1.79 | 2.80 - 1.70 | 0.74 - 0.75 | 2.11 - 1.79 | 2.79 - 1.67 |
+ * | 32-bit  | 0.21 - 0.23 | 0.71 - 0.71 | 1.35 - 0.74 | 0.18 - 0.16 | 0.83 - 0.83 | 1.40 - 0.74 |
+ * | float   | 0.21 - 0.23 | 0.69 - 0.69 | 1.35 - 0.72 | 0.17 - 0.17 | 0.73 - 0.71 | 1.35 - 0.74 |
+ */
+template <class Sample, unsigned int Channels>
+void interleave(const Sample *left, const Sample *right, Sample *output,
+                unsigned int frames_count, unsigned int channels, Sample silence) {
+  assert(frames_count <= MAX_INTERLEAVE_FRAMES);
+  constexpr bool is_fused =
+      (sizeof(Sample) == 3 && Channels == 2) || (sizeof(Sample) == 4 && Channels == 6);
+  if constexpr (is_fused) {
+    interleave_fused<Sample, Channels>(left, right, output, frames_count, channels, silence);
+  } else {
+    if constexpr (Channels != 0) {
+      channels = Channels;
+    }
+    if (channels == 2) {
+      interleave_stereo(left, right, output, frames_count);
+      return;
+    }
+    alignas(32) Sample pairs[2 * MAX_INTERLEAVE_FRAMES];
+    interleave_stereo(left, right, pairs, frames_count);
+    std::uint8_t silence_byte;
+    std::memcpy(&silence_byte, &silence, 1);
+    std::memset(output, silence_byte, sizeof(Sample) * channels * frames_count);
+    for (unsigned int i = 0; i < frames_count; ++i) {
+      std::memcpy(output + i * channels, pairs + 2 * i, 2 * sizeof(Sample));
+    }
+  }
+}
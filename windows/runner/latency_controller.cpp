@@ -0,0 +1,68 @@
+/**
+ * @file latency_controller.cpp
+ * @brief `LatencyController` class implementation.
+ */
+
+#include "latency_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LatencyController::change(unsigned int latency, bool probing) {
+  m_latency = latency;
+  m_probing = probing;
+  restart();
+}
+
+void LatencyController::configure(unsigned int min_latency, unsigned int max_latency,
+                                  unsigned int latency) {
+  m_min_latency = min_latency;
+  m_max_latency = std::max(min_latency, max_latency);
+  m_probe_interval = PROBE_INTERVAL;
+  change(std::clamp(latency, m_min_latency, m_max_latency), false);
+}
+
+void LatencyController::set_latency(unsigned int latency) {
+  change(std::clamp(latency, m_min_latency, m_max_latency), false);
+}
+
+void LatencyController::restart() {
+  m_time = 0.0;
+  m_late_wakeups = 0;
+  m_late_window_start = 0.0;
+}
+
+unsigned int LatencyController::update(std::uint32_t padding, std::uint32_t buffer_size,
+                                       std::uint32_t frames, double samples_per_second) {
+  if (samples_per_second > 0) {
+    m_time += frames / samples_per_second;
+  }
+  if (m_time < SETTLE_TIME) {
+    return m_latency;
+  }
+
+  const bool underrun = padding == 0;
+  const bool late = padding < buffer_size / 4;
+  if (underrun) {
+    ++m_underruns;
+  }
+
+  if (underrun || late) {
+    if (m_time - m_late_window_start >= 1.0) {
+      m_late_window_start = m_time;
+      m_late_wakeups = 0;
+    }
+    ++m_late_wakeups;
+    if ((underrun || m_late_wakeups >= LATE_WAKEUPS) && m_latency < m_max_latency) {
+      if (m_probing && m_time < m_probe_interval) {  // The last probe has failed.
+        m_probe_interval = std::min(m_probe_interval * 2, MAX_PROBE_INTERVAL);
+      }
+      const double factor = underrun ? 2.0 : 1.5;
+      change(std::min(static_cast<unsigned int>(std::ceil(m_latency * factor)), m_max_latency),
+             false);
+    }
+  } else if (m_time >= m_probe_interval && m_latency > m_min_latency) {
+    change(std::max(m_latency * 3 / 4, m_min_latency), true);
+  }
+  return m_latency;
+}
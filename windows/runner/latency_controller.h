@@ -0,0 +1,87 @@
+/**
+ * @file latency_controller.h
+ * @brief `LatencyController` class declaration.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Chooses the latency of the audio client from the fill of its buffer at each wakeup.
+ * @details A wakeup that finds the buffer empty is an underrun, and one that finds it less than
+ * a quarter full is late. An underrun doubles the latency, and `LATE_WAKEUPS` late wakeups
+ * within a second widen it by half. After `probe_interval` seconds without any of them, the
+ * latency is narrowed by a quarter toward the minimum. If the latency has to be widened again
+ * before the next probe, the probe has failed, and the interval is doubled up to
+ * `MAX_PROBE_INTERVAL`, so that a latency too low for the system is not retried often. The
+ * wakeups during `SETTLE_TIME` seconds after a change are not judged, since the new stream starts
+ * from the frames handed over by the old one. This class does not depend on the Windows API.
+ */
+class LatencyController {
+ private:
+  // Constants.
+  static constexpr unsigned int LATE_WAKEUPS = 3;       // Late wakeups in a second to widen.
+  static constexpr double SETTLE_TIME = 0.5;            // Seconds not judged after a change.
+  static constexpr double PROBE_INTERVAL = 10.0;        // Initial interval of the probes (s).
+  static constexpr double MAX_PROBE_INTERVAL = 320.0;   // Maximum interval of the probes (s).
+
+  unsigned int m_min_latency = 0;  // Minimum latency in milliseconds.
+  unsigned int m_max_latency = 0;  // Maximum latency in milliseconds.
+  unsigned int m_latency = 0;      // Current latency in milliseconds.
+  double m_time = 0.0;             // Seconds played since the last change or restart.
+  double m_probe_interval = PROBE_INTERVAL;
+  bool m_probing = false;          // `true` if the last change narrowed the latency.
+  unsigned int m_late_wakeups = 0;  // Late wakeups since `m_late_window_start`.
+  double m_late_window_start = 0.0;
+  std::uint64_t m_underruns = 0;  // Underruns since the construction.
+
+  /**
+   * @brief Changes the latency and starts judging it afresh.
+   */
+  void change(unsigned int latency, bool probing);
+
+ public:
+  /**
+   * @brief Sets the range and the current latency, and forgets the history of the probes.
+   * @param min_latency The minimum latency in milliseconds.
+   * @param max_latency The maximum latency in milliseconds.
+   * @param latency The current latency in milliseconds, clamped to the range.
+   * @details With `min_latency == max_latency`, the latency is fixed, and only the underruns are
+   * counted.
+   */
+  void configure(unsigned int min_latency, unsigned int max_latency, unsigned int latency);
+
+  /**
+   * @brief Sets the current latency within the range, e.g., when the latency could not be
+   * changed to the value returned by `update`.
+   */
+  void set_latency(unsigned int latency);
+
+  /**
+   * @brief Ignores the wakeups for `SETTLE_TIME` seconds, e.g., after the client is started.
+   */
+  void restart();
+
+  /**
+   * @brief Judges a wakeup of the audio client.
+   * @param padding The frames in the buffer at the wakeup, before writing.
+   * @param buffer_size The size of the buffer in frames.
+   * @param frames The frames written at the wakeup.
+   * @param samples_per_second The sample rate in Hz.
+   * @return The latency to use in milliseconds. If it differs from the previous value, the
+   * stream should be re-created with it.
+   */
+  unsigned int update(std::uint32_t padding, std::uint32_t buffer_size, std::uint32_t frames,
+                      double samples_per_second);
+
+  /**
+   * @brief Returns the current latency in milliseconds.
+   */
+  unsigned int latency() const { return m_latency; }
+
+  /**
+   * @brief Returns the underruns counted since the construction.
+   */
+  std::uint64_t underruns() const { return m_underruns; }
+};
@@ -0,0 +1,258 @@
+/**
+ * @file offline_renderer.cpp
+ * @brief Functions to render the tone to WAV files without an audio device.
+ */
+
+#include "offline_renderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Constants.
+constexpr std::uint64_t CHUNK_FRAMES = 1 << 18;  // Frames rendered and written at once.
+constexpr std::uint64_t RIFF_SIZE_LIMIT = 0xffffffff;  // Largest size in a RIFF header.
+
+namespace {
+
+/**
+ * @brief Appends an unsigned integer to the header in little endian.
+ */
+void append(std::vector<char> &header, std::uint64_t value, unsigned int bytes) {
+  for (unsigned int i = 0; i < bytes; ++i) {
+    header.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+/**
+ * @brief Appends a four-character code to the header.
+ */
+void append(std::vector<char> &header, const char (&code)[5]) {
+  header.insert(header.end(), code, code + 4);
+}
+
+/**
+ * @brief Returns the header of a WAV file up to the start of the data.
+ * @param generator The generator that renders the data.
+ * @param frames_count The number of frames of the data.
+ * @details The format is `WAVE_FORMAT_EXTENSIBLE` if there are more than 2 channels or more than
+ * 16 bits per sample, as required by Windows, and `WAVE_FORMAT_PCM` otherwise. If the file does
+ * not fit in the sizes of a RIFF header, an RF64 header with a `ds64` chunk is used.
+ */
+std::vector<char> wav_header(const ToneDataGenerator &generator, std::uint64_t frames_count) {
+  const unsigned int channels = generator.channels_count;
+  const unsigned int bits = generator.bits_per_sample;
+  const unsigned int valid_bits =
+      generator.valid_bits_per_sample != 0 ? generator.valid_bits_per_sample : bits;
+  const auto samples_per_second = static_cast<std::uint32_t>(generator.samples_per_second);
+  const unsigned int block_align = channels * bits / 8;
+  const bool is_extensible = channels > 2 || bits > 16;
+  const unsigned int format_size = is_extensible ? 40 : 16;
+  const std::uint64_t data_size = frames_count * block_align;
+  const bool is_rf64 = 4 + (8 + format_size) + 8 + data_size > RIFF_SIZE_LIMIT;
+  const std::uint64_t riff_size = 4 + (is_rf64 ? 8 + 28 : 0) + (8 + format_size) + 8 + data_size;
+
+  std::vector<char> header;
+  append(header, is_rf64 ? "RF64" : "RIFF");
+  append(header, is_rf64 ? RIFF_SIZE_LIMIT : riff_size, 4);
+  append(header, "WAVE");
+  if (is_rf64) {
+    append(header, "ds64");
+    append(header, 28, 4);
+    append(header, riff_size, 8);
+    append(header, data_size, 8);
+    append(header, frames_count, 8);
+    append(header, 0, 4);  // No table of other chunk sizes.
+  }
+
+  append(header, "fmt ");
+  append(header, format_size, 4);
+  append(header, is_extensible ? 0xfffe : 0x0001, 2);  // Format tag.
+  append(header, channels, 2);
+  append(header, samples_per_second, 4);
+  append(header, static_cast<std::uint64_t>(samples_per_second) * block_align, 4);
+  append(header, block_align, 2);
+  append(header, bits, 2);
+  if (is_extensible) {
+    // The speakers of the usual layouts. Other numbers of channels are not assigned to speakers.
+    const std::uint32_t channel_mask = channels == 2   ? 0x3
+                                       : channels == 6 ? 0x3f
+                                       : channels == 8 ? 0x63f
+                                                       : 0;
+    append(header, 22, 2);  // Size of the extension.
+    append(header, valid_bits, 2);
+    append(header, channel_mask, 4);
+    // KSDATAFORMAT_SUBTYPE_PCM or KSDATAFORMAT_SUBTYPE_IEEE_FLOAT.
+    append(header, generator.is_float ? 0x0003 : 0x0001, 4);
+    append(header, 0x0000, 2);
+    append(header, 0x0010, 2);
+    for (int byte : {0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71}) {
+      append(header, byte, 1);
+    }
+  }
+
+  append(header, "data");
+  append(header, is_rf64 ? RIFF_SIZE_LIMIT : data_size, 4);
+  return header;
+}
+
+/**
+ * @brief Layout of the chunks of a render.
+ * @details The last second is written by the stopping path, which needs at most a half period of
+ * the lowest frequency (1 Hz) to reach a zero crossing. The last chunk is extended to the end, so
+ * that the stopping path is not split between the chunks.
+ */
+struct ChunkLayout {
+  std::uint64_t frames_count;  // Frames of the render.
+  std::uint64_t stop_frames;   // Frames written by the stopping path at the end.
+  std::uint64_t stop_start;    // First frame written by the stopping path.
+  std::uint64_t chunks_count;  // Number of chunks.
+
+  ChunkLayout(const ToneDataGenerator &generator, std::uint64_t frames_count)
+      : frames_count(frames_count),
+        stop_frames(
+            std::min(frames_count, static_cast<std::uint64_t>(generator.samples_per_second))),
+        stop_start(frames_count - stop_frames),
+        chunks_count(stop_start / CHUNK_FRAMES + 1) {}
+};
+
+/**
+ * @brief Creates the WAV file with its header, and allocates the space of the data.
+ * @return The size of the header.
+ */
+std::uint64_t create_wav_file(const ToneDataGenerator &generator, std::uint64_t frames_count,
+                              const std::string &path) {
+  const std::vector<char> header = wav_header(generator, frames_count);
+  const unsigned int bytes_per_frame = generator.channels_count * generator.bits_per_sample / 8;
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+    if (!file) {
+      throw std::runtime_error("Failed to write the WAV file: " + path);
+    }
+  }
+  std::filesystem::resize_file(path, header.size() + frames_count * bytes_per_frame);
+  return header.size();
+}
+
+/**
+ * @brief Renders a chunk and writes it to its place in the file.
+ * @param buffer The buffer to render the chunk. It is grown as needed.
+ */
+void render_chunk(const ToneDataGenerator &generator, const ChunkLayout &layout,
+                  std::uint64_t chunk, std::fstream &file, std::uint64_t header_size,
+                  std::vector<std::uint8_t> &buffer, const std::string &path) {
+  const unsigned int bytes_per_frame = generator.channels_count * generator.bits_per_sample / 8;
+  const std::uint64_t start = chunk * CHUNK_FRAMES;
+  const bool is_last = chunk == layout.chunks_count - 1;
+  const std::uint64_t end = is_last ? layout.frames_count : start + CHUNK_FRAMES;
+  const std::uint64_t sound_end = is_last ? layout.stop_start : end;
+  if (buffer.size() < (end - start) * bytes_per_frame) {
+    buffer.resize((end - start) * bytes_per_frame);
+  }
+
+  generator.render_frames(buffer.data(), start, static_cast<unsigned int>(sound_end - start));
+  if (is_last) {
+    ToneDataGenerator stop_generator = generator;
+    stop_generator.seek(layout.stop_start);
+    stop_generator.write_tone_data(buffer.data() + (layout.stop_start - start) * bytes_per_frame,
+                                   static_cast<unsigned int>(layout.stop_frames), true);
+  }
+
+  file.seekp(static_cast<std::streamoff>(header_size + start * bytes_per_frame));
+  file.write(reinterpret_cast<const char *>(buffer.data()),
+             static_cast<std::streamsize>((end - start) * bytes_per_frame));
+  if (!file) {
+    throw std::runtime_error("Failed to write the WAV file: " + path);
+  }
+}
+
+}  // namespace
+
+void render_wav_file(const ToneDataGenerator &generator, std::uint64_t frames_count,
+                     const std::string &path, unsigned int threads_count) {
+  const std::uint64_t header_size = create_wav_file(generator, frames_count, path);
+  const ChunkLayout layout(generator, frames_count);
+  if (threads_count == 0) {
+    threads_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  threads_count =
+      static_cast<unsigned int>(std::min<std::uint64_t>(threads_count, layout.chunks_count));
+
+  // The chunks are taken in order by the threads. An error stops all threads, and the first one
+  // is rethrown.
+  std::atomic<std::uint64_t> next_chunk = 0;
+  std::vector<std::exception_ptr> errors(threads_count);
+  const auto render_chunks = [&](unsigned int thread_index) {
+    try {
+      std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+      std::vector<std::uint8_t> buffer;
+      for (std::uint64_t chunk = next_chunk++; chunk < layout.chunks_count;
+           chunk = next_chunk++) {
+        render_chunk(generator, layout, chunk, file, header_size, buffer, path);
+      }
+    } catch (...) {
+      errors[thread_index] = std::current_exception();
+      next_chunk = layout.chunks_count;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < threads_count; ++i) {
+    threads.emplace_back(render_chunks, i);
+  }
+  render_chunks(0);
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (const std::exception_ptr &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+void render_wav_file(const ToneDataGenerator &generator, std::uint64_t frames_count,
+                     const std::string &path, std::vector<std::uint8_t> &buffer) {
+  const std::uint64_t header_size = create_wav_file(generator, frames_count, path);
+  const ChunkLayout layout(generator, frames_count);
+  std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+  for (std::uint64_t chunk = 0; chunk < layout.chunks_count; ++chunk) {
+    render_chunk(generator, layout, chunk, file, header_size, buffer, path);
+  }
+}
+
+std::vector<RenderJobReport> render_batch(const std::vector<RenderJob> &jobs,
+                                          WorkStealingPool &pool) {
+  // The cost of a job is nearly proportional to the number of samples.
+  std::vector<std::size_t> order(jobs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&jobs](std::size_t a, std::size_t b) {
+    return jobs[a].frames_count * jobs[a].generator.channels_count >
+           jobs[b].frames_count * jobs[b].generator.channels_count;
+  });
+
+  std::vector<RenderJobReport> reports(jobs.size());
+  std::vector<std::vector<std::uint8_t>> buffers(pool.threads_count());
+  pool.run(jobs.size(), [&](std::size_t index, unsigned int thread) {
+    const RenderJob &job = jobs[order[index]];
+    RenderJobReport &report = reports[order[index]];
+    const auto start = std::chrono::steady_clock::now();
+    try {
+      render_wav_file(job.generator, job.frames_count, job.path, buffers[thread]);
+    } catch (const std::exception &e) {
+      report.error = e.what();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    report.seconds = elapsed.count();
+    report.thread = thread;
+  });
+  return reports;
+}
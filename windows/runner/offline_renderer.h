@@ -0,0 +1,71 @@
+/**
+ * @file offline_renderer.h
+ * @brief Functions to render the tone to WAV files without an audio device.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tone_data_generator.h"
+#include "work_stealing_pool.h"
+
+/**
+ * @brief A file rendered by `render_batch`.
+ */
+struct RenderJob {
+  ToneDataGenerator generator;  // Parameters and sample format of the file.
+  std::uint64_t frames_count;   // Number of frames of the file.
+  std::string path;             // Path of the file.
+};
+
+/**
+ * @brief The result of a `RenderJob`.
+ */
+struct RenderJobReport {
+  double seconds = 0.0;     // Wall time of the job in seconds.
+  unsigned int thread = 0;  // Index of the thread of the pool that ran the job.
+  std::string error;        // Message of the error, or empty if the file has been written.
+};
+
+/**
+ * @brief Renders the tone of a generator to a WAV file faster than real time.
+ * @param generator The generator whose public parameters are rendered, including the sample
+ * format, `samples_per_second`, and `channels_count`. It is not modified.
+ * @param frames_count The number of frames to render.
+ * @param path The path of the WAV file. An existing file is overwritten.
+ * @param threads_count The number of threads. 0 uses one thread per core.
+ * @exception `std::runtime_error` is thrown if the file cannot be written.
+ * @details The frames are split into chunks, which are rendered by the threads in parallel with
+ * `ToneDataGenerator::render_frames`, so the file is the same whatever the number of threads.
+ * Each thread writes its chunks directly to their places in the file in large blocks. The file is
+ * written in the RF64 format if it exceeds 4 GiB. The last second is written by the stopping
+ * path, so the tone ends at a zero crossing as in the real-time playback.
+ */
+void render_wav_file(const ToneDataGenerator &generator, std::uint64_t frames_count,
+                     const std::string &path, unsigned int threads_count = 0);
+
+/**
+ * @brief Renders the tone of a generator to a WAV file on the calling thread.
+ * @param buffer The buffer to render the chunks. It is grown as needed, and can be reused by the
+ * next calls on the same thread to avoid allocating the chunks again.
+ * @details The other parameters and the file are the same as the multithreaded version. This is
+ * used to render many files in parallel, one per thread.
+ */
+void render_wav_file(const ToneDataGenerator &generator, std::uint64_t frames_count,
+                     const std::string &path, std::vector<std::uint8_t> &buffer);
+
+/**
+ * @brief Renders many WAV files in parallel, one file per job of a pool.
+ * @param jobs The files to render.
+ * @param pool The pool that runs the jobs.
+ * @return The reports of the jobs, in the order of `jobs`.
+ * @details The jobs are started from the longest, so that a long job does not start last and
+ * leave the other threads idle. Each thread of the pool renders the chunks of its files in a
+ * buffer kept for the whole batch. An error of a job is reported in its report, and does not stop
+ * the other jobs.
+ */
+std::vector<RenderJobReport> render_batch(const std::vector<RenderJob> &jobs,
+                                          WorkStealingPool &pool);
@@ -0,0 +1,336 @@
+/**
+ * @file oscillator.cpp
+ * @brief Oscillator kernels used by `ToneDataGenerator`.
+ */
+
+#include "oscillator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "simd.h"
+#include "wavetable.h"
+
+// Constants.
+constexpr double PI = 3.14159265358979323846;
+constexpr double TWO_PI = 2 * PI;
+constexpr unsigned int PHASOR_LANES = 4;  // Number of phasors rotated in parallel.
+constexpr unsigned int PHASOR_RENORMALIZATION_FRAMES = 4096;  // Frames between the resets.
+constexpr double PHASE_TO_CYCLES = 1.0 / 18446744073709551616.0;  // 2^-64.
+
+namespace {
+
+/**
+ * @brief Converts a phase to cycles centered at 0 (-0.5 to 0.5).
+ */
+double centered_cycles(Phase phase) {
+  return static_cast<double>(static_cast<std::int64_t>(phase)) * PHASE_TO_CYCLES;
+}
+
+/**
+ * @brief Computes `sin(2 * PI * cycle)` for each lane.
+ * @param cycle The phase in cycles. Any value in the range (-2^31, 2^31) is accepted.
+ * @details The phase is folded into [-0.25, 0.25] cycles, using the symmetry of the sine, and
+ * evaluated with the Taylor series up to the 11th order, whose truncation error is 5.7e-8 at the
+ * boundary.
+ */
+simd::Float sin_cycles(simd::Float cycle) {
+  const simd::Float x = cycle - simd::round(cycle);    // [-0.5, 0.5]
+  const simd::Float a = simd::abs(x);                  // [0, 0.5]
+  const simd::Float z = simd::copysign(simd::min(a, simd::set1(0.5f) - a), x);  // [-0.25, 0.25]
+  const simd::Float z2 = z * z;
+  simd::Float p = simd::set1(-15.094642576822990f);
+  p = p * z2 + simd::set1(42.058693944897655f);
+  p = p * z2 + simd::set1(-76.705859753061385f);
+  p = p * z2 + simd::set1(81.605249276075043f);
+  p = p * z2 + simd::set1(-41.341702240399755f);
+  p = p * z2 + simd::set1(6.2831853071795865f);
+  return p * z;
+}
+
+/**
+ * @brief Writes a block of samples of a waveform computed with SIMD instructions.
+ * @param shape A function that returns the values of the waveform for the phases in cycles. Any
+ * value in [-1, 1] is passed.
+ * @details The other parameters and the return value are the same as `render_sine`.
+ */
+template <class Shape>
+Phase render_shape(float *output, unsigned int frames_count, Phase phase, Phase phase_delta,
+                   float amplitude, Shape shape) {
+  // The lanes are offset from a common base phase. The offsets and the base are converted to
+  // cycles in [-0.5, 0.5] before the conversion to float, so that their sum stays in [-1, 1] and
+  // the float phase error stays below 3e-8 cycles.
+  alignas(32) float offsets[simd::width];
+  for (unsigned int k = 0; k < simd::width; ++k) {
+    offsets[k] = static_cast<float>(centered_cycles(k * phase_delta));
+  }
+  const simd::Float lane_offsets = simd::load(offsets);
+  const simd::Float amplitudes = simd::set1(amplitude);
+  const Phase group_delta = simd::width * phase_delta;
+
+  Phase base = phase;
+  unsigned int i = 0;
+  for (; i + simd::width <= frames_count; i += simd::width, base += group_delta) {
+    const simd::Float cycle = simd::set1(static_cast<float>(centered_cycles(base)));
+    simd::store(output + i, shape(cycle + lane_offsets) * amplitudes);
+  }
+  if (i < frames_count) {
+    alignas(32) float tail[simd::width];
+    const simd::Float cycle = simd::set1(static_cast<float>(centered_cycles(base)));
+    simd::store(tail, shape(cycle + lane_offsets) * amplitudes);
+    for (unsigned int k = 0; i < frames_count; ++i, ++k) {
+      output[i] = tail[k];
+    }
+  }
+
+  return phase + frames_count * phase_delta;
+}
+
+/**
+ * @brief Corrections of a discontinuity of the waveform, spread over a sample on each side.
+ */
+struct Residuals {
+  simd::Float after;   // Value after the discontinuity, used as the naive waveform.
+  simd::Float step;    // PolyBLEP residual of a step of +1.
+  simd::Float corner;  // PolyBLAMP residual of a slope change of +1 per sample.
+};
+
+/**
+ * @brief Computes the residuals of a discontinuity for each lane.
+ * @param offset The phase from the discontinuity to the sample in cycles (-0.5 to 0.5).
+ * @param inverse_delta The inverse of the phase advance per sample in cycles.
+ * @details The sample at exactly the discontinuity is treated as after it. `after` is 1 after
+ * and -1 before the discontinuity, so that the naive waveform and the residuals agree there.
+ */
+Residuals discontinuity_residuals(simd::Float offset, simd::Float inverse_delta) {
+  const simd::Float zero = simd::set1(0.0f);
+  const simd::Float half = simd::set1(0.5f);
+  const simd::Float one = simd::set1(1.0f);
+  const simd::Float after = simd::copysign(one, offset);
+  // Distances to the discontinuity in samples. The one on the other side is set to 1 or more,
+  // which contributes nothing.
+  const simd::Float distance_after =
+      (simd::max(offset, zero) + half - half * after) * inverse_delta;
+  const simd::Float distance_before =
+      (simd::max(zero - offset, zero) + half + half * after) * inverse_delta;
+  const simd::Float a = one - simd::min(distance_after, one);
+  const simd::Float b = one - simd::min(distance_before, one);
+  return {after, half * (b * b - a * a), simd::set1(1.0f / 6) * (a * a * a + b * b * b)};
+}
+
+/**
+ * @brief Returns the phase minus the nearest integer (-0.5 to 0.5) for each lane.
+ */
+simd::Float centered(simd::Float cycle) {
+  return cycle - simd::round(cycle);
+}
+
+/**
+ * @brief Band-limited waveform kernels in the form of `OscillatorFunction`.
+ * @details The waveforms have the same phase as the sine: they start at 0 (the square at its
+ * rising edge) and reach their maximum in the first half of the period. The naive waveform is
+ * corrected around the discontinuities with the two-sample polynomial residuals, i.e., PolyBLEP
+ * for the steps and PolyBLAMP for the corners.
+ */
+template <Waveform Shape>
+Phase render_band_limited(float *output, unsigned int frames_count, Phase phase,
+                          Phase phase_delta, float amplitude) {
+  const auto cycle_delta = static_cast<float>(phase_to_cycles(phase_delta));
+  const simd::Float inverse_delta = simd::set1(1.0f / cycle_delta);
+  const simd::Float two = simd::set1(2.0f);
+  const auto shape = [=](simd::Float cycle) {
+    if constexpr (Shape == Waveform::square) {
+      // Steps of +2 at 0 and -2 at 0.5 cycles. The offset from the fall is derived from the
+      // offset from the rise, so that both agree on the side of a sample at 0.5 cycles from them.
+      const Residuals rise = discontinuity_residuals(centered(cycle), inverse_delta);
+      const simd::Float to_fall = centered(cycle) - simd::set1(0.5f) * rise.after;
+      const Residuals fall = discontinuity_residuals(to_fall, inverse_delta);
+      return simd::set1(0.0f) - fall.after + two * (rise.step - fall.step);
+    } else if constexpr (Shape == Waveform::triangle) {
+      // Corners of -8 cycle_delta per sample at 0.25 and +8 cycle_delta at 0.75 cycles.
+      const simd::Float to_peak = centered(cycle - simd::set1(0.25f));
+      const Residuals peak = discontinuity_residuals(to_peak, inverse_delta);
+      const Residuals trough =
+          discontinuity_residuals(centered(cycle - simd::set1(0.75f)), inverse_delta);
+      return simd::set1(1.0f) - simd::set1(4.0f) * simd::abs(to_peak) +
+             simd::set1(8.0f * cycle_delta) * (trough.corner - peak.corner);
+    } else {
+      // A step of -2 at 0.5 cycles.
+      const simd::Float offset = centered(cycle - simd::set1(0.5f));
+      const Residuals fall = discontinuity_residuals(offset, inverse_delta);
+      return two * offset - fall.after - two * fall.step;
+    }
+  };
+  return render_shape(output, frames_count, phase, phase_delta, amplitude, shape);
+}
+
+/**
+ * @brief `render_wavetable` with the sine wavetable, in the form of `OscillatorFunction`.
+ */
+template <unsigned int Size, bool Cubic>
+Phase render_sine_wavetable(float *output, unsigned int frames_count, Phase phase,
+                            Phase phase_delta, float amplitude) {
+  return render_wavetable<Size, Cubic>(SINE_WAVETABLE<Size>, output, frames_count, phase,
+                                       phase_delta, amplitude);
+}
+
+/**
+ * @brief Returns the sine wavetable kernel of the size.
+ */
+template <bool Cubic>
+OscillatorFunction sine_wavetable_function(WavetableSize wavetable_size) {
+  switch (wavetable_size) {
+    case WavetableSize::small:
+      return render_sine_wavetable<static_cast<unsigned int>(WavetableSize::small), Cubic>;
+    case WavetableSize::large:
+      return render_sine_wavetable<static_cast<unsigned int>(WavetableSize::large), Cubic>;
+    default:
+      return render_sine_wavetable<static_cast<unsigned int>(WavetableSize::medium), Cubic>;
+  }
+}
+
+}  // namespace
+
+Phase phase_delta_of(double frequency, double samples_per_second) {
+  // The delta is clamped before the cast, which is undefined out of the range of `Phase`.
+  const double delta = std::ldexp(frequency / samples_per_second, 64);
+  if (!(delta >= 1)) {
+    return 1;
+  }
+  return delta < std::ldexp(1.0, 63) ? static_cast<Phase>(delta) : Phase{1} << 63;
+}
+
+double phase_to_cycles(Phase phase) {
+  return static_cast<double>(phase) * PHASE_TO_CYCLES;
+}
+
+Phase cycles_to_phase(double cycles) {
+  // The fraction is converted in [-0.5, 0.5), so that it fits in `std::int64_t`, and wraps to the
+  // phase. It can be 1.0 after the rounding of a tiny negative value.
+  double fraction = cycles - std::floor(cycles);
+  fraction = fraction >= 0.5 ? fraction - 1.0 : fraction;
+  return static_cast<Phase>(static_cast<std::int64_t>(std::ldexp(fraction, 64)));
+}
+
+Phase render_sine(float *output, unsigned int frames_count, Phase phase, Phase phase_delta,
+                  float amplitude) {
+  return render_shape(output, frames_count, phase, phase_delta, amplitude,
+                      [](simd::Float cycle) { return sin_cycles(cycle); });
+}
+
+Phase render_phasor(float *output, unsigned int frames_count, Phase phase, Phase phase_delta,
+                    float amplitude) {
+  // Lane k produces the samples k, k + PHASOR_LANES, ..., so the lanes are independent of each
+  // other and the loop can be vectorized by the compiler.
+  const double rotation = TWO_PI * centered_cycles(PHASOR_LANES * phase_delta);
+  const double rotation_real = std::cos(rotation);
+  const double rotation_imag = std::sin(rotation);
+  double real[PHASOR_LANES];
+  double imag[PHASOR_LANES];
+
+  for (unsigned int start = 0; start < frames_count; start += PHASOR_RENORMALIZATION_FRAMES) {
+    const unsigned int end = std::min(start + PHASOR_RENORMALIZATION_FRAMES, frames_count);
+
+    // Set the phasors from the exact phase, which removes the accumulated rounding error.
+    for (unsigned int k = 0; k < PHASOR_LANES; ++k) {
+      const double lane_phase = TWO_PI * centered_cycles(phase + (start + k) * phase_delta);
+      real[k] = amplitude * std::cos(lane_phase);
+      imag[k] = amplitude * std::sin(lane_phase);
+    }
+
+    unsigned int i = start;
+    for (; i + PHASOR_LANES <= end; i += PHASOR_LANES) {
+      for (unsigned int k = 0; k < PHASOR_LANES; ++k) {
+        output[i + k] = static_cast<float>(imag[k]);
+        const double next_real = real[k] * rotation_real - imag[k] * rotation_imag;
+        imag[k] = real[k] * rotation_imag + imag[k] * rotation_real;
+        real[k] = next_real;
+      }
+    }
+    for (unsigned int k = 0; i < end; ++i, ++k) {
+      output[i] = static_cast<float>(imag[k]);
+    }
+  }
+
+  return phase + frames_count * phase_delta;
+}
+
+void add_sines(float *left, float *right, unsigned int frames_count, unsigned int voices_count,
+               Phase *phases, const Phase *phase_deltas, const float *left_gains,
+               const float *right_gains) {
+  for (unsigned int voice = 0; voice < voices_count; ++voice) {
+    // The phase is handled in the same way as `render_sine`.
+    const Phase phase_delta = phase_deltas[voice];
+    if (left_gains[voice] == 0 && right_gains[voice] == 0) {
+      phases[voice] += frames_count * phase_delta;
+      continue;
+    }
+    alignas(32) float offsets[simd::width];
+    for (unsigned int k = 0; k < simd::width; ++k) {
+      offsets[k] = static_cast<float>(centered_cycles(k * phase_delta));
+    }
+    const simd::Float lane_offsets = simd::load(offsets);
+    const simd::Float left_gain = simd::set1(left_gains[voice]);
+    const simd::Float right_gain = simd::set1(right_gains[voice]);
+    const Phase group_delta = simd::width * phase_delta;
+
+    Phase base = phases[voice];
+    unsigned int i = 0;
+    for (; i + simd::width <= frames_count; i += simd::width, base += group_delta) {
+      const simd::Float cycle = simd::set1(static_cast<float>(centered_cycles(base)));
+      const simd::Float value = sin_cycles(cycle + lane_offsets);
+      simd::store(left + i, simd::load(left + i) + value * left_gain);
+      simd::store(right + i, simd::load(right + i) + value * right_gain);
+    }
+    if (i < frames_count) {
+      alignas(32) float tail[simd::width];
+      const simd::Float cycle = simd::set1(static_cast<float>(centered_cycles(base)));
+      simd::store(tail, sin_cycles(cycle + lane_offsets));
+      for (unsigned int k = 0; i < frames_count; ++i, ++k) {
+        left[i] += tail[k] * left_gains[voice];
+        right[i] += tail[k] * right_gains[voice];
+      }
+    }
+
+    phases[voice] += frames_count * phase_delta;
+  }
+}
+
+unsigned int frames_until_zero_crossing(Waveform waveform, Phase phase, Phase phase_delta,
+                                        unsigned int limit) {
+  // `mask` is the interval minus 1, and the interval of the previous frame ends
+  // `mask - (previous & mask) + 1` after it. The result is exact for any phase.
+  assert(phase_delta != 0);
+  const Phase mask = waveform == Waveform::sawtooth ? ~Phase{0} : ~Phase{0} >> 1;
+  const Phase previous = phase - phase_delta;
+  const Phase frames = (mask - (previous & mask)) / phase_delta;
+  return frames < limit ? static_cast<unsigned int>(frames) : limit;
+}
+
+OscillatorFunction oscillator_function(Waveform waveform, OscillatorMode mode,
+                                       WavetableSize wavetable_size) {
+  switch (waveform) {
+    case Waveform::square:
+      return render_band_limited<Waveform::square>;
+    case Waveform::triangle:
+      return render_band_limited<Waveform::triangle>;
+    case Waveform::sawtooth:
+      return render_band_limited<Waveform::sawtooth>;
+    default:
+      return oscillator_function(mode, wavetable_size);
+  }
+}
+
+OscillatorFunction oscillator_function(OscillatorMode mode, WavetableSize wavetable_size) {
+  switch (mode) {
+    case OscillatorMode::phasor:
+      return render_phasor;
+    case OscillatorMode::wavetable_linear:
+      return sine_wavetable_function<false>(wavetable_size);
+    case OscillatorMode::wavetable_cubic:
+      return sine_wavetable_function<true>(wavetable_size);
+    default:
+      return render_sine;
+  }
+}
@@ -0,0 +1,211 @@
+/**
+ * @file realtime_thread.cpp
+ * @brief `RealtimeScope` class implementation.
+ */
+
+#include "realtime_thread.h"
+
+#include <cerrno>
+
+#if defined(_WIN32)
+#include <windows.h>
+
+#include <avrt.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#define REALTIME_MXCSR
+#elif defined(_M_ARM64)
+#include <intrin.h>
+#define REALTIME_FPCR
+#elif defined(__aarch64__)
+#define REALTIME_FPCR
+#endif
+
+// Constants.
+#if defined(REALTIME_MXCSR)
+constexpr std::uint32_t FLUSH_DENORMALS_MASK = 0x8040;  // FTZ and DAZ bits of MXCSR.
+#elif defined(REALTIME_FPCR)
+constexpr std::uint32_t FLUSH_DENORMALS_MASK = 1u << 24;  // FZ bit of FPCR.
+#endif
+#if defined(__linux__)
+constexpr int REALTIME_PRIORITY = 20;  // Priority of `SCHED_FIFO` and `SCHED_RR` (1-99).
+constexpr int ELEVATED_NICE = -11;     // Nice value if the real-time scheduling is not allowed.
+#endif
+
+#if defined(REALTIME_MXCSR) || defined(REALTIME_FPCR)
+/**
+ * @brief Helper function to read the floating-point control register of the calling thread.
+ */
+static std::uint32_t get_fp_control() {
+#if defined(REALTIME_MXCSR)
+  return _mm_getcsr();
+#elif defined(_M_ARM64)
+  return static_cast<std::uint32_t>(_ReadStatusReg(ARM64_FPCR));
+#else
+  std::uint64_t fpcr;
+  asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+  return static_cast<std::uint32_t>(fpcr);
+#endif
+}
+
+/**
+ * @brief Helper function to write the floating-point control register of the calling thread.
+ */
+static void set_fp_control(std::uint32_t value) {
+#if defined(REALTIME_MXCSR)
+  _mm_setcsr(value);
+#elif defined(_M_ARM64)
+  _WriteStatusReg(ARM64_FPCR, static_cast<__int64>(value));
+#else
+  asm volatile("msr fpcr, %0" : : "r"(static_cast<std::uint64_t>(value)));
+#endif
+}
+#endif
+
+#if defined(__linux__)
+/**
+ * @brief Helper function to get the thread ID of the calling thread for `setpriority`.
+ */
+static id_t current_thread_id() { return static_cast<id_t>(syscall(SYS_gettid)); }
+
+/**
+ * @brief Helper function to get the priority of the real-time scheduling allowed to the user.
+ * @details `RLIMIT_RTPRIO` limits the priority unless the process has `CAP_SYS_NICE`, so a
+ * nonzero limit below `REALTIME_PRIORITY` is used instead of it.
+ */
+static int realtime_priority() {
+  rlimit limit;
+  if (getrlimit(RLIMIT_RTPRIO, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY &&
+      limit.rlim_cur > 0 && limit.rlim_cur < static_cast<rlim_t>(REALTIME_PRIORITY)) {
+    return static_cast<int>(limit.rlim_cur);
+  }
+  return REALTIME_PRIORITY;
+}
+#endif
+
+RealtimeScope::RealtimeScope(const RealtimeOptions &options) {
+#if defined(_WIN32)
+  if (options.realtime) {
+    DWORD task_index = 0;
+    m_mmcss_task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &task_index);
+    if (m_mmcss_task != NULL) {
+      m_status.scheduling_class = SchedulingClass::mmcss;
+    } else {
+      // MMCSS may be disabled or stopped. Raise the priority of the thread instead.
+      m_previous_priority = GetThreadPriority(GetCurrentThread());
+      if (m_previous_priority != THREAD_PRIORITY_ERROR_RETURN &&
+          SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        m_status.scheduling_class = SchedulingClass::elevated_priority;
+      }
+    }
+  }
+
+  if (options.affinity_mask != 0) {
+    const DWORD_PTR previous =
+        SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(options.affinity_mask));
+    if (previous != 0) {
+      m_previous_affinity = previous;
+      m_status.affinity_applied = true;
+    }
+  }
+#elif defined(__linux__)
+  if (options.realtime) {
+    sched_param param{};
+    m_previous_policy = sched_getscheduler(0);
+    if (m_previous_policy != -1 && sched_getparam(0, &param) == 0) {
+      m_previous_priority = param.sched_priority;
+      // Do not pass the real-time scheduling to the processes created by the thread.
+      param.sched_priority = realtime_priority();
+      if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &param) == 0) {
+        m_status.scheduling_class = SchedulingClass::fifo;
+      } else if (sched_setscheduler(0, SCHED_RR | SCHED_RESET_ON_FORK, &param) == 0) {
+        m_status.scheduling_class = SchedulingClass::round_robin;
+      } else {
+        errno = 0;
+        const int previous_nice = getpriority(PRIO_PROCESS, current_thread_id());
+        if (errno == 0 && previous_nice > ELEVATED_NICE &&
+            setpriority(PRIO_PROCESS, current_thread_id(), ELEVATED_NICE) == 0) {
+          m_previous_priority = previous_nice;
+          m_status.scheduling_class = SchedulingClass::elevated_priority;
+        }
+      }
+    }
+  }
+
+  if (options.affinity_mask != 0) {
+    cpu_set_t previous;
+    CPU_ZERO(&previous);
+    if (sched_getaffinity(0, sizeof(previous), &previous) == 0) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      for (unsigned int i = 0; i < 64; ++i) {
+        if ((options.affinity_mask >> i) & 1) {
+          CPU_SET(i, &cpus);
+        }
+        if (CPU_ISSET(i, &previous)) {
+          m_previous_affinity |= std::uint64_t{1} << i;
+        }
+      }
+      if (sched_setaffinity(0, sizeof(cpus), &cpus) == 0) {
+        m_status.affinity_applied = true;
+      } else {
+        m_previous_affinity = 0;
+      }
+    }
+  }
+#endif
+
+#if defined(REALTIME_MXCSR) || defined(REALTIME_FPCR)
+  if (options.flush_denormals) {
+    m_previous_fp_control = get_fp_control();
+    set_fp_control(m_previous_fp_control | FLUSH_DENORMALS_MASK);
+    m_status.denormals_flushed =
+        (get_fp_control() & FLUSH_DENORMALS_MASK) == FLUSH_DENORMALS_MASK;
+  }
+#endif
+}
+
+RealtimeScope::~RealtimeScope() {
+#if defined(REALTIME_MXCSR) || defined(REALTIME_FPCR)
+  if (m_status.denormals_flushed) {
+    set_fp_control(m_previous_fp_control);
+  }
+#endif
+
+#if defined(_WIN32)
+  if (m_status.affinity_applied) {
+    SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(m_previous_affinity));
+  }
+  if (m_status.scheduling_class == SchedulingClass::mmcss) {
+    AvRevertMmThreadCharacteristics(m_mmcss_task);
+  } else if (m_status.scheduling_class == SchedulingClass::elevated_priority) {
+    SetThreadPriority(GetCurrentThread(), m_previous_priority);
+  }
+#elif defined(__linux__)
+  if (m_status.affinity_applied) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (unsigned int i = 0; i < 64; ++i) {
+      if ((m_previous_affinity >> i) & 1) {
+        CPU_SET(i, &cpus);
+      }
+    }
+    sched_setaffinity(0, sizeof(cpus), &cpus);
+  }
+  if (m_status.scheduling_class == SchedulingClass::fifo ||
+      m_status.scheduling_class == SchedulingClass::round_robin) {
+    sched_param param{};
+    param.sched_priority = m_previous_priority;
+    sched_setscheduler(0, m_previous_policy, &param);
+  } else if (m_status.scheduling_class == SchedulingClass::elevated_priority) {
+    setpriority(PRIO_PROCESS, current_thread_id(), m_previous_priority);
+  }
+#endif
+}
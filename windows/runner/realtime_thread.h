@@ -0,0 +1,79 @@
+/**
+ * @file realtime_thread.h
+ * @brief `RealtimeScope` class declaration.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief The scheduling of a thread obtained by `RealtimeScope`.
+ */
+enum class SchedulingClass {
+  normal,             // The scheduling is unchanged.
+  elevated_priority,  // The priority is raised within the normal scheduling.
+  mmcss,              // The "Pro Audio" task of the Multimedia Class Scheduler Service (Windows).
+  fifo,               // `SCHED_FIFO` (Linux).
+  round_robin,        // `SCHED_RR` (Linux).
+};
+
+/**
+ * @brief The requests to `RealtimeScope`.
+ */
+struct RealtimeOptions {
+  bool realtime = true;             // Request the real-time scheduling.
+  std::uint64_t affinity_mask = 0;  // Bit i to run on the CPU i (0-63), or 0 for any CPU.
+  bool flush_denormals = true;      // Flush denormal floats to zero (FTZ and DAZ).
+};
+
+/**
+ * @brief The result of `RealtimeScope`, i.e., what has actually been applied to the thread.
+ */
+struct RealtimeStatus {
+  SchedulingClass scheduling_class = SchedulingClass::normal;
+  bool affinity_applied = false;   // `true` if `RealtimeOptions::affinity_mask` is in effect.
+  bool denormals_flushed = false;  // `true` if the denormal floats are flushed to zero.
+};
+
+/**
+ * @brief Promotes the calling thread to the real-time scheduling while the object exists.
+ * @details On Windows, the thread joins the "Pro Audio" task of MMCSS, or it gets the time
+ * critical priority if MMCSS is not available. On Linux, `SCHED_FIFO` is tried first, then
+ * `SCHED_RR`, and then a negative nice value. These need `CAP_SYS_NICE` or an `RLIMIT_RTPRIO` /
+ * `RLIMIT_NICE` granted to the user (e.g., by the `audio` group). rtkit is not used, since it
+ * needs D-Bus. Each step that fails is skipped, so the construction does not fail. The previous
+ * scheduling, affinity, and floating-point mode are restored on destruction, which must happen
+ * on the same thread.
+ */
+class RealtimeScope {
+ private:
+  RealtimeStatus m_status;
+
+  // Previous state of the thread.
+  void *m_mmcss_task = nullptr;             // Handle of the MMCSS task (Windows).
+  int m_previous_priority = 0;              // Priority, or nice value on Linux.
+  int m_previous_policy = 0;                // Scheduling policy (Linux).
+  std::uint64_t m_previous_affinity = 0;    // Affinity mask, or 0 if not changed.
+  std::uint32_t m_previous_fp_control = 0;  // MXCSR on x86, FPCR on ARM64.
+
+ public:
+  /**
+   * @brief Construct a new `RealtimeScope` object, and promote the calling thread.
+   * @param options The requests.
+   */
+  explicit RealtimeScope(const RealtimeOptions &options);
+
+  /**
+   * @brief Destroy the `RealtimeScope` object, and restore the calling thread.
+   */
+  ~RealtimeScope();
+
+  RealtimeScope(const RealtimeScope &) = delete;
+  RealtimeScope &operator=(const RealtimeScope &) = delete;
+
+  /**
+   * @brief Returns what has actually been applied to the thread.
+   */
+  const RealtimeStatus &status() const { return m_status; }
+};
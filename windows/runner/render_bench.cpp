@@ -0,0 +1,402 @@
+/**
+ * @file render_bench.cpp
+ * @brief Command line tool to measure the CPU time of the rendering code.
+ * @details The tool does not depend on the Windows API, so it can also be built on other
+ * platforms, e.g., with `g++ -O2 -std=c++17 -mavx2 -mfma -pthread *.cpp` over the sources of the
+ * `binaural_bench` target. Omit `-mavx2 -mfma` to measure the SSE2 build.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "interleave.h"
+#include "oscillator.h"
+#include "tone_data_generator.h"
+#include "voice_bank.h"
+
+namespace {
+
+// Constants.
+constexpr double SAMPLES_PER_SECOND = 48000;
+constexpr unsigned int BUFFER_FRAMES = 480;   // Frames of a buffer (10 ms at 48 kHz).
+constexpr unsigned int RUN_FRAMES = 48000;    // Frames rendered by a run (1 s at 48 kHz).
+constexpr unsigned int RUNS_COUNT = 15;       // Runs of a measurement. The fastest one is used.
+constexpr unsigned int ERROR_TRIALS = 3000;   // Buffers over which the error is measured.
+constexpr double PI = 3.14159265358979323846;
+
+constexpr const char *USAGE = R"(Usage: binaural_bench [SECTION...]
+
+Sections (default: all):
+  interleave
+            The interleave stage of each sample type and channel layout, against the fused
+            per-frame loop.
+  kernels   The render kernels of each sample format and channel layout, against the per-frame
+            loop that they replaced.
+  sine      The sine oscillator modes against std::sin, with their maximum error.
+  voices    The voice bank, and the tone with its pairs layered on it.
+)";
+
+/**
+ * @brief The sample formats measured by the benchmarks.
+ */
+struct SampleFormat {
+  const char *name;
+  unsigned int bits_per_sample;
+  bool is_float;
+};
+
+constexpr SampleFormat FORMATS[] = {
+    {"8-bit", 8, false},   {"16-bit", 16, false}, {"24-bit", 24, false},
+    {"32-bit", 32, false}, {"float", 32, true},
+};
+
+constexpr unsigned int CHANNEL_LAYOUTS[] = {2, 6, 8};
+
+constexpr unsigned int VOICE_COUNTS[] = {8, 64, 256};
+
+/**
+ * @brief Keeps the results of the benchmarks observable, so that they are not optimized away.
+ */
+volatile std::uint8_t g_sink;
+
+/**
+ * @brief Measures a render function.
+ * @param render A function that renders `BUFFER_FRAMES` frames to the buffer.
+ * @param buffer The buffer passed to `render`.
+ * @return The CPU time per frame in nanoseconds, of the fastest of `RUNS_COUNT` runs.
+ */
+template <class Render>
+double measure(Render &&render, std::vector<std::uint8_t> &buffer) {
+  double best = INFINITY;
+  for (unsigned int run = 0; run < RUNS_COUNT; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned int frames = 0; frames < RUN_FRAMES; frames += BUFFER_FRAMES) {
+      render(buffer.data());
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / RUN_FRAMES);
+    g_sink = buffer[buffer.size() / 2];
+  }
+  return best;
+}
+
+/**
+ * @brief The per-frame loop of `write_tone_data` before the kernels were specialized.
+ * @details Each frame computes `std::sin` in double precision and branches on the sample format
+ * and the extra channels. It supports the formats of that version: 8-bit, 16-bit, and float.
+ */
+struct ReferenceGenerator {
+  double left_amplitude = 1.0;
+  double right_amplitude = 1.0;
+  double left_frequency = 440.0;
+  double right_frequency = 444.0;
+  unsigned int bits_per_sample = 16;
+  double samples_per_second = SAMPLES_PER_SECOND;
+  unsigned int channels_count = 2;
+  double left_phase = 0.0;
+  double right_phase = 0.0;
+
+  void write_tone_data(std::uint8_t *buffer, unsigned int frames_count) {
+    const double left_phase_delta = 2 * PI * left_frequency / samples_per_second;
+    const double right_phase_delta = 2 * PI * right_frequency / samples_per_second;
+    for (unsigned int i = 0; i < frames_count; ++i) {
+      const double left_value = left_amplitude * std::sin(left_phase);
+      const double right_value = right_amplitude * std::sin(right_phase);
+      if (bits_per_sample == 8) {
+        std::uint8_t *wave_data = buffer;
+        wave_data[i * channels_count] = static_cast<std::uint8_t>(left_value * 127 + 128);
+        wave_data[i * channels_count + 1] = static_cast<std::uint8_t>(right_value * 127 + 128);
+        for (unsigned int j = 2; j < channels_count; ++j) {
+          wave_data[i * channels_count + j] = 128;
+        }
+      } else if (bits_per_sample == 16) {
+        auto *wave_data = reinterpret_cast<std::int16_t *>(buffer);
+        wave_data[i * channels_count] = static_cast<std::int16_t>(left_value * 32767);
+        wave_data[i * channels_count + 1] = static_cast<std::int16_t>(right_value * 32767);
+        for (unsigned int j = 2; j < channels_count; ++j) {
+          wave_data[i * channels_count + j] = 0;
+        }
+      } else {
+        auto *wave_data = reinterpret_cast<float *>(buffer);
+        wave_data[i * channels_count] = static_cast<float>(left_value);
+        wave_data[i * channels_count + 1] = static_cast<float>(right_value);
+        for (unsigned int j = 2; j < channels_count; ++j) {
+          wave_data[i * channels_count + j] = 0.0f;
+        }
+      }
+      left_phase += left_phase_delta;
+      right_phase += right_phase_delta;
+      while (left_phase >= 2 * PI) {
+        left_phase -= 2 * PI;
+      }
+      while (right_phase >= 2 * PI) {
+        right_phase -= 2 * PI;
+      }
+    }
+  }
+};
+
+/**
+ * @brief Measures `interleave` and `interleave_fused` for a sample type and a channel layout.
+ * @return The CPU times per frame in nanoseconds of `interleave_fused` and `interleave`.
+ */
+template <class Sample, unsigned int Channels>
+std::pair<double, double> measure_interleave(Sample silence) {
+  // Random planar samples, interleaved in blocks as `write_tone_data` does.
+  std::vector<Sample> left(BUFFER_FRAMES);
+  std::vector<Sample> right(BUFFER_FRAMES);
+  std::mt19937 random(1);
+  for (std::vector<Sample> *samples : {&left, &right}) {
+    for (Sample &sample : *samples) {
+      const std::uint32_t bits = random();
+      std::memcpy(&sample, &bits, sizeof(Sample));
+    }
+  }
+  std::vector<std::uint8_t> buffer(BUFFER_FRAMES * Channels * sizeof(Sample));
+  using Stage = void (*)(const Sample *, const Sample *, Sample *, unsigned int, unsigned int,
+                         Sample);
+  const auto measure_stage = [&](Stage function) {
+    // The stage is called through a volatile pointer, so that it is not inlined into the loop,
+    // as it is not in `write_tone_data`, and its stores are not removed as redundant.
+    Stage volatile stage = function;
+    return measure(
+        [&](std::uint8_t *data) {
+          auto *output = reinterpret_cast<Sample *>(data);
+          for (unsigned int start = 0; start < BUFFER_FRAMES; start += MAX_INTERLEAVE_FRAMES) {
+            stage(left.data() + start, right.data() + start, output + start * Channels,
+                  std::min(MAX_INTERLEAVE_FRAMES, BUFFER_FRAMES - start), Channels, silence);
+          }
+        },
+        buffer);
+  };
+  const double fused = measure_stage(&interleave_fused<Sample, Channels>);
+  const double stage = measure_stage(&interleave<Sample, Channels>);
+  return {fused, stage};
+}
+
+/**
+ * @brief Measures the interleave stage of a sample type for each channel layout.
+ */
+template <class Sample>
+void bench_interleave_sample(const char *name, Sample silence) {
+  std::cout << "  " << std::left << std::setw(7) << name << std::right;
+  for (auto [channels, times] : {std::pair{2u, measure_interleave<Sample, 2>(silence)},
+                                 std::pair{6u, measure_interleave<Sample, 6>(silence)},
+                                 std::pair{8u, measure_interleave<Sample, 8>(silence)}}) {
+    std::cout << "  " << channels << "ch " << std::setw(5) << times.first << " -> "
+              << std::setw(5) << times.second;
+  }
+  std::cout << "\n";
+}
+
+/**
+ * @brief Measures the interleave stage of `write_tone_data` for each sample type and channel
+ * layout, against the fused per-frame loop.
+ */
+void bench_interleave() {
+  std::cout << "Interleave stage, ns per frame (fused -> stage):\n";
+  bench_interleave_sample<std::uint8_t>("8-bit", 128);
+  bench_interleave_sample<std::int16_t>("16-bit", 0);
+  bench_interleave_sample<Int24>("24-bit", Int24{});
+  bench_interleave_sample<std::int32_t>("32-bit", 0);
+  bench_interleave_sample<float>("float", 0.0f);
+}
+
+/**
+ * @brief Measures `write_tone_data` for each sample format and channel layout.
+ * @details The loop playback is disabled, so that every buffer is synthesized. "before" is the
+ * per-frame loop of `ReferenceGenerator`, which has no 24-bit and 32-bit integer formats.
+ */
+void bench_kernels() {
+  std::cout << "Render kernels, ns per frame (before -> after):\n";
+  for (const SampleFormat &format : FORMATS) {
+    std::cout << "  " << std::left << std::setw(7) << format.name << std::right;
+    for (unsigned int channels : CHANNEL_LAYOUTS) {
+      std::vector<std::uint8_t> buffer(BUFFER_FRAMES * channels * format.bits_per_sample / 8);
+
+      ToneDataGenerator generator;
+      generator.left_amplitude = generator.right_amplitude = 1.0;
+      generator.left_frequency = 440.0;
+      generator.right_frequency = 444.0;
+      generator.samples_per_second = SAMPLES_PER_SECOND;
+      generator.bits_per_sample = format.bits_per_sample;
+      generator.is_float = format.is_float;
+      generator.channels_count = channels;
+      generator.loop_playback = false;
+      const double after = measure(
+          [&](std::uint8_t *data) { generator.write_tone_data(data, BUFFER_FRAMES, false); },
+          buffer);
+
+      std::cout << "  " << channels << "ch ";
+      if (format.bits_per_sample == 8 || format.bits_per_sample == 16 || format.is_float) {
+        ReferenceGenerator reference;
+        reference.bits_per_sample = format.bits_per_sample;
+        reference.channels_count = channels;
+        const double before = measure(
+            [&](std::uint8_t *data) { reference.write_tone_data(data, BUFFER_FRAMES); }, buffer);
+        std::cout << std::setw(6) << before;
+      } else {
+        std::cout << std::setw(6) << "-";
+      }
+      std::cout << " -> " << std::setw(5) << after;
+    }
+    std::cout << "\n";
+  }
+}
+
+/**
+ * @brief Measures the sine oscillators of each `OscillatorMode` against `std::sin`.
+ * @details "std::sin" is a phase accumulated in double precision and `std::sin` per frame, as the
+ * oscillator before the SIMD kernels. The maximum absolute error is measured over `ERROR_TRIALS`
+ * buffers at random phases and deltas (up to half a cycle) against `std::sin` in long double
+ * precision at the exact phases.
+ */
+void bench_sine() {
+  std::vector<std::uint8_t> buffer(BUFFER_FRAMES * sizeof(float));
+  auto *values = reinterpret_cast<float *>(buffer.data());
+
+  double phase = 0.0;
+  const double phase_delta = 2 * PI * 440.0 / SAMPLES_PER_SECOND;
+  const double reference_time = measure(
+      [&](std::uint8_t *) {
+        for (unsigned int i = 0; i < BUFFER_FRAMES; ++i) {
+          values[i] = static_cast<float>(std::sin(phase));
+          phase += phase_delta;
+          if (phase >= 2 * PI) {
+            phase -= 2 * PI;
+          }
+        }
+      },
+      buffer);
+  std::cout << "Sine oscillators, ns per frame and maximum error against std::sin:\n"
+            << "  " << std::left << std::setw(17) << "std::sin" << std::right << std::setw(6)
+            << reference_time << "\n";
+
+  const std::pair<const char *, OscillatorFunction> oscillators[] = {
+      {"polynomial", oscillator_function(OscillatorMode::polynomial)},
+      {"phasor", oscillator_function(OscillatorMode::phasor)},
+      {"wavetable linear", oscillator_function(OscillatorMode::wavetable_linear)},
+      {"wavetable cubic", oscillator_function(OscillatorMode::wavetable_cubic)},
+  };
+  for (const auto &[name, render] : oscillators) {
+    Phase oscillator_phase = 0;
+    const Phase oscillator_delta = phase_delta_of(440.0, SAMPLES_PER_SECOND);
+    const double time = measure(
+        [&](std::uint8_t *data) {
+          oscillator_phase = render(reinterpret_cast<float *>(data), BUFFER_FRAMES,
+                                    oscillator_phase, oscillator_delta, 1.0f);
+        },
+        buffer);
+
+    std::mt19937_64 random(1);
+    long double max_error = 0;
+    for (unsigned int trial = 0; trial < ERROR_TRIALS; ++trial) {
+      const Phase start = random();
+      const Phase delta = random() >> 1;
+      render(values, BUFFER_FRAMES, start, delta, 1.0f);
+      for (unsigned int i = 0; i < BUFFER_FRAMES; ++i) {
+        const long double cycles = std::ldexp(static_cast<long double>(start + i * delta), -64);
+        const long double expected = std::sin(2 * static_cast<long double>(PI) * cycles);
+        max_error = std::max(max_error, std::abs(values[i] - expected));
+      }
+    }
+    std::cout << "  " << std::left << std::setw(17) << name << std::right << std::setw(6) << time
+              << "  " << std::scientific << std::setprecision(1)
+              << static_cast<double>(max_error) << std::fixed << std::setprecision(2) << "\n";
+  }
+}
+
+/**
+ * @brief Measures `VoiceBank` with several numbers of voices, and `write_tone_data` with several
+ * numbers of tone pairs.
+ * @details "voices per core" is the number of voices that would use 100 % of a core in real time
+ * at 48 kHz with 10 ms buffers. The tone is written in float with 2 channels, without the loop.
+ */
+void bench_voices() {
+  std::vector<std::uint8_t> buffer(2 * BUFFER_FRAMES * sizeof(float));
+  auto *left = reinterpret_cast<float *>(buffer.data());
+  float *right = left + BUFFER_FRAMES;
+
+  std::cout << "Voice bank, ns per voice and frame, and voices per core:\n";
+  std::mt19937_64 random(1);
+  std::uniform_real_distribution<double> frequencies(50.0, 1000.0);
+  for (unsigned int voices_count : VOICE_COUNTS) {
+    VoiceBank voices(SAMPLES_PER_SECOND);
+    voices.reserve(voices_count);
+    for (unsigned int i = 0; i < voices_count; ++i) {
+      voices.add_voice(frequencies(random), 1.0f / voices_count, i % 2 == 0 ? -0.5f : 0.5f);
+    }
+    const double time =
+        measure([&](std::uint8_t *) { voices.render(left, right, BUFFER_FRAMES); }, buffer) /
+        voices_count;
+    std::cout << "  " << std::setw(3) << voices_count << " voices " << std::setw(6) << time
+              << std::setw(10) << std::lround(1e9 / (SAMPLES_PER_SECOND * time)) << "\n";
+  }
+
+  std::cout << "Tone with its pairs, ns per frame:\n";
+  for (unsigned int pairs_count : {0u, 1u, 4u, MAX_TONE_PAIRS}) {
+    ToneDataGenerator generator;
+    DeviceFormat format;
+    format.bits_per_sample = 32;
+    format.is_float = true;
+    generator.set_format(format);
+    generator.left_amplitude = generator.right_amplitude = 0.5;
+    generator.left_frequency = 200.0;
+    generator.right_frequency = 204.0;
+    generator.loop_playback = false;
+    for (unsigned int i = 0; i < pairs_count; ++i) {
+      generator.pairs[i] = {0.5 / MAX_TONE_PAIRS, 300.0 + 100 * i, 306.0 + 100 * i};
+    }
+    const double time = measure(
+        [&](std::uint8_t *data) { generator.write_tone_data(data, BUFFER_FRAMES, false); },
+        buffer);
+    std::cout << "  " << pairs_count << (pairs_count == 1 ? " pair  " : " pairs ") << std::setw(6)
+              << time << "\n";
+  }
+}
+
+/**
+ * @brief A section of the benchmark.
+ */
+struct Section {
+  const char *name;
+  void (*run)();
+};
+
+constexpr Section SECTIONS[] = {
+    {"interleave", bench_interleave},
+    {"kernels", bench_kernels},
+    {"sine", bench_sine},
+    {"voices", bench_voices},
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> names(argv + 1, argv + argc);
+  for (const std::string &name : names) {
+    if (std::none_of(std::begin(SECTIONS), std::end(SECTIONS),
+                     [&](const Section &section) { return name == section.name; })) {
+      std::cerr << "Unknown section: " << name << "\n\n" << USAGE;
+      return 2;
+    }
+  }
+
+  std::cout << std::fixed << std::setprecision(2);
+  for (const Section &section : SECTIONS) {
+    if (names.empty() || std::find(names.begin(), names.end(), section.name) != names.end()) {
+      section.run();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,396 @@
+/**
+ * @file render_tool.cpp
+ * @brief Command line tool to render the tone to WAV files without an audio device.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "offline_renderer.h"
+#include "tone_data_generator.h"
+#include "work_stealing_pool.h"
+
+namespace {
+
+constexpr const char *USAGE = R"(Usage: binaural_render [options] output.wav
+       binaural_render --manifest FILE [--output-dir DIR] [--threads COUNT]
+
+Options:
+  --left-frequency HZ      Frequency of the left channel (default: 440).
+  --right-frequency HZ     Frequency of the right channel (default: 440).
+  --left-volume VALUE      Volume of the left channel, 0 to 1 (default: 1).
+  --right-volume VALUE     Volume of the right channel, 0 to 1 (default: 1).
+  --left-waveform NAME     sine, square, triangle, or sawtooth (default: sine).
+  --right-waveform NAME    The same as --left-waveform for the right channel.
+  --white-noise VALUE      Volume of the white noise, 0 to 1 (default: 0).
+  --pink-noise VALUE       Volume of the pink noise, 0 to 1 (default: 0).
+  --brown-noise VALUE      Volume of the brown noise, 0 to 1 (default: 0).
+  --duration SECONDS       Length of the file (default: 60).
+  --rate HZ                Samples per second (default: 48000).
+  --bits BITS              Bits per sample: 8, 16, 24, or 32 (default: 16).
+  --float                  Write 32-bit float samples.
+  --channels COUNT         Number of channels, 2 or more (default: 2).
+  --dither NAME            none, tpdf, or noise_shaped (default: tpdf).
+  --threads COUNT          Number of threads, 0 for all cores (default: 0).
+
+Batch rendering:
+  --manifest FILE          Render every preset of the manifest in every format.
+  --output-dir DIR         Directory of the files of the manifest (default: .).
+
+Each line of the manifest is a format, a preset, or a comment starting with #:
+  format RATE BITS [CHANNELS]   BITS is 8, 16, 24, 32, or float.
+  preset NAME [options]         The options above, except the format options.
+The file of a preset in a format is DIR/NAME_RATE_BITS.wav, or DIR/NAME_RATE_BITS_CHANNELSch.wav
+if CHANNELS is not 2. The files must be distinct.
+)";
+
+/**
+ * @brief Parameters of a file.
+ */
+struct RenderOptions {
+  ToneDataGenerator generator;
+  double duration = 60;  // Length of the file in seconds.
+
+  RenderOptions() {
+    generator.left_frequency = generator.right_frequency = 440;
+    generator.left_amplitude = generator.right_amplitude = 1;
+    generator.samples_per_second = 48000;
+    generator.bits_per_sample = 16;
+    generator.channels_count = 2;
+  }
+};
+
+/**
+ * @brief Options of the tool that are not parameters of a file.
+ */
+struct ToolOptions {
+  unsigned int threads_count = 0;  // Number of threads, 0 for all cores.
+  std::string path;                // Output file, if a single file is rendered.
+  std::string manifest;            // Manifest file, if a batch is rendered.
+  std::string output_dir = ".";    // Directory of the files of the manifest.
+};
+
+/**
+ * @brief Parses a number in the range, or throws `std::invalid_argument`.
+ */
+double parse_number(const std::string &option, const std::string &text, double min, double max) {
+  std::size_t length = 0;
+  double value = 0;
+  try {
+    value = std::stod(text, &length);
+  } catch (const std::exception &) {
+    length = 0;
+  }
+  if (length != text.size() || !(value >= min && value <= max)) {
+    throw std::invalid_argument("Invalid value of " + option + ": " + text);
+  }
+  return value;
+}
+
+/**
+ * @brief Parses one of the names, or throws `std::invalid_argument`.
+ */
+template <class T>
+T parse_name(const std::string &option, const std::string &text,
+             std::initializer_list<std::pair<const char *, T>> names) {
+  for (const auto &[name, value] : names) {
+    if (text == name) {
+      return value;
+    }
+  }
+  throw std::invalid_argument("Invalid value of " + option + ": " + text);
+}
+
+Waveform parse_waveform(const std::string &option, const std::string &text) {
+  return parse_name(option, text,
+                    {std::pair{"sine", Waveform::sine}, std::pair{"square", Waveform::square},
+                     std::pair{"triangle", Waveform::triangle},
+                     std::pair{"sawtooth", Waveform::sawtooth}});
+}
+
+DitherMode parse_dither(const std::string &option, const std::string &text) {
+  return parse_name(option, text,
+                    {std::pair{"none", DitherMode::none}, std::pair{"tpdf", DitherMode::tpdf},
+                     std::pair{"noise_shaped", DitherMode::noise_shaped}});
+}
+
+/**
+ * @brief Sets the sample format, or throws `std::invalid_argument`.
+ * @param bits The bits per sample, or "float".
+ */
+void set_bits(RenderOptions &options, const std::string &option, const std::string &bits) {
+  ToneDataGenerator &generator = options.generator;
+  generator.is_float = bits == "float";
+  generator.bits_per_sample =
+      generator.is_float ? 32 : static_cast<unsigned int>(parse_number(option, bits, 8, 32));
+}
+
+/**
+ * @brief Parses the arguments, or throws `std::invalid_argument`.
+ * @param arguments The arguments to parse.
+ * @param options The parameters of the file set by the arguments.
+ * @param tool_options The options of the tool set by the arguments. If null, the options of the
+ * tool, the output file, and the options of the sample format are not accepted.
+ */
+void parse_arguments(const std::vector<std::string> &arguments, RenderOptions &options,
+                     ToolOptions *tool_options) {
+  ToneDataGenerator &generator = options.generator;
+  for (std::size_t i = 0; i < arguments.size(); ++i) {
+    const std::string &option = arguments[i];
+    const bool is_format_option = option == "--float" || option == "--bits" ||
+                                  option == "--rate" || option == "--channels";
+    if (tool_options == nullptr && is_format_option) {
+      throw std::invalid_argument("The format is given by the format lines: " + option);
+    }
+    if (option == "--float") {
+      set_bits(options, option, "float");
+      continue;
+    }
+    if (option.rfind("--", 0) != 0) {
+      if (tool_options == nullptr || !tool_options->path.empty()) {
+        throw std::invalid_argument("Unexpected argument: " + option);
+      }
+      tool_options->path = option;
+      continue;
+    }
+    if (i + 1 == arguments.size()) {
+      throw std::invalid_argument("Missing value of " + option);
+    }
+    const std::string &value = arguments[++i];
+    if (option == "--left-frequency") {
+      generator.left_frequency = parse_number(option, value, 1e-3, 1e6);
+    } else if (option == "--right-frequency") {
+      generator.right_frequency = parse_number(option, value, 1e-3, 1e6);
+    } else if (option == "--left-volume") {
+      generator.left_amplitude = parse_number(option, value, 0, 1);
+    } else if (option == "--right-volume") {
+      generator.right_amplitude = parse_number(option, value, 0, 1);
+    } else if (option == "--left-waveform") {
+      generator.left_waveform = parse_waveform(option, value);
+    } else if (option == "--right-waveform") {
+      generator.right_waveform = parse_waveform(option, value);
+    } else if (option == "--white-noise") {
+      generator.white_noise_gain = parse_number(option, value, 0, 1);
+    } else if (option == "--pink-noise") {
+      generator.pink_noise_gain = parse_number(option, value, 0, 1);
+    } else if (option == "--brown-noise") {
+      generator.brown_noise_gain = parse_number(option, value, 0, 1);
+    } else if (option == "--duration") {
+      options.duration = parse_number(option, value, 0, 1e7);
+    } else if (option == "--rate") {
+      generator.samples_per_second = parse_number(option, value, 8000, 768000);
+    } else if (option == "--bits") {
+      set_bits(options, option, value);
+    } else if (option == "--channels") {
+      generator.channels_count = static_cast<unsigned int>(parse_number(option, value, 2, 32));
+    } else if (option == "--dither") {
+      generator.dither_mode = parse_dither(option, value);
+    } else if (tool_options != nullptr && option == "--threads") {
+      tool_options->threads_count = static_cast<unsigned int>(parse_number(option, value, 0, 1024));
+    } else if (tool_options != nullptr && option == "--manifest") {
+      tool_options->manifest = value;
+    } else if (tool_options != nullptr && option == "--output-dir") {
+      tool_options->output_dir = value;
+    } else {
+      throw std::invalid_argument("Unknown option: " + option);
+    }
+  }
+}
+
+/**
+ * @brief Checks the combination of the parameters, or throws `std::invalid_argument`.
+ */
+void validate(const RenderOptions &options) {
+  const ToneDataGenerator &generator = options.generator;
+  const unsigned int bits = generator.bits_per_sample;
+  if ((bits != 8 && bits != 16 && bits != 24 && bits != 32) ||
+      (generator.is_float && bits != 32)) {
+    throw std::invalid_argument("Unsupported bits per sample.");
+  }
+  if (generator.left_frequency >= generator.samples_per_second / 2 ||
+      generator.right_frequency >= generator.samples_per_second / 2) {
+    throw std::invalid_argument("Frequencies must be less than half the rate.");
+  }
+}
+
+/**
+ * @brief Returns the number of frames of a file.
+ */
+std::uint64_t frames_count_of(const RenderOptions &options) {
+  return static_cast<std::uint64_t>(
+      std::llround(options.duration * options.generator.samples_per_second));
+}
+
+/**
+ * @brief Reads the manifest and returns the files to render.
+ * @exception `std::invalid_argument` is thrown if the manifest is invalid or two jobs write the
+ * same file, and `std::runtime_error` if it cannot be read.
+ */
+std::vector<RenderJob> read_manifest(const ToolOptions &tool_options) {
+  std::ifstream file(tool_options.manifest);
+  if (!file) {
+    throw std::runtime_error("Failed to read the manifest: " + tool_options.manifest);
+  }
+
+  std::vector<RenderOptions> formats;
+  std::vector<std::pair<std::string, RenderOptions>> presets;
+  std::string line;
+  for (int line_number = 1; std::getline(file, line); ++line_number) {
+    std::istringstream stream(line);
+    std::vector<std::string> words;
+    for (std::string word; stream >> word;) {
+      words.push_back(word);
+    }
+    if (words.empty() || words[0][0] == '#') {
+      continue;
+    }
+
+    try {
+      if (words[0] == "format" && (words.size() == 3 || words.size() == 4)) {
+        RenderOptions format;
+        format.generator.samples_per_second = parse_number("the rate", words[1], 8000, 768000);
+        set_bits(format, "the bits", words[2]);
+        if (words.size() == 4) {
+          format.generator.channels_count =
+              static_cast<unsigned int>(parse_number("the channels", words[3], 2, 32));
+        }
+        formats.push_back(format);
+      } else if (words[0] == "preset" && words.size() >= 2) {
+        RenderOptions preset;
+        parse_arguments(std::vector<std::string>(words.begin() + 2, words.end()), preset,
+                        nullptr);
+        presets.emplace_back(words[1], preset);
+      } else {
+        throw std::invalid_argument("Invalid line: " + line);
+      }
+    } catch (const std::invalid_argument &e) {
+      throw std::invalid_argument(tool_options.manifest + ":" + std::to_string(line_number) +
+                                  ": " + e.what());
+    }
+  }
+
+  std::vector<RenderJob> jobs;
+  std::set<std::string> paths;
+  for (const auto &[name, preset] : presets) {
+    for (const RenderOptions &format : formats) {
+      RenderOptions options = preset;
+      ToneDataGenerator &generator = options.generator;
+      generator.samples_per_second = format.generator.samples_per_second;
+      generator.bits_per_sample = format.generator.bits_per_sample;
+      generator.is_float = format.generator.is_float;
+      generator.channels_count = format.generator.channels_count;
+      try {
+        validate(options);
+      } catch (const std::invalid_argument &e) {
+        throw std::invalid_argument("Preset " + name + ": " + e.what());
+      }
+
+      std::string file_name =
+          name + "_" + std::to_string(std::llround(generator.samples_per_second)) + "_" +
+          (generator.is_float ? "float" : std::to_string(generator.bits_per_sample));
+      if (generator.channels_count != 2) {
+        file_name += "_" + std::to_string(generator.channels_count) + "ch";
+      }
+      const std::filesystem::path path =
+          std::filesystem::path(tool_options.output_dir) / (file_name + ".wav");
+      if (!paths.insert(path.string()).second) {
+        throw std::invalid_argument("Preset " + name + ": The file is written twice: " +
+                                    path.string());
+      }
+      jobs.push_back({generator, frames_count_of(options), path.string()});
+    }
+  }
+  return jobs;
+}
+
+/**
+ * @brief Renders the files of the manifest, and prints the time of each file and the total.
+ * @return The exit code.
+ */
+int render_manifest(const std::vector<RenderJob> &jobs, unsigned int threads_count) {
+  WorkStealingPool pool(threads_count);
+  const auto start = std::chrono::steady_clock::now();
+  const std::vector<RenderJobReport> reports = render_batch(jobs, pool);
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  double rendered_seconds = 0;
+  double busy_seconds = 0;
+  int failures_count = 0;
+  for (std::size_t i = 0; i < jobs.size(); ++i) {
+    const RenderJobReport &report = reports[i];
+    if (!report.error.empty()) {
+      std::cerr << jobs[i].path << ": " << report.error << "\n";
+      ++failures_count;
+      continue;
+    }
+    const double duration =
+        static_cast<double>(jobs[i].frames_count) / jobs[i].generator.samples_per_second;
+    rendered_seconds += duration;
+    busy_seconds += report.seconds;
+    std::cout << jobs[i].path << ": " << duration << " s in " << report.seconds << " s ("
+              << duration / report.seconds << "x real time) on thread " << report.thread << "\n";
+  }
+  std::cout << "Rendered " << jobs.size() - failures_count << " files (" << rendered_seconds
+            << " s) in " << elapsed.count() << " s on " << pool.threads_count() << " threads: "
+            << rendered_seconds / elapsed.count() << "x real time, "
+            << busy_seconds / (elapsed.count() * pool.threads_count()) * 100
+            << "% of the threads busy\n";
+  return failures_count == 0 ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  RenderOptions options;
+  ToolOptions tool_options;
+  std::vector<RenderJob> jobs;
+  try {
+    parse_arguments(std::vector<std::string>(argv + 1, argv + argc), options, &tool_options);
+    if (!tool_options.manifest.empty()) {
+      if (!tool_options.path.empty()) {
+        throw std::invalid_argument("An output file is given with a manifest.");
+      }
+      jobs = read_manifest(tool_options);
+    } else {
+      if (tool_options.path.empty()) {
+        throw std::invalid_argument("No output file is given.");
+      }
+      validate(options);
+    }
+  } catch (const std::invalid_argument &e) {
+    std::cerr << e.what() << "\n\n" << USAGE;
+    return 2;
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+
+  try {
+    if (!tool_options.manifest.empty()) {
+      std::filesystem::create_directories(tool_options.output_dir);
+      return render_manifest(jobs, tool_options.threads_count);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    render_wav_file(options.generator, frames_count_of(options), tool_options.path,
+                    tool_options.threads_count);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Rendered " << options.duration << " s in " << elapsed.count() << " s ("
+              << options.duration / elapsed.count() << "x real time): " << tool_options.path
+              << "\n";
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file ring_buffer.h
+ * @brief `RingBuffer` class.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief A lock-free ring of bytes from a single producer to a single consumer.
+ * @details The producer writes into `write_region` and then advances the tail by `commit`, and
+ * the consumer copies the bytes out by `read`, which advances the head, so neither side waits for
+ * the other. The capacity is set by `reset`, which must not run concurrently with the other
+ * functions. If the capacity is a multiple of a frame size, `write_region` always starts at a
+ * frame boundary. There must be only one producer and one consumer at a time. This class does
+ * not depend on the Windows API.
+ */
+class RingBuffer {
+ private:
+  std::vector<std::uint8_t> m_data;
+  std::size_t m_capacity = 0;
+  alignas(64) std::atomic<std::size_t> m_head{0};  // Bytes read. Written by the consumer.
+  alignas(64) std::atomic<std::size_t> m_tail{0};  // Bytes written. Written by the producer.
+
+ public:
+  RingBuffer() = default;
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  /**
+   * @brief Empties the ring and sets its capacity.
+   * @param capacity The capacity in bytes.
+   * @details Memory is allocated only if the capacity grows beyond the previous ones.
+   */
+  void reset(std::size_t capacity) {
+    m_data.resize(std::max(m_data.size(), capacity));
+    m_capacity = capacity;
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Returns the capacity in bytes.
+   */
+  std::size_t capacity() const { return m_capacity; }
+
+  /**
+   * @brief Returns the bytes that can be read.
+   */
+  std::size_t size() const {
+    return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Returns the contiguous region that can be written. Called by the producer.
+   * @param region The start of the region.
+   * @return The size of the region in bytes. It stops at the end of the storage, so the rest is
+   * returned by the next call after `commit`.
+   */
+  std::size_t write_region(std::uint8_t *&region) {
+    if (m_capacity == 0) {
+      return 0;
+    }
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    const std::size_t space = m_capacity - (tail - m_head.load(std::memory_order_acquire));
+    const std::size_t offset = tail % m_capacity;
+    region = m_data.data() + offset;
+    return std::min(space, m_capacity - offset);
+  }
+
+  /**
+   * @brief Makes the bytes written into `write_region` readable. Called by the producer.
+   */
+  void commit(std::size_t bytes) {
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+  }
+
+  /**
+   * @brief Copies the oldest bytes out of the ring. Called by the consumer.
+   * @param destination The buffer to copy to.
+   * @param bytes The bytes to copy. Must not exceed `size`.
+   */
+  void read(std::uint8_t *destination, std::size_t bytes) {
+    if (bytes == 0) {
+      return;
+    }
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    const std::size_t offset = head % m_capacity;
+    const std::size_t first = std::min(bytes, m_capacity - offset);
+    std::memcpy(destination, m_data.data() + offset, first);
+    std::memcpy(destination + first, m_data.data(), bytes - first);
+    m_head.store(head + bytes, std::memory_order_release);
+  }
+};
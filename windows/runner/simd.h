@@ -0,0 +1,346 @@
+/**
+ * @file simd.h
+ * @brief A thin wrapper of the SIMD instruction sets used by the audio rendering code.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SIMD_NEON
+#endif
+
+/**
+ * @brief Vector of `float` in the widest instruction set enabled at compile time.
+ * @details AVX2 (8 lanes) is used when the compiler targets it (e.g., `/arch:AVX2`), SSE2 (4
+ * lanes) on every x86-64 build, NEON (4 lanes) on ARM64, and a scalar fallback (1 lane)
+ * otherwise. `UInt` is the vector of `std::uint32_t` with the same number of lanes. Only the
+ * operations needed by the rendering code are provided. `store_int16` and `store_uint8` round to
+ * the nearest integer and saturate. `store_int32` rounds to the nearest integer, and the value
+ * must be in the range of `std::int32_t`. `store_interleaved` stores the lanes of `a` and `b`
+ * alternately, i.e., `2 * width` values. `interleave_int16` and `interleave_uint8` interleave
+ * the samples of `a` and `b` that fill a vector of the same size, i.e., `2 * width` 16-bit or
+ * `4 * width` 8-bit samples of each, and store twice as many samples.
+ */
+namespace simd {
+
+#if defined(SIMD_AVX2)
+
+constexpr unsigned int width = 8;
+
+struct Float {
+  __m256 v;
+};
+
+inline Float load(const float *p) { return {_mm256_loadu_ps(p)}; }
+inline void store(float *p, Float a) { _mm256_storeu_ps(p, a.v); }
+inline Float set1(float a) { return {_mm256_set1_ps(a)}; }
+inline Float operator+(Float a, Float b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline Float operator-(Float a, Float b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline Float operator*(Float a, Float b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline Float min(Float a, Float b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline Float abs(Float a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+inline Float copysign(Float magnitude, Float sign) {
+  const __m256 mask = _mm256_set1_ps(-0.0f);
+  return {_mm256_or_ps(_mm256_andnot_ps(mask, magnitude.v), _mm256_and_ps(mask, sign.v))};
+}
+inline Float round(Float a) {
+  return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+}
+inline Float max(Float a, Float b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline void store_int16(std::int16_t *p, Float a) {
+  const __m256i i = _mm256_cvtps_epi32(a.v);
+  const __m128i packed =
+      _mm_packs_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), packed);
+}
+inline void store_int32(std::int32_t *p, Float a) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm256_cvtps_epi32(a.v));
+}
+inline void store_uint8(std::uint8_t *p, Float a) {
+  const __m256i i = _mm256_cvtps_epi32(a.v);
+  const __m128i packed =
+      _mm_packs_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packus_epi16(packed, packed));
+}
+
+struct UInt {
+  __m256i v;
+};
+
+inline UInt load(const std::uint32_t *p) {
+  return {_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))};
+}
+inline void store(std::uint32_t *p, UInt a) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), a.v);
+}
+inline UInt set1(std::uint32_t a) { return {_mm256_set1_epi32(static_cast<int>(a))}; }
+inline UInt operator^(UInt a, UInt b) { return {_mm256_xor_si256(a.v, b.v)}; }
+inline UInt operator|(UInt a, UInt b) { return {_mm256_or_si256(a.v, b.v)}; }
+template <int N>
+inline UInt shift_left(UInt a) {
+  return {_mm256_slli_epi32(a.v, N)};
+}
+template <int N>
+inline UInt shift_right(UInt a) {
+  return {_mm256_srli_epi32(a.v, N)};
+}
+inline Float as_float(UInt a) { return {_mm256_castsi256_ps(a.v)}; }
+inline void store_interleaved(float *p, Float a, Float b) {
+  // The unpacks work within the 128-bit halves, so the halves are reordered before the stores.
+  const __m256 low = _mm256_unpacklo_ps(a.v, b.v);
+  const __m256 high = _mm256_unpackhi_ps(a.v, b.v);
+  _mm256_storeu_ps(p, _mm256_permute2f128_ps(low, high, 0x20));
+  _mm256_storeu_ps(p + 8, _mm256_permute2f128_ps(low, high, 0x31));
+}
+inline void store_interleaved(std::uint32_t *p, UInt a, UInt b) {
+  const __m256i low = _mm256_unpacklo_epi32(a.v, b.v);
+  const __m256i high = _mm256_unpackhi_epi32(a.v, b.v);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm256_permute2x128_si256(low, high, 0x20));
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + 8),
+                      _mm256_permute2x128_si256(low, high, 0x31));
+}
+inline void interleave_int16(const std::int16_t *a, const std::int16_t *b, std::int16_t *p) {
+  const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+  const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+  const __m256i low = _mm256_unpacklo_epi16(x, y);
+  const __m256i high = _mm256_unpackhi_epi16(x, y);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm256_permute2x128_si256(low, high, 0x20));
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + 16),
+                      _mm256_permute2x128_si256(low, high, 0x31));
+}
+inline void interleave_uint8(const std::uint8_t *a, const std::uint8_t *b, std::uint8_t *p) {
+  const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+  const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+  const __m256i low = _mm256_unpacklo_epi8(x, y);
+  const __m256i high = _mm256_unpackhi_epi8(x, y);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm256_permute2x128_si256(low, high, 0x20));
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + 32),
+                      _mm256_permute2x128_si256(low, high, 0x31));
+}
+
+#elif defined(SIMD_SSE2)
+
+constexpr unsigned int width = 4;
+
+struct Float {
+  __m128 v;
+};
+
+inline Float load(const float *p) { return {_mm_loadu_ps(p)}; }
+inline void store(float *p, Float a) { _mm_storeu_ps(p, a.v); }
+inline Float set1(float a) { return {_mm_set1_ps(a)}; }
+inline Float operator+(Float a, Float b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Float operator-(Float a, Float b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Float operator*(Float a, Float b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Float min(Float a, Float b) { return {_mm_min_ps(a.v, b.v)}; }
+inline Float abs(Float a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+inline Float copysign(Float magnitude, Float sign) {
+  const __m128 mask = _mm_set1_ps(-0.0f);
+  return {_mm_or_ps(_mm_andnot_ps(mask, magnitude.v), _mm_and_ps(mask, sign.v))};
+}
+// Valid for |a| < 2^31, which is always the case for the phases handled here.
+inline Float round(Float a) { return {_mm_cvtepi32_ps(_mm_cvtps_epi32(a.v))}; }
+inline Float max(Float a, Float b) { return {_mm_max_ps(a.v, b.v)}; }
+inline void store_int16(std::int16_t *p, Float a) {
+  const __m128i i = _mm_cvtps_epi32(a.v);
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packs_epi32(i, i));
+}
+inline void store_int32(std::int32_t *p, Float a) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_cvtps_epi32(a.v));
+}
+inline void store_uint8(std::uint8_t *p, Float a) {
+  const __m128i i = _mm_packs_epi32(_mm_cvtps_epi32(a.v), _mm_setzero_si128());
+  const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(i, i));
+  std::memcpy(p, &packed, 4);
+}
+
+struct UInt {
+  __m128i v;
+};
+
+inline UInt load(const std::uint32_t *p) {
+  return {_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))};
+}
+inline void store(std::uint32_t *p, UInt a) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), a.v);
+}
+inline UInt set1(std::uint32_t a) { return {_mm_set1_epi32(static_cast<int>(a))}; }
+inline UInt operator^(UInt a, UInt b) { return {_mm_xor_si128(a.v, b.v)}; }
+inline UInt operator|(UInt a, UInt b) { return {_mm_or_si128(a.v, b.v)}; }
+template <int N>
+inline UInt shift_left(UInt a) {
+  return {_mm_slli_epi32(a.v, N)};
+}
+template <int N>
+inline UInt shift_right(UInt a) {
+  return {_mm_srli_epi32(a.v, N)};
+}
+inline Float as_float(UInt a) { return {_mm_castsi128_ps(a.v)}; }
+inline void store_interleaved(float *p, Float a, Float b) {
+  _mm_storeu_ps(p, _mm_unpacklo_ps(a.v, b.v));
+  _mm_storeu_ps(p + 4, _mm_unpackhi_ps(a.v, b.v));
+}
+inline void store_interleaved(std::uint32_t *p, UInt a, UInt b) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_unpacklo_epi32(a.v, b.v));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 4), _mm_unpackhi_epi32(a.v, b.v));
+}
+inline void interleave_int16(const std::int16_t *a, const std::int16_t *b, std::int16_t *p) {
+  const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+  const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_unpacklo_epi16(x, y));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 8), _mm_unpackhi_epi16(x, y));
+}
+inline void interleave_uint8(const std::uint8_t *a, const std::uint8_t *b, std::uint8_t *p) {
+  const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+  const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_unpacklo_epi8(x, y));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 16), _mm_unpackhi_epi8(x, y));
+}
+
+#elif defined(SIMD_NEON)
+
+constexpr unsigned int width = 4;
+
+struct Float {
+  float32x4_t v;
+};
+
+inline Float load(const float *p) { return {vld1q_f32(p)}; }
+inline void store(float *p, Float a) { vst1q_f32(p, a.v); }
+inline Float set1(float a) { return {vdupq_n_f32(a)}; }
+inline Float operator+(Float a, Float b) { return {vaddq_f32(a.v, b.v)}; }
+inline Float operator-(Float a, Float b) { return {vsubq_f32(a.v, b.v)}; }
+inline Float operator*(Float a, Float b) { return {vmulq_f32(a.v, b.v)}; }
+inline Float min(Float a, Float b) { return {vminq_f32(a.v, b.v)}; }
+inline Float abs(Float a) { return {vabsq_f32(a.v)}; }
+inline Float copysign(Float magnitude, Float sign) {
+  return {vbslq_f32(vdupq_n_u32(0x80000000u), sign.v, magnitude.v)};
+}
+inline Float round(Float a) { return {vrndnq_f32(a.v)}; }
+inline Float max(Float a, Float b) { return {vmaxq_f32(a.v, b.v)}; }
+inline void store_int16(std::int16_t *p, Float a) { vst1_s16(p, vqmovn_s32(vcvtnq_s32_f32(a.v))); }
+inline void store_int32(std::int32_t *p, Float a) { vst1q_s32(p, vcvtnq_s32_f32(a.v)); }
+inline void store_uint8(std::uint8_t *p, Float a) {
+  const int16x4_t i = vqmovn_s32(vcvtnq_s32_f32(a.v));
+  std::uint8_t packed[8];
+  vst1_u8(packed, vqmovun_s16(vcombine_s16(i, i)));
+  std::memcpy(p, packed, 4);
+}
+
+struct UInt {
+  uint32x4_t v;
+};
+
+inline UInt load(const std::uint32_t *p) { return {vld1q_u32(p)}; }
+inline void store(std::uint32_t *p, UInt a) { vst1q_u32(p, a.v); }
+inline UInt set1(std::uint32_t a) { return {vdupq_n_u32(a)}; }
+inline UInt operator^(UInt a, UInt b) { return {veorq_u32(a.v, b.v)}; }
+inline UInt operator|(UInt a, UInt b) { return {vorrq_u32(a.v, b.v)}; }
+template <int N>
+inline UInt shift_left(UInt a) {
+  return {vshlq_n_u32(a.v, N)};
+}
+template <int N>
+inline UInt shift_right(UInt a) {
+  return {vshrq_n_u32(a.v, N)};
+}
+inline Float as_float(UInt a) { return {vreinterpretq_f32_u32(a.v)}; }
+inline void store_interleaved(float *p, Float a, Float b) { vst2q_f32(p, {{a.v, b.v}}); }
+inline void store_interleaved(std::uint32_t *p, UInt a, UInt b) { vst2q_u32(p, {{a.v, b.v}}); }
+inline void interleave_int16(const std::int16_t *a, const std::int16_t *b, std::int16_t *p) {
+  vst2q_s16(p, {{vld1q_s16(a), vld1q_s16(b)}});
+}
+inline void interleave_uint8(const std::uint8_t *a, const std::uint8_t *b, std::uint8_t *p) {
+  vst2q_u8(p, {{vld1q_u8(a), vld1q_u8(b)}});
+}
+
+#else
+
+constexpr unsigned int width = 1;
+
+struct Float {
+  float v;
+};
+
+inline Float load(const float *p) { return {*p}; }
+inline void store(float *p, Float a) { *p = a.v; }
+inline Float set1(float a) { return {a}; }
+inline Float operator+(Float a, Float b) { return {a.v + b.v}; }
+inline Float operator-(Float a, Float b) { return {a.v - b.v}; }
+inline Float operator*(Float a, Float b) { return {a.v * b.v}; }
+inline Float min(Float a, Float b) { return {a.v < b.v ? a.v : b.v}; }
+inline Float abs(Float a) { return {std::fabs(a.v)}; }
+inline Float copysign(Float magnitude, Float sign) { return {std::copysign(magnitude.v, sign.v)}; }
+inline Float round(Float a) { return {std::nearbyint(a.v)}; }
+inline Float max(Float a, Float b) { return {a.v > b.v ? a.v : b.v}; }
+inline void store_int16(std::int16_t *p, Float a) {
+  const float rounded = std::nearbyint(a.v);
+  *p = static_cast<std::int16_t>(rounded < -32768.0f ? -32768.0f
+                                 : rounded > 32767.0f ? 32767.0f
+                                                      : rounded);
+}
+inline void store_int32(std::int32_t *p, Float a) {
+  *p = static_cast<std::int32_t>(std::nearbyint(a.v));
+}
+inline void store_uint8(std::uint8_t *p, Float a) {
+  const float rounded = std::nearbyint(a.v);
+  *p = static_cast<std::uint8_t>(rounded < 0.0f ? 0.0f : rounded > 255.0f ? 255.0f : rounded);
+}
+
+struct UInt {
+  std::uint32_t v;
+};
+
+inline UInt load(const std::uint32_t *p) { return {*p}; }
+inline void store(std::uint32_t *p, UInt a) { *p = a.v; }
+inline UInt set1(std::uint32_t a) { return {a}; }
+inline UInt operator^(UInt a, UInt b) { return {a.v ^ b.v}; }
+inline UInt operator|(UInt a, UInt b) { return {a.v | b.v}; }
+template <int N>
+inline UInt shift_left(UInt a) {
+  return {a.v << N};
+}
+template <int N>
+inline UInt shift_right(UInt a) {
+  return {a.v >> N};
+}
+inline Float as_float(UInt a) {
+  float f;
+  std::memcpy(&f, &a.v, sizeof(f));
+  return {f};
+}
+inline void store_interleaved(float *p, Float a, Float b) {
+  p[0] = a.v;
+  p[1] = b.v;
+}
+inline void store_interleaved(std::uint32_t *p, UInt a, UInt b) {
+  p[0] = a.v;
+  p[1] = b.v;
+}
+inline void interleave_int16(const std::int16_t *a, const std::int16_t *b, std::int16_t *p) {
+  for (unsigned int i = 0; i < 2; ++i) {
+    p[2 * i] = a[i];
+    p[2 * i + 1] = b[i];
+  }
+}
+inline void interleave_uint8(const std::uint8_t *a, const std::uint8_t *b, std::uint8_t *p) {
+  for (unsigned int i = 0; i < 4; ++i) {
+    p[2 * i] = a[i];
+    p[2 * i + 1] = b[i];
+  }
+}
+
+#endif
+
+}  // namespace simd
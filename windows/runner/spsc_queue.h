@@ -0,0 +1,68 @@
+/**
+ * @file spsc_queue.h
+ * @brief `SpscQueue` class template.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+
+/**
+ * @brief A bounded lock-free queue from a single producer to a single consumer.
+ * @tparam T The type of the items.
+ * @tparam Capacity The maximum number of items in the queue. Must be a power of 2.
+ * @details The items are stored in a ring. The producer writes the items and then advances the
+ * tail, and the consumer reads the items and then advances the head, so neither side waits for
+ * the other. `push` advances the tail once for all the items given, so the consumer sees either
+ * all of them or none of them. There must be only one producer and one consumer at a time. This
+ * class does not depend on the Windows API.
+ */
+template <class T, std::size_t Capacity>
+class SpscQueue {
+ private:
+  static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0);
+
+  std::array<T, Capacity> m_items;
+  alignas(64) std::atomic<std::size_t> m_head{0};  // Items popped. Written by the consumer.
+  alignas(64) std::atomic<std::size_t> m_tail{0};  // Items pushed. Written by the producer.
+
+ public:
+  SpscQueue() = default;
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  /**
+   * @brief Pushes a range of items at once. Called by the producer.
+   * @return `false` if there is not enough space for all the items. Nothing is pushed then.
+   */
+  template <class Iterator>
+  bool push(Iterator first, Iterator last) {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    const auto count = static_cast<std::size_t>(std::distance(first, last));
+    if (count > Capacity - (tail - m_head.load(std::memory_order_acquire))) {
+      return false;
+    }
+    for (std::size_t i = 0; first != last; ++first, ++i) {
+      m_items[(tail + i) & (Capacity - 1)] = *first;
+    }
+    m_tail.store(tail + count, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Pops the oldest item. Called by the consumer.
+   * @return `false` if the queue is empty.
+   */
+  bool pop(T &item) {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = m_items[head & (Capacity - 1)];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+};
@@ -0,0 +1,309 @@
+/**
+ * @file parameter_handoff_test.cpp
+ * @brief Stress test of the hand-over of `WaveParameters` to the render thread.
+ * @details Several user threads set the parameters at once, serialized by a mutex as the setters
+ * of `ToneGenerator` are, while a render thread applies them as `update_wave_parameters` does and
+ * renders buffers. The test checks that the render thread never sees a torn value, never
+ * allocates memory, and is not delayed by the user threads.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "tone_data_generator.h"
+#include "triple_buffer.h"
+#include "wave_parameters.h"
+
+namespace {
+
+// Constants.
+constexpr unsigned int WRITERS_COUNT = 4;
+constexpr unsigned int WRITES_COUNT = 20000;    // Values published by each writer.
+constexpr unsigned int FRAMES_COUNT = 480;      // Frames of a buffer (10 ms at 48 kHz).
+constexpr unsigned int WARM_UP_BUFFERS = 16;    // Buffers rendered before the checks start.
+constexpr unsigned int CHANNELS_COUNT = 6;      // Channels of the mocked 5.1 device.
+constexpr std::uint32_t CHANNEL_MASK = 0x3f;    // `KSAUDIO_SPEAKER_5POINT1`.
+constexpr unsigned int MAX_BUFFERS = 1000000;   // Buffers whose render time is recorded.
+// Longest time to render 99% of the buffers. It is far above the usual time, so that the test
+// passes on a loaded machine, and it catches a render thread that waits for the writers. The
+// longest time is only reported, since the render thread of the test may be preempted.
+constexpr double MAX_RENDER_TIME = 0.001;
+
+std::atomic<bool> g_counting_allocations{false};
+std::atomic<unsigned int> g_allocations_count{0};
+thread_local bool t_is_render_thread = false;
+
+/**
+ * @brief Returns the parameters published by the `sequence`th write.
+ * @details Every member is derived from `sequence`, so that a torn value can be detected.
+ */
+void make_parameters(unsigned int sequence, WaveParameters &parameters) {
+  const double fraction = (sequence % 100) / 100.0;
+  parameters.left_amplitude = fraction;
+  parameters.right_amplitude = 1.0 - fraction;
+  parameters.left_frequency = 100.0 + sequence % 1000;
+  parameters.right_frequency = parameters.left_frequency + 5.0;
+  // The output without noise and timeline is periodic, and played from the loop.
+  parameters.white_noise_gain = sequence % 4 == 0 ? 0.0 : fraction / 4;
+  parameters.channel_routing = sequence % 2 == 0;
+  for (unsigned int position = 0; position < SPEAKER_POSITIONS_COUNT; ++position) {
+    parameters.left_speaker_gains[position] = fraction;
+    parameters.right_speaker_gains[position] = 1.0 - fraction;
+  }
+  parameters.has_timeline = sequence % 3 == 0;
+  const std::size_t segments_count = sequence % MAX_TIMELINE_SEGMENTS + 1;
+  for (TimelineTrack *track :
+       {&parameters.timeline.left_amplitude, &parameters.timeline.right_amplitude}) {
+    track->start_value = fraction;
+    track->segments.assign(segments_count, {0.01, SegmentShape::linear, fraction});
+  }
+  for (TimelineTrack *track :
+       {&parameters.timeline.left_frequency, &parameters.timeline.right_frequency}) {
+    track->start_value = parameters.left_frequency;
+    track->segments.assign(segments_count, {0.01, SegmentShape::hold, 0.0});
+  }
+  parameters.wave_generation = sequence;
+  parameters.noise_generation = sequence;
+  parameters.timeline_generation = sequence;
+}
+
+/**
+ * @brief Returns `true` if every member of the parameters comes from the same write.
+ */
+bool is_consistent(const WaveParameters &parameters) {
+  const auto sequence = static_cast<unsigned int>(parameters.wave_generation);
+  const double fraction = (sequence % 100) / 100.0;
+  bool consistent = parameters.left_amplitude == fraction &&
+                    parameters.right_amplitude == 1.0 - fraction &&
+                    parameters.left_frequency == 100.0 + sequence % 1000 &&
+                    parameters.right_frequency == parameters.left_frequency + 5.0 &&
+                    parameters.white_noise_gain == (sequence % 4 == 0 ? 0.0 : fraction / 4) &&
+                    parameters.channel_routing == (sequence % 2 == 0) &&
+                    parameters.has_timeline == (sequence % 3 == 0) &&
+                    parameters.noise_generation == sequence &&
+                    parameters.timeline_generation == sequence;
+  for (unsigned int position = 0; position < SPEAKER_POSITIONS_COUNT; ++position) {
+    consistent = consistent && parameters.left_speaker_gains[position] == fraction &&
+                 parameters.right_speaker_gains[position] == 1.0 - fraction;
+  }
+  const std::size_t segments_count = sequence % MAX_TIMELINE_SEGMENTS + 1;
+  for (const TimelineTrack *track :
+       {&parameters.timeline.left_amplitude, &parameters.timeline.right_amplitude,
+        &parameters.timeline.left_frequency, &parameters.timeline.right_frequency}) {
+    consistent = consistent && track->segments.size() == segments_count;
+  }
+  return consistent && parameters.timeline.left_amplitude.segments.back().end_value == fraction;
+}
+
+/**
+ * @brief Writers and a render thread hand the parameters over at once.
+ */
+void test_handoff() {
+  std::mutex mutex;
+  WaveParameters parameters;
+  TripleBuffer<WaveParameters> parameter_buffer;
+  std::atomic<unsigned int> sequence{0};
+  std::atomic<unsigned int> running_writers_count{WRITERS_COUNT};
+
+  std::vector<std::thread> writers;
+  for (unsigned int i = 0; i < WRITERS_COUNT; ++i) {
+    writers.emplace_back([&] {
+      for (unsigned int write = 0; write < WRITES_COUNT; ++write) {
+        std::lock_guard<std::mutex> lock(mutex);
+        make_parameters(++sequence, parameters);
+        parameter_buffer.back() = parameters;
+        parameter_buffer.publish();
+      }
+      --running_writers_count;
+    });
+  }
+
+  ToneDataGenerator generator;
+  DeviceFormat format;
+  format.bits_per_sample = 32;
+  format.is_float = true;
+  format.channels_count = CHANNELS_COUNT;
+  generator.set_format(format);
+  generator.reserve_timeline(MAX_TIMELINE_SEGMENTS);
+  std::vector<std::uint8_t> buffer(FRAMES_COUNT * CHANNELS_COUNT * sizeof(float));
+
+  unsigned int buffers_count = 0;
+  unsigned int torn_count = 0;
+  unsigned int values_count = 0;
+  std::uint64_t applied_generation = 0;
+  std::vector<double> render_times;
+  render_times.reserve(MAX_BUFFERS);
+  t_is_render_thread = true;
+  while (running_writers_count != 0) {
+    if (buffers_count == WARM_UP_BUFFERS) {
+      g_counting_allocations = true;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    if (parameter_buffer.update()) {
+      const WaveParameters &front = parameter_buffer.front();
+      ++values_count;
+      if (!is_consistent(front)) {
+        ++torn_count;
+      }
+      if (front.wave_generation != applied_generation) {
+        generator.left_amplitude = front.left_amplitude;
+        generator.right_amplitude = front.right_amplitude;
+        generator.left_frequency = front.left_frequency;
+        generator.right_frequency = front.right_frequency;
+        generator.white_noise_gain = front.white_noise_gain;
+        if (front.has_timeline) {
+          generator.start_timeline(front.timeline);
+        } else {
+          generator.stop_timeline();
+        }
+        applied_generation = front.wave_generation;
+      }
+      apply_channel_routing(front, CHANNEL_MASK, generator);
+    }
+    generator.write_tone_data(buffer.data(), FRAMES_COUNT, false);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (buffers_count >= WARM_UP_BUFFERS && render_times.size() < MAX_BUFFERS) {
+      render_times.push_back(elapsed.count());
+    }
+    ++buffers_count;
+  }
+  g_counting_allocations = false;
+  t_is_render_thread = false;
+  for (std::thread &writer : writers) {
+    writer.join();
+  }
+
+  EXPECT(!render_times.empty());
+  EXPECT(values_count > 0);
+  EXPECT(torn_count == 0);
+  EXPECT(g_allocations_count == 0);
+  if (render_times.empty()) {
+    return;
+  }
+  std::sort(render_times.begin(), render_times.end());
+  const double percentile_time = render_times[render_times.size() * 99 / 100];
+  std::cout << "  " << buffers_count << " buffers, " << values_count << " values, render time "
+            << render_times[render_times.size() / 2] * 1e6 << " us median, "
+            << percentile_time * 1e6 << " us 99th percentile, " << render_times.back() * 1e6
+            << " us at most\n";
+  EXPECT(percentile_time < MAX_RENDER_TIME);
+}
+
+/**
+ * @brief Applying the routing maps the speaker positions to the channels of the device.
+ */
+void test_channel_routing() {
+  ToneDataGenerator generator;
+  generator.channels_count = 4;
+  WaveParameters parameters;
+  parameters.channel_routing = true;
+  for (unsigned int position = 0; position < SPEAKER_POSITIONS_COUNT; ++position) {
+    parameters.left_speaker_gains[position] = position / 100.0;
+    parameters.right_speaker_gains[position] = 1.0 - position / 100.0;
+  }
+
+  // Front left, front right, back left, and back right.
+  apply_channel_routing(parameters, 0x33, generator);
+  EXPECT(generator.channel_routing);
+  const unsigned int positions[] = {0, 1, 4, 5};
+  for (unsigned int channel = 0; channel < 4; ++channel) {
+    EXPECT_NEAR(generator.left_channel_gains[channel], positions[channel] / 100.0, 1e-6);
+    EXPECT_NEAR(generator.right_channel_gains[channel], 1.0 - positions[channel] / 100.0, 1e-6);
+  }
+  EXPECT(generator.left_channel_gains[4] == 0.0f);
+
+  // Without a channel mask, the channel `i` is the position `i`.
+  apply_channel_routing(parameters, 0, generator);
+  EXPECT_NEAR(generator.left_channel_gains[2], 0.02, 1e-6);
+
+  parameters.channel_routing = false;
+  apply_channel_routing(parameters, 0x33, generator);
+  EXPECT(!generator.channel_routing);
+  EXPECT(generator.left_channel_gains[0] == 0.0f);
+}
+
+/**
+ * @brief The loop is played only if the common period of the frequencies is a second or less,
+ * and it does not allocate memory in either case.
+ */
+void test_loop_periods() {
+  // 440 Hz and 445 Hz have the periods of 1,200 and 9,600 frames, and a common period of 9,600
+  // frames. 46.875 Hz and 21.504 Hz have the periods of 1,024 and 15,625 frames, but a common
+  // period of 16,000,000 frames (333 s).
+  const double frequencies[][2] = {{440.0, 445.0}, {46.875, 21.504}};
+  constexpr unsigned int buffers_count = 300;  // 3 s, longer than the loops.
+  for (const auto &[left_frequency, right_frequency] : frequencies) {
+    DeviceFormat format;
+    format.bits_per_sample = 32;
+    format.is_float = true;
+    ToneDataGenerator looped;
+    EXPECT(looped.set_format(format));
+    ToneDataGenerator synthesized;
+    EXPECT(synthesized.set_format(format));
+    synthesized.loop_playback = false;
+    for (ToneDataGenerator *generator : {&looped, &synthesized}) {
+      generator->left_amplitude = generator->right_amplitude = 0.5;
+      generator->left_frequency = left_frequency;
+      generator->right_frequency = right_frequency;
+      generator->smoothing_time = 0;
+    }
+
+    std::vector<std::uint8_t> looped_buffer(2 * FRAMES_COUNT * sizeof(float));
+    std::vector<std::uint8_t> synthesized_buffer(looped_buffer.size());
+    double max_error = 0;
+    g_allocations_count = 0;
+    t_is_render_thread = true;
+    for (unsigned int i = 0; i < buffers_count; ++i) {
+      g_counting_allocations = true;
+      looped.write_tone_data(looped_buffer.data(), FRAMES_COUNT, false);
+      g_counting_allocations = false;
+      synthesized.write_tone_data(synthesized_buffer.data(), FRAMES_COUNT, false);
+      for (std::size_t j = 0; j < looped_buffer.size(); j += sizeof(float)) {
+        float looped_sample;
+        float synthesized_sample;
+        std::memcpy(&looped_sample, &looped_buffer[j], sizeof(float));
+        std::memcpy(&synthesized_sample, &synthesized_buffer[j], sizeof(float));
+        max_error = std::max(max_error, std::abs(double{looped_sample} - synthesized_sample));
+      }
+    }
+    t_is_render_thread = false;
+    EXPECT(g_allocations_count == 0);
+    EXPECT(max_error < 1e-5);
+  }
+}
+
+}  // namespace
+
+// Counts the allocations of the render thread.
+void *operator new(std::size_t size) {
+  if (t_is_render_thread && g_counting_allocations) {
+    ++g_allocations_count;
+  }
+  if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+
+int main() {
+  return test::run({
+      {"handoff", test_handoff},
+      {"channel_routing", test_channel_routing},
+      {"loop_periods", test_loop_periods},
+  });
+}
@@ -0,0 +1,119 @@
+/**
+ * @file phase_test.cpp
+ * @brief Tests of the phases of the tone: their range, and their accuracy over a long session.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "oscillator.h"
+#include "test.h"
+#include "tone_data_generator.h"
+
+namespace {
+
+// Constants.
+constexpr double SAMPLES_PER_SECOND = 48000;
+constexpr unsigned int FRAMES_COUNT = 4800;
+constexpr std::uint64_t SESSION_FRAMES = 8ull * 60 * 60 * 48000;  // 8 hours at 48 kHz.
+// The frequencies are `numerator / FREQUENCY_DENOMINATOR` Hz, so that the exact phase of any frame
+// can be computed in integers. They are not periodic within a second, so the loop is not used.
+constexpr std::int64_t FREQUENCY_DENOMINATOR = 10000;
+constexpr std::int64_t LEFT_NUMERATOR = 2000371;   // 200.0371 Hz.
+constexpr std::int64_t RIGHT_NUMERATOR = 2074129;  // 207.4129 Hz, a beat of 7.3758 Hz.
+constexpr double PI = 3.14159265358979323846;
+
+/**
+ * @brief Returns the exact value of a sine wave at a frame.
+ * @details The cycles are `numerator * frame / (FREQUENCY_DENOMINATOR * SAMPLES_PER_SECOND)`,
+ * whose fraction is computed exactly in integers.
+ */
+double exact_sine(std::int64_t numerator, std::uint64_t frame) {
+  const auto denominator = FREQUENCY_DENOMINATOR * static_cast<std::int64_t>(SAMPLES_PER_SECOND);
+  const std::int64_t remainder = numerator * static_cast<std::int64_t>(frame) % denominator;
+  return std::sin(2 * PI * static_cast<double>(remainder) / static_cast<double>(denominator));
+}
+
+/**
+ * @brief Returns a float generator of two channels without ramps or the loop.
+ */
+ToneDataGenerator make_generator(double left_frequency, double right_frequency) {
+  DeviceFormat format;
+  format.bits_per_sample = 32;
+  format.is_float = true;
+  format.samples_per_second = SAMPLES_PER_SECOND;
+  ToneDataGenerator generator;
+  EXPECT(generator.set_format(format));
+  generator.left_amplitude = generator.right_amplitude = 1.0;
+  generator.left_frequency = left_frequency;
+  generator.right_frequency = right_frequency;
+  generator.dither_mode = DitherMode::none;
+  generator.smoothing_time = 0;
+  generator.loop_playback = false;
+  return generator;
+}
+
+/**
+ * @brief The phase delta is clamped from the resolution to the Nyquist frequency.
+ */
+void test_phase_delta_range() {
+  EXPECT(phase_delta_of(1000, SAMPLES_PER_SECOND) ==
+         static_cast<Phase>(std::ldexp(1000 / SAMPLES_PER_SECOND, 64)));
+  EXPECT(phase_delta_of(1e-16, SAMPLES_PER_SECOND) == 1);
+  EXPECT(phase_delta_of(0, SAMPLES_PER_SECOND) == 1);
+  EXPECT(phase_delta_of(-1, SAMPLES_PER_SECOND) == 1);
+  EXPECT(phase_delta_of(std::numeric_limits<double>::quiet_NaN(), SAMPLES_PER_SECOND) == 1);
+  EXPECT(phase_delta_of(SAMPLES_PER_SECOND / 2, SAMPLES_PER_SECOND) == Phase{1} << 63);
+  EXPECT(phase_delta_of(SAMPLES_PER_SECOND, SAMPLES_PER_SECOND) == Phase{1} << 63);
+  EXPECT(phase_delta_of(1e300, SAMPLES_PER_SECOND) == Phase{1} << 63);
+}
+
+/**
+ * @brief Stopping a tone whose phase delta rounds to 0 ends at the limit instead of dividing by 0.
+ */
+void test_stop_at_resolution() {
+  ToneDataGenerator generator = make_generator(1e-16, SAMPLES_PER_SECOND * 2);
+  std::vector<std::uint8_t> buffer(FRAMES_COUNT * 2 * sizeof(float));
+  generator.write_tone_data(buffer.data(), FRAMES_COUNT, false);
+  generator.write_tone_data(buffer.data(), FRAMES_COUNT, true);
+  EXPECT(!generator.is_silent);
+}
+
+/**
+ * @brief After 8 hours, the samples and the beat are those of the exact phases.
+ * @details The phase advances in integers, so it does not drift. The frequencies are rounded to
+ * the resolution of the phase (2.6e-15 Hz), which moves the phase by 1e-10 cycles in 8 hours.
+ */
+void test_long_session() {
+  ToneDataGenerator generator =
+      make_generator(static_cast<double>(LEFT_NUMERATOR) / FREQUENCY_DENOMINATOR,
+                     static_cast<double>(RIGHT_NUMERATOR) / FREQUENCY_DENOMINATOR);
+  std::vector<std::uint8_t> buffer(FRAMES_COUNT * 2 * sizeof(float));
+  for (std::uint64_t frame = 0; frame < SESSION_FRAMES; frame += FRAMES_COUNT) {
+    generator.write_tone_data(buffer.data(), FRAMES_COUNT, false);
+  }
+
+  generator.write_tone_data(buffer.data(), FRAMES_COUNT, false);
+  double max_error = 0.0;
+  for (unsigned int i = 0; i < FRAMES_COUNT; ++i) {
+    float samples[2];
+    std::memcpy(samples, buffer.data() + i * sizeof(samples), sizeof(samples));
+    const std::uint64_t frame = SESSION_FRAMES + i;
+    max_error = std::fmax(max_error, std::abs(samples[0] - exact_sine(LEFT_NUMERATOR, frame)));
+    max_error = std::fmax(max_error, std::abs(samples[1] - exact_sine(RIGHT_NUMERATOR, frame)));
+  }
+  EXPECT(max_error < 1e-5);
+}
+
+}  // namespace
+
+int main() {
+  return test::run({
+      {"phase_delta_range", test_phase_delta_range},
+      {"stop_at_resolution", test_stop_at_resolution},
+      {"long_session", test_long_session},
+  });
+}
@@ -0,0 +1,313 @@
+/**
+ * @file sample_format_test.cpp
+ * @brief Tests of the sample formats written by `ToneDataGenerator`.
+ * @details The devices are mocked by their format descriptors, as `GetMixFormat` returns them.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "dsp.h"
+#include "test.h"
+#include "tone_data_generator.h"
+
+namespace {
+
+// Constants.
+constexpr double SAMPLES_PER_SECOND = 48000;
+constexpr unsigned int FRAMES_COUNT = 480;
+constexpr double LEFT_FREQUENCY = 1000;
+constexpr double RIGHT_FREQUENCY = 1003;
+constexpr double PI = 3.14159265358979323846;
+
+/**
+ * @brief A mocked device.
+ */
+struct MockDevice {
+  const char *name;
+  DeviceFormat format;
+};
+
+const MockDevice DEVICES[] = {
+    {"8-bit", {8, 0, false}},
+    {"16-bit", {16, 0, false}},
+    {"24-bit packed", {24, 0, false}},
+    {"20-bit packed in 24", {24, 20, false}},
+    {"24-bit in 32", {32, 24, false}},
+    {"20-bit in 32", {32, 20, false}},
+    {"32-bit", {32, 32, false}},
+    {"float", {32, 0, true}},
+};
+
+/**
+ * @brief Returns the bits of a sample that hold the data, or 0 for floats.
+ * @details The samples are computed in single precision, so 32-bit integers have 24 valid bits.
+ */
+unsigned int data_bits_of(const DeviceFormat &format) {
+  if (format.is_float) {
+    return 0;
+  }
+  const unsigned int valid_bits =
+      format.valid_bits_per_sample != 0 ? format.valid_bits_per_sample : format.bits_per_sample;
+  return valid_bits < 24 ? valid_bits : 24;
+}
+
+/**
+ * @brief Returns a sample of the buffer as it is stored, sign-extended.
+ */
+std::int64_t raw_sample(const std::vector<std::uint8_t> &buffer, const DeviceFormat &format,
+                        std::size_t index) {
+  const std::uint8_t *p = buffer.data() + index * format.bits_per_sample / 8;
+  switch (format.bits_per_sample) {
+    case 8:
+      return *p;
+    case 16: {
+      std::int16_t sample;
+      std::memcpy(&sample, p, sizeof(sample));
+      return sample;
+    }
+    case 24: {
+      const auto word = static_cast<std::uint32_t>(p[0] << 8 | p[1] << 16 | p[2] << 24);
+      return static_cast<std::int32_t>(word) >> 8;
+    }
+    default: {
+      std::int32_t sample;
+      std::memcpy(&sample, p, sizeof(sample));
+      return sample;
+    }
+  }
+}
+
+/**
+ * @brief Returns the sample of the value 0.
+ */
+std::int64_t silence_of(const DeviceFormat &format) {
+  return format.bits_per_sample == 8 ? 128 : 0;
+}
+
+/**
+ * @brief Returns a sample of the buffer, scaled so that the full scale is 1.0.
+ */
+double decode(const std::vector<std::uint8_t> &buffer, const DeviceFormat &format,
+              std::size_t index) {
+  if (format.is_float) {
+    float sample;
+    std::memcpy(&sample, buffer.data() + index * sizeof(float), sizeof(sample));
+    return sample;
+  }
+  const unsigned int bits = data_bits_of(format);
+  const std::int64_t sample = raw_sample(buffer, format, index) - silence_of(format);
+  return static_cast<double>(sample >> (format.bits_per_sample - bits)) /
+         static_cast<double>((std::int64_t{1} << (bits - 1)) - 1);
+}
+
+/**
+ * @brief Returns the tolerance of a decoded sample: half a step of the data bits, plus the error
+ * of the oscillator.
+ */
+double tolerance_of(const DeviceFormat &format) {
+  const unsigned int bits = data_bits_of(format);
+  return (bits != 0 ? 0.5 / static_cast<double>((std::int64_t{1} << (bits - 1)) - 1) : 0.0) + 1e-6;
+}
+
+/**
+ * @brief Returns a generator for the device, without dither, ramps, or the loop.
+ */
+ToneDataGenerator make_generator(DeviceFormat format, unsigned int channels_count) {
+  format.samples_per_second = SAMPLES_PER_SECOND;
+  format.channels_count = channels_count;
+  ToneDataGenerator generator;
+  EXPECT(generator.set_format(format));
+  generator.left_amplitude = 0.8;
+  generator.right_amplitude = 0.5;
+  generator.left_frequency = LEFT_FREQUENCY;
+  generator.right_frequency = RIGHT_FREQUENCY;
+  generator.dither_mode = DitherMode::none;
+  generator.smoothing_time = 0;
+  generator.loop_playback = false;
+  return generator;
+}
+
+/**
+ * @brief Returns a buffer of `FRAMES_COUNT` frames of the generator.
+ */
+std::vector<std::uint8_t> make_buffer(const ToneDataGenerator &generator) {
+  return std::vector<std::uint8_t>(FRAMES_COUNT * generator.channels_count *
+                                   generator.bits_per_sample / 8);
+}
+
+void test_set_format() {
+  for (const MockDevice &device : DEVICES) {
+    ToneDataGenerator generator;
+    EXPECT(generator.set_format(device.format));
+    EXPECT(generator.bits_per_sample == device.format.bits_per_sample);
+    EXPECT(generator.valid_bits_per_sample == (device.format.valid_bits_per_sample != 0
+                                                   ? device.format.valid_bits_per_sample
+                                                   : device.format.bits_per_sample));
+    EXPECT(generator.is_float == device.format.is_float);
+  }
+
+  // Unsupported formats leave the generator unchanged.
+  const DeviceFormat unsupported_formats[] = {
+      {24, 0, true}, {12, 0, false}, {16, 20, false}, {32, 4, false}, {16, 0, false, 48000, 1},
+  };
+  for (const DeviceFormat &format : unsupported_formats) {
+    ToneDataGenerator generator;
+    generator.bits_per_sample = 16;
+    generator.channels_count = 2;
+    EXPECT(!generator.set_format(format));
+    EXPECT(generator.bits_per_sample == 16 && generator.channels_count == 2);
+  }
+}
+
+void test_values() {
+  for (const MockDevice &device : DEVICES) {
+    for (unsigned int channels : {2u, 6u}) {
+      ToneDataGenerator generator = make_generator(device.format, channels);
+      std::vector<std::uint8_t> buffer = make_buffer(generator);
+      generator.write_tone_data(buffer.data(), FRAMES_COUNT, false);
+
+      const double tolerance = tolerance_of(device.format);
+      for (unsigned int i = 0; i < FRAMES_COUNT; ++i) {
+        const double left = 0.8 * std::sin(2 * PI * LEFT_FREQUENCY * i / SAMPLES_PER_SECOND);
+        const double right = 0.5 * std::sin(2 * PI * RIGHT_FREQUENCY * i / SAMPLES_PER_SECOND);
+        EXPECT_NEAR(decode(buffer, device.format, i * channels), left, tolerance);
+        EXPECT_NEAR(decode(buffer, device.format, i * channels + 1), right, tolerance);
+        for (unsigned int channel = 2; channel < channels; ++channel) {
+          EXPECT(raw_sample(buffer, device.format, i * channels + channel) ==
+                 silence_of(device.format));
+        }
+      }
+    }
+  }
+}
+
+void test_valid_bits() {
+  for (const MockDevice &device : DEVICES) {
+    const unsigned int padding_bits = device.format.bits_per_sample - data_bits_of(device.format);
+    if (device.format.is_float || padding_bits == 0) {
+      continue;
+    }
+    for (DitherMode dither : {DitherMode::none, DitherMode::tpdf, DitherMode::noise_shaped}) {
+      ToneDataGenerator generator = make_generator(device.format, 2);
+      generator.dither_mode = dither;
+      generator.white_noise_gain = 0.5;
+      std::vector<std::uint8_t> buffer = make_buffer(generator);
+      generator.write_tone_data(buffer.data(), FRAMES_COUNT, false);
+      const std::int64_t mask = (std::int64_t{1} << padding_bits) - 1;
+      for (std::size_t i = 0; i < 2 * FRAMES_COUNT; ++i) {
+        EXPECT((raw_sample(buffer, device.format, i) & mask) == 0);
+      }
+    }
+  }
+}
+
+void test_quantize_saturation() {
+  const float values[] = {4.0f, -4.0f, 1.5f, -1.5f, 1.0f, -1.0f, 1.0001f, -1.0001f};
+  constexpr unsigned int count = sizeof(values) / sizeof(values[0]);
+  for (DitherMode dither : {DitherMode::none, DitherMode::tpdf, DitherMode::noise_shaped}) {
+    QuantizerState state(1);
+    std::uint8_t bytes[count];
+    quantize(values, bytes, count, dither, state);
+    std::int16_t words[count];
+    quantize(values, words, count, dither, state);
+    for (unsigned int i = 0; i < 4; ++i) {
+      EXPECT(bytes[i] == (values[i] > 0 ? 255 : 0));
+      EXPECT(words[i] == (values[i] > 0 ? 32767 : -32768));
+    }
+    for (unsigned int bits : {8u, 16u, 20u, 24u}) {
+      std::int32_t samples[count];
+      quantize(values, samples, count, bits, dither, state);
+      const std::int64_t max = ((std::int64_t{1} << (bits - 1)) - 1) << (32 - bits);
+      const std::int64_t min = -(std::int64_t{1} << 31);
+      for (unsigned int i = 0; i < count; ++i) {
+        // Beyond the full scale, the samples saturate instead of wrapping around.
+        EXPECT(samples[i] >= min && samples[i] <= max);
+        EXPECT((samples[i] > 0) == (values[i] > 0));
+      }
+      EXPECT(samples[0] == max && samples[1] == min && samples[2] == max && samples[3] == min);
+    }
+  }
+}
+
+void test_saturation() {
+  for (const MockDevice &device : DEVICES) {
+    if (device.format.is_float) {
+      continue;
+    }
+    // The brown noise drifts slowly, and pushes the full-scale tone beyond the full scale.
+    ToneDataGenerator generator = make_generator(device.format, 2);
+    generator.left_amplitude = generator.right_amplitude = 1.0;
+    generator.left_frequency = generator.right_frequency = 50;
+    generator.brown_noise_gain = 1.0;
+    std::vector<std::uint8_t> buffer(48 * make_buffer(generator).size());
+    generator.write_tone_data(buffer.data(), 48 * FRAMES_COUNT, false);
+
+    double peak = 0;
+    for (std::size_t i = 0; i < 2 * 48 * FRAMES_COUNT; ++i) {
+      const double value = decode(buffer, device.format, i);
+      peak = std::max(peak, std::abs(value));
+      if (i >= 2) {
+        // A sample that wrapped around would jump by the full range.
+        EXPECT(std::abs(value - decode(buffer, device.format, i - 2)) < 0.5);
+      }
+    }
+    EXPECT(peak >= 1.0);
+  }
+}
+
+void test_stop_tail() {
+  for (const MockDevice &device : DEVICES) {
+    for (DitherMode dither : {DitherMode::none, DitherMode::tpdf}) {
+      for (unsigned int channels : {2u, 6u}) {
+        ToneDataGenerator generator = make_generator(device.format, channels);
+        generator.dither_mode = dither;
+        std::vector<std::uint8_t> buffer = make_buffer(generator);
+        generator.write_tone_data(buffer.data(), 7, false);
+        generator.write_tone_data(buffer.data(), FRAMES_COUNT, true);
+        EXPECT(generator.is_silent);
+
+        // Each channel stops before its next zero crossing, i.e., within half a period. The rest
+        // of the buffer is silent, without dither.
+        for (unsigned int channel = 0; channel < channels; ++channel) {
+          const auto sample = [&](unsigned int frame) {
+            return raw_sample(buffer, device.format, frame * channels + channel);
+          };
+          unsigned int end = FRAMES_COUNT;
+          while (end > 0 && sample(end - 1) == silence_of(device.format)) {
+            --end;
+          }
+          EXPECT(end <= (channel < 2 ? 24u : 0u));
+          if (dither == DitherMode::none) {
+            for (unsigned int i = 1; i < end; ++i) {
+              const std::int64_t previous = sample(i - 1) - silence_of(device.format);
+              const std::int64_t current = sample(i) - silence_of(device.format);
+              EXPECT(!(previous < 0 && current > 0) && !(previous > 0 && current < 0));
+            }
+          }
+        }
+
+        // The next playback starts from the phase 0.
+        generator.write_tone_data(buffer.data(), FRAMES_COUNT, false);
+        EXPECT(!generator.is_silent);
+        EXPECT_NEAR(decode(buffer, device.format, 0), 0.0, tolerance_of(device.format));
+      }
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  return test::run({
+      {"set_format", test_set_format},
+      {"values", test_values},
+      {"valid_bits", test_valid_bits},
+      {"quantize_saturation", test_quantize_saturation},
+      {"saturation", test_saturation},
+      {"stop_tail", test_stop_tail},
+  });
+}
@@ -0,0 +1,73 @@
+/**
+ * @file test.h
+ * @brief A minimal harness for the native tests.
+ * @details The tests cover the code that does not depend on the Windows API, so they are built
+ * and run on any platform without a test framework (see `CMakeLists.txt`).
+ */
+
+#pragma once
+
+#include <cmath>
+#include <exception>
+#include <initializer_list>
+#include <iostream>
+
+namespace test {
+
+/**
+ * @brief A test case.
+ */
+struct Case {
+  const char *name;
+  void (*run)();
+};
+
+/**
+ * @brief Returns the number of failed checks.
+ */
+inline int &failures_count() {
+  static int count = 0;
+  return count;
+}
+
+/**
+ * @brief Reports a failed check.
+ */
+inline void fail(const char *file, int line, const char *expression) {
+  std::cerr << file << ":" << line << ": Check failed: " << expression << "\n";
+  ++failures_count();
+}
+
+/**
+ * @brief Runs the test cases, and prints the result of each.
+ * @return The exit code of the test: 0 if every check has passed, and 1 otherwise.
+ * @details An exception thrown by a test case fails it, and the next test case is run.
+ */
+inline int run(std::initializer_list<Case> cases) {
+  for (const Case &test_case : cases) {
+    const int previous_failures_count = failures_count();
+    try {
+      test_case.run();
+    } catch (const std::exception &e) {
+      std::cerr << test_case.name << ": Unexpected exception: " << e.what() << "\n";
+      ++failures_count();
+    }
+    std::cout << (failures_count() == previous_failures_count ? "[  OK  ] " : "[ FAIL ] ")
+              << test_case.name << "\n";
+  }
+  return failures_count() == 0 ? 0 : 1;
+}
+
+}  // namespace test
+
+// Checks a condition. The test case continues after a failure.
+#define EXPECT(condition)                         \
+  do {                                            \
+    if (!(condition)) {                           \
+      test::fail(__FILE__, __LINE__, #condition); \
+    }                                             \
+  } while (false)
+
+// Checks that two values differ by `tolerance` or less.
+#define EXPECT_NEAR(actual, expected, tolerance) \
+  EXPECT(std::abs((actual) - (expected)) <= (tolerance))
@@ -0,0 +1,266 @@
+/**
+ * @file tone_pair_test.cpp
+ * @brief Tests of the tone pairs of `ToneDataGenerator`, layered on the tone or routed to the
+ * channels of the device.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "test.h"
+#include "tone_data_generator.h"
+#include "voice_bank.h"
+#include "wave_parameters.h"
+
+namespace {
+
+// Constants.
+constexpr double SAMPLES_PER_SECOND = 48000;
+constexpr unsigned int FRAMES_COUNT = 480;
+constexpr double PI = 3.14159265358979323846;
+constexpr double TOLERANCE = 1e-5;  // Error of a sum of a few sines in single precision.
+
+/**
+ * @brief Returns a float generator of two channels without ramps or the loop, whose tone is a
+ * delta pair with a theta pair layered on it.
+ */
+ToneDataGenerator make_generator() {
+  DeviceFormat format;
+  format.bits_per_sample = 32;
+  format.is_float = true;
+  format.samples_per_second = SAMPLES_PER_SECOND;
+  ToneDataGenerator generator;
+  EXPECT(generator.set_format(format));
+  generator.left_amplitude = generator.right_amplitude = 0.5;
+  generator.left_frequency = 200;
+  generator.right_frequency = 202;
+  generator.pairs[0] = {0.25, 300, 306};
+  generator.dither_mode = DitherMode::none;
+  generator.smoothing_time = 0;
+  generator.loop_playback = false;
+  return generator;
+}
+
+/**
+ * @brief Returns a sample of a float buffer of two channels.
+ */
+float sample_of(const std::vector<std::uint8_t> &buffer, unsigned int frame,
+                unsigned int channel) {
+  float sample;
+  std::memcpy(&sample, buffer.data() + (2 * frame + channel) * sizeof(float), sizeof(sample));
+  return sample;
+}
+
+/**
+ * @brief Returns a sine wave at a frame.
+ */
+double sine(double amplitude, double frequency, std::uint64_t frame) {
+  return amplitude * std::sin(2 * PI * std::fmod(frequency * frame / SAMPLES_PER_SECOND, 1.0));
+}
+
+/**
+ * @brief The pairs are added to the tone, each on its own channel.
+ */
+void test_layers() {
+  ToneDataGenerator generator = make_generator();
+  generator.pairs[3] = {0.125, 400, 410};
+  std::vector<std::uint8_t> buffer(2 * FRAMES_COUNT * sizeof(float));
+  for (unsigned int call = 0; call < 3; ++call) {
+    generator.write_tone_data(buffer.data(), FRAMES_COUNT, false);
+    for (unsigned int i = 0; i < FRAMES_COUNT; ++i) {
+      const std::uint64_t frame = call * FRAMES_COUNT + i;
+      EXPECT_NEAR(sample_of(buffer, i, 0),
+                  sine(0.5, 200, frame) + sine(0.25, 300, frame) + sine(0.125, 400, frame),
+                  TOLERANCE);
+      EXPECT_NEAR(sample_of(buffer, i, 1),
+                  sine(0.5, 202, frame) + sine(0.25, 306, frame) + sine(0.125, 410, frame),
+                  TOLERANCE);
+    }
+  }
+}
+
+/**
+ * @brief A pair starts from the phase 0 and stops at its zero crossing, so it does not click.
+ */
+void test_switch() {
+  ToneDataGenerator generator = make_generator();
+  generator.left_amplitude = generator.right_amplitude = 0.0;
+  generator.pairs[0].amplitude = 0.0;
+  std::vector<std::uint8_t> buffer(2 * FRAMES_COUNT * sizeof(float));
+  generator.write_tone_data(buffer.data(), FRAMES_COUNT, false);
+  EXPECT(sample_of(buffer, FRAMES_COUNT - 1, 0) == 0.0f);
+
+  // 450 frames do not end at a zero crossing of either voice.
+  generator.pairs[0].amplitude = 0.25;
+  generator.write_tone_data(buffer.data(), 450, false);
+  EXPECT_NEAR(sample_of(buffer, 0, 0), 0.0, TOLERANCE);
+  EXPECT_NEAR(sample_of(buffer, 1, 0), sine(0.25, 300, 1), TOLERANCE);
+
+  // The left voice crosses zero every 80 frames, and the right voice about every 78.4 frames.
+  generator.pairs[0].amplitude = 0.0;
+  generator.write_tone_data(buffer.data(), FRAMES_COUNT, false);
+  for (unsigned int channel = 0; channel < 2; ++channel) {
+    unsigned int end = FRAMES_COUNT;
+    while (end > 0 && sample_of(buffer, end - 1, channel) == 0.0f) {
+      --end;
+    }
+    EXPECT(end > 0 && end <= 80);
+    if (end > 0) {
+      EXPECT(std::abs(sample_of(buffer, end - 1, channel)) < 0.25 * 2 * PI * 306 / 48000);
+    }
+  }
+}
+
+/**
+ * @brief The pairs stop with the tone at their own zero crossings.
+ */
+void test_stop() {
+  ToneDataGenerator generator = make_generator();
+  std::vector<std::uint8_t> buffer(2 * FRAMES_COUNT * sizeof(float));
+  generator.write_tone_data(buffer.data(), 37, false);
+  generator.write_tone_data(buffer.data(), FRAMES_COUNT, true);
+  EXPECT(generator.is_silent);
+  for (unsigned int channel = 0; channel < 2; ++channel) {
+    // The tone crosses zero within 120 frames, and the pair within 80 frames.
+    unsigned int end = FRAMES_COUNT;
+    while (end > 0 && sample_of(buffer, end - 1, channel) == 0.0f) {
+      --end;
+    }
+    EXPECT(end > 0 && end <= 120);
+    for (unsigned int i = 1; i < end; ++i) {
+      EXPECT(std::abs(sample_of(buffer, i, channel) - sample_of(buffer, i - 1, channel)) < 0.05);
+    }
+  }
+
+  // The next playback starts the tone and the pairs from the phase 0.
+  generator.write_tone_data(buffer.data(), FRAMES_COUNT, false);
+  EXPECT(!generator.is_silent);
+  EXPECT_NEAR(sample_of(buffer, 0, 0), 0.0, TOLERANCE);
+  EXPECT_NEAR(sample_of(buffer, 1, 0), sine(0.5, 200, 1) + sine(0.25, 300, 1), TOLERANCE);
+}
+
+/**
+ * @brief `render_frames` renders the pairs at their phases of the frame.
+ */
+void test_render_frames() {
+  ToneDataGenerator generator = make_generator();
+  std::vector<std::uint8_t> buffer(2 * FRAMES_COUNT * sizeof(float));
+  const std::uint64_t offset = 123456;
+  generator.render_frames(buffer.data(), offset, FRAMES_COUNT);
+  for (unsigned int i = 0; i < FRAMES_COUNT; ++i) {
+    EXPECT_NEAR(sample_of(buffer, i, 0),
+                sine(0.5, 200, offset + i) + sine(0.25, 300, offset + i), TOLERANCE);
+  }
+}
+
+/**
+ * @brief Routed pairs are played on their own channels with their own phases.
+ */
+void test_routing() {
+  constexpr unsigned int channels = 6;
+  DeviceFormat format;
+  format.bits_per_sample = 32;
+  format.is_float = true;
+  format.channels_count = channels;
+  ToneDataGenerator generator = make_generator();
+  EXPECT(generator.set_format(format));
+  // The pair 0 is on the channels 2 and 3, and the pair 1 is on the channels 4 and 5 at half
+  // gain. The tone is not routed, so it is on the first two channels.
+  generator.pairs[0].channel_routing = true;
+  generator.pairs[0].left_channel_gains[2] = 1.0f;
+  generator.pairs[0].right_channel_gains[3] = 1.0f;
+  generator.pairs[1] = {0.5, 100, 104};
+  generator.pairs[1].channel_routing = true;
+  generator.pairs[1].left_channel_gains[4] = 0.5f;
+  generator.pairs[1].right_channel_gains[5] = 0.5f;
+  std::vector<float> buffer(channels * FRAMES_COUNT);
+  generator.write_tone_data(reinterpret_cast<std::uint8_t *>(buffer.data()), FRAMES_COUNT, false);
+  for (unsigned int i = 0; i < FRAMES_COUNT; ++i) {
+    const float *frame = &buffer[i * channels];
+    EXPECT_NEAR(frame[0], sine(0.5, 200, i), TOLERANCE);
+    EXPECT_NEAR(frame[1], sine(0.5, 202, i), TOLERANCE);
+    EXPECT_NEAR(frame[2], sine(0.25, 300, i), TOLERANCE);
+    EXPECT_NEAR(frame[3], sine(0.25, 306, i), TOLERANCE);
+    EXPECT_NEAR(frame[4], sine(0.25, 100, i), TOLERANCE);
+    EXPECT_NEAR(frame[5], sine(0.25, 104, i), TOLERANCE);
+  }
+
+  // A routed pair stops on its own channels at its zero crossings, and the others continue.
+  generator.pairs[1].amplitude = 0.0;
+  generator.write_tone_data(reinterpret_cast<std::uint8_t *>(buffer.data()), FRAMES_COUNT, false);
+  EXPECT_NEAR(buffer[(FRAMES_COUNT - 1) * channels + 2], sine(0.25, 300, 2 * FRAMES_COUNT - 1),
+              TOLERANCE);
+  // 100 Hz is at a zero crossing, and 104 Hz crosses zero about 212 frames later.
+  EXPECT_NEAR(buffer[4], 0.0, TOLERANCE);
+  EXPECT_NEAR(buffer[5], sine(0.25, 104, FRAMES_COUNT), TOLERANCE);
+  EXPECT(buffer[(FRAMES_COUNT - 1) * channels + 4] == 0.0f);
+  EXPECT(buffer[(FRAMES_COUNT - 1) * channels + 5] == 0.0f);
+}
+
+/**
+ * @brief The speaker gains of the pairs are mapped to the channels of the device.
+ */
+void test_pair_speaker_gains() {
+  ToneDataGenerator generator;
+  generator.channels_count = 6;
+  WaveParameters parameters;
+  parameters.tone_pairs[2].channel_routing = true;
+  parameters.tone_pairs[2].left_speaker_gains[4] = 1.0;   // Back left.
+  parameters.tone_pairs[2].right_speaker_gains[5] = 0.5;  // Back right.
+
+  // Front left, front right, front center, LFE, back left, and back right.
+  apply_channel_routing(parameters, 0x3f, generator);
+  EXPECT(!generator.channel_routing);
+  EXPECT(generator.pairs[2].channel_routing);
+  EXPECT(generator.pairs[2].left_channel_gains[4] == 1.0f);
+  EXPECT(generator.pairs[2].right_channel_gains[5] == 0.5f);
+  EXPECT(!generator.pairs[1].channel_routing);
+
+  // Front left, front right, back left, and back right.
+  apply_channel_routing(parameters, 0x33, generator);
+  EXPECT(generator.pairs[2].left_channel_gains[2] == 1.0f);
+  EXPECT(generator.pairs[2].right_channel_gains[3] == 0.5f);
+  EXPECT(generator.pairs[2].left_channel_gains[4] == 0.0f);
+
+  parameters.tone_pairs[2].channel_routing = false;
+  apply_channel_routing(parameters, 0x33, generator);
+  EXPECT(!generator.pairs[2].channel_routing);
+  EXPECT(generator.pairs[2].left_channel_gains[2] == 0.0f);
+}
+
+/**
+ * @brief A voice of the bank restarts from the phase 0 after it has been stopped.
+ */
+void test_voice_bank() {
+  VoiceBank voices(SAMPLES_PER_SECOND);
+  voices.add_pair(480, 480, 1.0f);
+  EXPECT(!voices.is_silent());
+  std::vector<float> left(FRAMES_COUNT, 0.0f);
+  std::vector<float> right(FRAMES_COUNT, 0.0f);
+
+  // The voices cross zero every 50 frames.
+  EXPECT(voices.add(left.data(), right.data(), 30, false) == 30);
+  EXPECT(voices.add(left.data(), right.data(), FRAMES_COUNT, true) == 20);
+  EXPECT(voices.is_silent());
+  voices.render(left.data(), right.data(), FRAMES_COUNT);
+  EXPECT(!voices.is_silent());
+  EXPECT_NEAR(left[0], 0.0, TOLERANCE);
+  EXPECT_NEAR(left[10], std::sin(2 * PI * 0.1), TOLERANCE);
+  EXPECT(right[10] == left[10]);
+}
+
+}  // namespace
+
+int main() {
+  return test::run({
+      {"layers", test_layers},
+      {"switch", test_switch},
+      {"stop", test_stop},
+      {"render_frames", test_render_frames},
+      {"routing", test_routing},
+      {"pair_speaker_gains", test_pair_speaker_gains},
+      {"voice_bank", test_voice_bank},
+  });
+}
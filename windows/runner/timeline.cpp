@@ -0,0 +1,95 @@
+/**
+ * @file timeline.cpp
+ * @brief Programs of the parameters of a session, evaluated at sample accuracy.
+ */
+
+#include "timeline.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+CompiledTrack::CompiledTrack(const TimelineTrack &track, double samples_per_second) {
+  compile(track, samples_per_second);
+}
+
+void CompiledTrack::compile(const TimelineTrack &track, double samples_per_second) {
+  m_segments.clear();
+  m_samples_per_second = samples_per_second;
+  m_end_frame = 0;
+  m_end_value = track.start_value;
+  m_end_phase = 0;
+  for (const TimelineSegment &segment : track.segments) {
+    const double end_value = segment.shape == SegmentShape::hold ? m_end_value : segment.end_value;
+    const auto frames =
+        static_cast<std::uint64_t>(std::llround(segment.duration * samples_per_second));
+    if (frames != 0) {
+      m_segments.push_back(
+          {m_end_frame, frames, segment.shape, m_end_value, end_value, m_end_phase});
+      m_end_phase += cycles_to_phase(cycles_of(m_segments.back(), frames));
+      m_end_frame += frames;
+    }
+    m_end_value = end_value;
+  }
+}
+
+const CompiledTrack::Segment &CompiledTrack::segment_of(std::uint64_t frame) const {
+  assert(frame < m_end_frame);
+  const auto it = std::upper_bound(
+      m_segments.begin(), m_segments.end(), frame,
+      [](std::uint64_t frame, const Segment &segment) { return frame < segment.start; });
+  return *(it - 1);
+}
+
+double CompiledTrack::cycles_of(const Segment &segment, std::uint64_t frames) const {
+  const double time = static_cast<double>(frames) / m_samples_per_second;
+  const double duration = static_cast<double>(segment.frames) / m_samples_per_second;
+  const double start = segment.start_value;
+  const double end = segment.end_value;
+  switch (segment.shape) {
+    case SegmentShape::linear:
+      return time * (start + (end - start) * time / (2 * duration));
+    case SegmentShape::exponential: {
+      // The integral of `start * exp(rate * t)` is `start * (exp(rate * t) - 1) / rate`.
+      const double rate = std::log(end / start) / duration;
+      return rate == 0 ? start * time : start * std::expm1(rate * time) / rate;
+    }
+    default:
+      return start * time;
+  }
+}
+
+std::uint64_t CompiledTrack::next_boundary(std::uint64_t frame) const {
+  if (frame >= m_end_frame) {
+    return std::numeric_limits<std::uint64_t>::max();
+  }
+  const Segment &segment = segment_of(frame);
+  return segment.start + segment.frames;
+}
+
+double CompiledTrack::value(std::uint64_t frame) const {
+  if (frame >= m_end_frame) {
+    return m_end_value;
+  }
+  const Segment &segment = segment_of(frame);
+  const double position =
+      static_cast<double>(frame - segment.start) / static_cast<double>(segment.frames);
+  switch (segment.shape) {
+    case SegmentShape::linear:
+      return segment.start_value + (segment.end_value - segment.start_value) * position;
+    case SegmentShape::exponential:
+      return segment.start_value * std::pow(segment.end_value / segment.start_value, position);
+    default:
+      return segment.start_value;
+  }
+}
+
+Phase CompiledTrack::phase(std::uint64_t frame) const {
+  if (frame >= m_end_frame) {
+    // The phase advances by an integer per frame and wraps, so the product is exact.
+    return m_end_phase + (frame - m_end_frame) * phase_delta_of(m_end_value, m_samples_per_second);
+  }
+  const Segment &segment = segment_of(frame);
+  return segment.start_phase + cycles_to_phase(cycles_of(segment, frame - segment.start));
+}
@@ -0,0 +1,142 @@
+/**
+ * @file timeline.h
+ * @brief Programs of the parameters of a session, evaluated at sample accuracy.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "oscillator.h"
+
+// Constants.
+constexpr std::size_t MAX_TIMELINE_SEGMENTS = 1024;  // Segments of a track that can be played.
+
+/**
+ * @brief Ways a parameter moves over a segment of a timeline.
+ */
+enum class SegmentShape {
+  hold,         // The value does not change.
+  linear,       // The value changes linearly.
+  exponential,  // The value changes by a constant ratio per second. Both ends must be positive.
+};
+
+/**
+ * @brief A segment of a `TimelineTrack`.
+ */
+struct TimelineSegment {
+  double duration;     // Length of the segment in seconds.
+  SegmentShape shape;  // How the value moves to `end_value`.
+  double end_value;    // Value at the end of the segment. Ignored by `SegmentShape::hold`.
+};
+
+/**
+ * @brief The program of a parameter: a start value followed by segments.
+ * @details After the last segment, the value stays at the end value of the segment.
+ */
+struct TimelineTrack {
+  double start_value = 0.0;
+  std::vector<TimelineSegment> segments;
+};
+
+/**
+ * @brief The programs of the amplitudes and the frequencies of a session, e.g., "sweep the beat
+ * from 14 Hz to 4 Hz over 30 minutes, then fade out".
+ * @details The tracks are independent, and the timeline ends at the end of the longest one.
+ */
+struct Timeline {
+  TimelineTrack left_amplitude;
+  TimelineTrack right_amplitude;
+  TimelineTrack left_frequency;
+  TimelineTrack right_frequency;
+};
+
+/**
+ * @brief A `TimelineTrack` converted to frames of a sample rate.
+ * @details The segments start at whole frames, so the changes of the segments are sample
+ * accurate. The value and the phase of a frequency are computed in closed form from the index of
+ * the frame, so they do not drift however long the track is, and any frame can be evaluated
+ * directly.
+ */
+class CompiledTrack {
+ private:
+  /**
+   * @brief A segment of the track in frames.
+   */
+  struct Segment {
+    std::uint64_t start;     // First frame of the segment.
+    std::uint64_t frames;    // Length of the segment in frames (1 or more).
+    SegmentShape shape;      // How the value moves to `end_value`.
+    double start_value;      // Value at the first frame.
+    double end_value;        // Value at the frame after the segment.
+    Phase start_phase;       // Phase at the first frame, if the value is a frequency.
+  };
+
+  std::vector<Segment> m_segments;
+  double m_samples_per_second = 48000;
+  std::uint64_t m_end_frame = 0;  // The frame after the last segment.
+  double m_end_value = 0.0;       // Value after the last segment.
+  Phase m_end_phase = 0;          // Phase at `m_end_frame`, if the value is a frequency.
+
+  /**
+   * @brief Returns the segment of a frame before `m_end_frame`.
+   */
+  const Segment &segment_of(std::uint64_t frame) const;
+
+  /**
+   * @brief Returns the cycles of a frequency segment from its start to a frame.
+   * @param frames The number of frames from the start of the segment (0 to `segment.frames`).
+   */
+  double cycles_of(const Segment &segment, std::uint64_t frames) const;
+
+ public:
+  CompiledTrack() = default;
+
+  /**
+   * @brief Construct a new `CompiledTrack` object.
+   * @param track The track to convert. The durations are rounded to whole frames, and the
+   * segments that round to 0 frames change the value at once.
+   * @param samples_per_second Samples per second in Hz.
+   */
+  CompiledTrack(const TimelineTrack &track, double samples_per_second);
+
+  /**
+   * @brief Converts a track in place, as the constructor.
+   * @details No memory is allocated if the track has no more segments than the capacity given to
+   * `reserve`.
+   */
+  void compile(const TimelineTrack &track, double samples_per_second);
+
+  /**
+   * @brief Allocates the memory for the segments.
+   * @param segments_count The number of segments.
+   */
+  void reserve(std::size_t segments_count) { m_segments.reserve(segments_count); }
+
+  /**
+   * @brief The frame after the last segment.
+   */
+  std::uint64_t end_frame() const { return m_end_frame; }
+
+  /**
+   * @brief Returns the first frame after `frame` where a segment starts or the track ends, or
+   * the maximum value if there is none.
+   * @details The value is smooth between the boundaries, so it can be interpolated there.
+   */
+  std::uint64_t next_boundary(std::uint64_t frame) const;
+
+  /**
+   * @brief Returns the value at a frame.
+   */
+  double value(std::uint64_t frame) const;
+
+  /**
+   * @brief Returns the phase advanced by the frequency of the track from the frame 0 to a frame.
+   * @details The phase is the integral of the frequency, in closed form within the segments. For
+   * example, a linear sweep from `f0` to `f1` over `T` seconds advances
+   * `f0 * t + (f1 - f0) * t^2 / (2 * T)` cycles in `t` seconds.
+   */
+  Phase phase(std::uint64_t frame) const;
+};
@@ -0,0 +1,833 @@
+/**
+ * @file tone_data_generator.cpp
+ * @brief `ToneDataGenerator` class implementation.
+ */
+
+#include "tone_data_generator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
+#include "dsp.h"
+#include "interleave.h"
+#include "oscillator.h"
+
+// Constants.
+constexpr unsigned int BLOCK_FRAMES = 64;  // Number of frames computed at once by the oscillator.
+static_assert(BLOCK_FRAMES <= MAX_INTERLEAVE_FRAMES);
+// Frames between the points where `render_frames` reseeds the noise and the dither.
+constexpr std::uint64_t SEEK_BLOCK_FRAMES = 1 << 16;
+// Frames over which the noise filters settle before a seek block. The slowest pole (0.995) decays
+// to 1e-9 over them.
+constexpr std::uint64_t NOISE_WARMUP_FRAMES = 1 << 12;
+// Frames rendered at once while the generator is moved to a frame by `seek`.
+constexpr unsigned int PREROLL_FRAMES = 4096;
+// Minimum length of a loop in frames. Short periods are repeated in the loop, so that a buffer is
+// copied in a few large blocks.
+constexpr unsigned int MIN_LOOP_FRAMES = 1024;
+
+namespace {
+
+// Sample formats used as the `Format` parameter of `ToneDataGenerator::write_frames`.
+// `convert` converts a block of values in [-1.0, 1.0] to samples with the valid bits, and
+// `silence` is the sample of the value 0. Every byte of `silence` is `silence_byte`.
+
+struct Uint8Format {
+  using Sample = std::uint8_t;
+  static constexpr Sample silence = 128;
+  static constexpr std::uint8_t silence_byte = 128;
+  static void convert(const float *values, Sample *samples, unsigned int frames_count,
+                      unsigned int, DitherMode dither, QuantizerState &state) {
+    quantize(values, samples, frames_count, dither, state);
+  }
+};
+
+struct Int16Format {
+  using Sample = std::int16_t;
+  static constexpr Sample silence = 0;
+  static constexpr std::uint8_t silence_byte = 0;
+  static void convert(const float *values, Sample *samples, unsigned int frames_count,
+                      unsigned int, DitherMode dither, QuantizerState &state) {
+    quantize(values, samples, frames_count, dither, state);
+  }
+};
+
+struct Int24Format {
+  using Sample = Int24;
+  static constexpr Sample silence = {};
+  static constexpr std::uint8_t silence_byte = 0;
+  static void convert(const float *values, Sample *samples, unsigned int frames_count,
+                      unsigned int valid_bits, DitherMode dither, QuantizerState &state) {
+    // The upper 3 bytes of the value left-justified in 32 bits are the 24-bit sample.
+    alignas(32) std::int32_t words[BLOCK_FRAMES];
+    assert(frames_count <= BLOCK_FRAMES);
+    quantize(values, words, frames_count, valid_bits, dither, state);
+    for (unsigned int i = 0; i < frames_count; ++i) {
+      const auto word = static_cast<std::uint32_t>(words[i]);
+      samples[i] = {static_cast<std::uint8_t>(word >> 8), static_cast<std::uint8_t>(word >> 16),
+                    static_cast<std::uint8_t>(word >> 24)};
+    }
+  }
+};
+
+struct Int32Format {
+  using Sample = std::int32_t;
+  static constexpr Sample silence = 0;
+  static constexpr std::uint8_t silence_byte = 0;
+  static void convert(const float *values, Sample *samples, unsigned int frames_count,
+                      unsigned int valid_bits, DitherMode dither, QuantizerState &state) {
+    // The values have 24 significant bits, so the bits below them are left 0.
+    quantize(values, samples, frames_count, std::min(valid_bits, 24u), dither, state);
+  }
+};
+
+struct Float32Format {
+  using Sample = float;
+  static constexpr Sample silence = 0.0f;
+  static constexpr std::uint8_t silence_byte = 0;
+  static void convert(const float *values, Sample *samples, unsigned int frames_count,
+                      unsigned int, DitherMode, QuantizerState &) {
+    std::copy(values, values + frames_count, samples);
+  }
+};
+
+template <std::size_t... Indices, class Function>
+auto make_array(Function make_element, std::index_sequence<Indices...>) {
+  return std::array{make_element(Indices)...};
+}
+
+/**
+ * @brief Returns an array of `Size` elements returned by `make_element(i)`, whose type does not
+ * need to be default-constructible.
+ */
+template <std::size_t Size, class Function>
+auto make_array(Function make_element) {
+  return make_array(make_element, std::make_index_sequence<Size>{});
+}
+
+/**
+ * @brief Returns the period of a frequency in frames.
+ * @return 0 if the frequency is not a multiple of 0.001 Hz, or the period is longer than a
+ * second.
+ */
+std::uint64_t period_frames(double frequency, double samples_per_second) {
+  const std::int64_t millihertz = std::llround(frequency * 1000);
+  const std::int64_t rate = std::llround(samples_per_second);
+  if (std::abs(frequency * 1000 - static_cast<double>(millihertz)) > 1e-6 || millihertz <= 0 ||
+      static_cast<double>(rate) != samples_per_second) {
+    return 0;
+  }
+  // The frequency makes `millihertz * period / (rate * 1000)` cycles in a period.
+  const auto period = static_cast<std::uint64_t>(rate * 1000 / std::gcd(millihertz, rate * 1000));
+  return period <= static_cast<std::uint64_t>(rate) ? period : 0;
+}
+
+}  // namespace
+
+template <class Format, unsigned int Channels>
+void ToneDataGenerator::write_frames(std::uint8_t *buffer, unsigned int frames_count,
+                                     unsigned int left_frames, unsigned int right_frames) {
+  using Sample = typename Format::Sample;
+
+  // When `Channels` is given, the stride of the interleave is a constant.
+  const unsigned int channels = Channels != 0 ? Channels : channels_count;
+  // While the pairs sound, the frames after the end of the tone are rendered for them.
+  const unsigned int sound_frames =
+      m_has_pairs ? frames_count : std::max(left_frames, right_frames);
+  const unsigned int valid_bits =
+      valid_bits_per_sample != 0 ? valid_bits_per_sample : bits_per_sample;
+  const bool is_routed = channel_routing || m_has_routed_pairs;
+
+  // Each block is rendered in float by the oscillator, converted to the sample format in planar
+  // buffers, and then interleaved into the frames.
+  const OscillatorFunction render_left =
+      oscillator_function(left_waveform, oscillator_mode, wavetable_size);
+  const OscillatorFunction render_right =
+      oscillator_function(right_waveform, oscillator_mode, wavetable_size);
+  const auto white_gain = static_cast<float>(white_noise_gain);
+  const auto pink_gain = static_cast<float>(pink_noise_gain);
+  const auto brown_gain = static_cast<float>(brown_noise_gain);
+  const bool has_noise = white_gain != 0 || pink_gain != 0 || brown_gain != 0;
+  alignas(32) float left_values[BLOCK_FRAMES];
+  alignas(32) float right_values[BLOCK_FRAMES];
+  alignas(32) Sample left_samples[BLOCK_FRAMES];
+  alignas(32) Sample right_samples[BLOCK_FRAMES];
+  alignas(32) float pair_values[2 * MAX_TONE_PAIRS * BLOCK_FRAMES];
+  unsigned int pair_ends[MAX_TONE_PAIRS] = {};
+  Sample *wave_data = reinterpret_cast<Sample *>(buffer);
+  for (unsigned int start = 0; start < sound_frames;) {
+    const Phase left_phase_delta = phase_delta_of(m_left_frequency.current, samples_per_second);
+    const Phase right_phase_delta = phase_delta_of(m_right_frequency.current, samples_per_second);
+    unsigned int block_frames = std::min(BLOCK_FRAMES, sound_frames - start);
+    if (m_timeline_running) {
+      block_frames =
+          render_timeline_block(render_left, render_right, left_values, right_values, block_frames);
+    } else if (m_ramp_frames == 0) {
+      m_left_phase = render_left(left_values, block_frames, m_left_phase, left_phase_delta,
+                                 static_cast<float>(m_left_amplitude.current));
+      m_right_phase = render_right(right_values, block_frames, m_right_phase, right_phase_delta,
+                                   static_cast<float>(m_right_amplitude.current));
+    } else {
+      // The block ends at the end of the ramp at the latest, so that the path above is used right
+      // after that. The frequencies are constant within a block.
+      block_frames = std::min(block_frames, m_ramp_frames);
+      m_left_phase = render_left(left_values, block_frames, m_left_phase, left_phase_delta, 1.0f);
+      m_right_phase =
+          render_right(right_values, block_frames, m_right_phase, right_phase_delta, 1.0f);
+      apply_gain_ramp(left_values, block_frames,
+                      static_cast<float>(m_left_amplitude.current + m_left_amplitude.step),
+                      static_cast<float>(m_left_amplitude.step));
+      apply_gain_ramp(right_values, block_frames,
+                      static_cast<float>(m_right_amplitude.current + m_right_amplitude.step),
+                      static_cast<float>(m_right_amplitude.step));
+      advance_ramp(block_frames);
+    }
+
+    // While stopping, one channel can reach zero before the other. Its silence is written after
+    // the conversion, so that it is not dithered.
+    unsigned int left_end = std::clamp(left_frames, start, start + block_frames) - start;
+    unsigned int right_end = std::clamp(right_frames, start, start + block_frames) - start;
+    if (m_has_pairs) {
+      // The pairs are added to the tone, or rendered apart to be routed, up to their own zero
+      // crossings.
+      std::fill(left_values + left_end, left_values + block_frames, 0.0f);
+      std::fill(right_values + right_end, right_values + block_frames, 0.0f);
+      unsigned int pairs_end = 0;
+      for (unsigned int i = 0; i < MAX_TONE_PAIRS; ++i) {
+        VoiceBank &voices = m_pair_voices[i];
+        pair_ends[i] = 0;
+        if (m_applied_pairs[i].amplitude == 0 && voices.is_silent()) {
+          continue;
+        }
+        if (!m_applied_pairs[i].channel_routing) {
+          pairs_end = std::max(
+              pairs_end, voices.add(left_values, right_values, block_frames, m_is_stopping));
+          continue;
+        }
+        float *pair_left = pair_values + 2 * i * BLOCK_FRAMES;
+        float *pair_right = pair_left + BLOCK_FRAMES;
+        std::fill(pair_left, pair_left + block_frames, 0.0f);
+        std::fill(pair_right, pair_right + block_frames, 0.0f);
+        pair_ends[i] = voices.add(pair_left, pair_right, block_frames, m_is_stopping);
+      }
+      left_end = std::max(left_end, pairs_end);
+      right_end = std::max(right_end, pairs_end);
+    }
+    if (has_noise) {
+      add_noise(left_values, block_frames, white_gain, pink_gain, brown_gain, m_left_noise);
+      add_noise(right_values, block_frames, white_gain, pink_gain, brown_gain, m_right_noise);
+    }
+    if (!is_routed) {
+      Format::convert(left_values, left_samples, block_frames, valid_bits, dither_mode,
+                      m_left_quantizer);
+      Format::convert(right_values, right_samples, block_frames, valid_bits, dither_mode,
+                      m_right_quantizer);
+      std::fill(left_samples + left_end, left_samples + block_frames, Format::silence);
+      std::fill(right_samples + right_end, right_samples + block_frames, Format::silence);
+      interleave<Sample, Channels>(left_samples, right_samples, wave_data, block_frames,
+                                   channels, Format::silence);
+    } else {
+      write_routed_block<Format>(wave_data, left_values, right_values, pair_values, pair_ends,
+                                 block_frames, channels, left_end, right_end, valid_bits);
+    }
+    wave_data += channels * block_frames;
+    start += block_frames;
+  }
+
+  std::memset(wave_data, Format::silence_byte,
+              sizeof(Sample) * channels * (frames_count - sound_frames));
+}
+
+template <class Format>
+void ToneDataGenerator::write_routed_block(typename Format::Sample *output, float *left_values,
+                                           float *right_values, const float *pair_values,
+                                           const unsigned int *pair_ends,
+                                           unsigned int frames_count, unsigned int channels,
+                                           unsigned int left_end, unsigned int right_end,
+                                           unsigned int valid_bits) {
+  using Sample = typename Format::Sample;
+
+  // A channel that has stopped is not mixed into the others.
+  std::fill(left_values + left_end, left_values + frames_count, 0.0f);
+  std::fill(right_values + right_end, right_values + frames_count, 0.0f);
+
+  std::memset(output, Format::silence_byte, sizeof(Sample) * channels * frames_count);
+  alignas(32) float values[BLOCK_FRAMES];
+  alignas(32) Sample samples[BLOCK_FRAMES];
+  for (unsigned int channel = 0; channel < std::min(channels, MAX_ROUTED_CHANNELS); ++channel) {
+    // Without the routing of the tone, its channels are written to the first two channels.
+    const float left_gain =
+        channel_routing ? left_channel_gains[channel] : static_cast<float>(channel == 0);
+    const float right_gain =
+        channel_routing ? right_channel_gains[channel] : static_cast<float>(channel == 1);
+    bool has_source = left_gain != 0 || right_gain != 0;
+    if (has_source) {
+      mix_channels(left_values, right_values, values, frames_count, left_gain, right_gain);
+    }
+    unsigned int end = std::max(left_gain != 0 ? left_end : 0, right_gain != 0 ? right_end : 0);
+    for (unsigned int i = 0; i < MAX_TONE_PAIRS; ++i) {
+      const float pair_left_gain = m_applied_pairs[i].left_channel_gains[channel];
+      const float pair_right_gain = m_applied_pairs[i].right_channel_gains[channel];
+      if (pair_ends[i] == 0 || (pair_left_gain == 0 && pair_right_gain == 0)) {
+        continue;
+      }
+      if (!has_source) {
+        std::fill(values, values + frames_count, 0.0f);
+        has_source = true;
+      }
+      const float *pair_left = pair_values + 2 * i * BLOCK_FRAMES;
+      add_channels(pair_left, pair_left + BLOCK_FRAMES, values, frames_count, pair_left_gain,
+                   pair_right_gain);
+      end = std::max(end, pair_ends[i]);
+    }
+    if (!has_source) {
+      continue;
+    }
+    Format::convert(values, samples, frames_count, valid_bits, dither_mode,
+                    m_channel_quantizers[channel]);
+
+    // The frames after the end of its sources are left silent, so that they are not dithered.
+    for (unsigned int i = 0; i < end; ++i) {
+      output[i * channels + channel] = samples[i];
+    }
+  }
+}
+
+std::vector<QuantizerState> ToneDataGenerator::make_channel_quantizers(std::uint32_t seed) {
+  std::vector<QuantizerState> quantizers;
+  quantizers.reserve(MAX_ROUTED_CHANNELS);
+  for (std::uint32_t channel = 0; channel < MAX_ROUTED_CHANNELS; ++channel) {
+    quantizers.emplace_back(seed + channel);
+  }
+  return quantizers;
+}
+
+std::array<VoiceBank, MAX_TONE_PAIRS> ToneDataGenerator::make_pair_voices() {
+  const auto make_voices = [](auto) {
+    VoiceBank voices(48000);
+    voices.reserve(2);
+    voices.add_pair(440, 440, 0.0f);
+    return voices;
+  };
+  return make_array<MAX_TONE_PAIRS>(make_voices);
+}
+
+void ToneDataGenerator::update_pairs() {
+  const bool is_new_rate = m_pairs_rate != samples_per_second;
+  m_pairs_rate = samples_per_second;
+  m_has_pairs = false;
+  m_has_routed_pairs = false;
+  for (unsigned int i = 0; i < MAX_TONE_PAIRS; ++i) {
+    const TonePair &pair = pairs[i];
+    TonePair &applied = m_applied_pairs[i];
+    VoiceBank &voices = m_pair_voices[i];
+    if (is_new_rate) {
+      voices.set_samples_per_second(samples_per_second);
+    }
+    if (is_new_rate || pair.left_frequency != applied.left_frequency ||
+        pair.right_frequency != applied.right_frequency) {
+      voices.set_frequency(0, pair.left_frequency);
+      voices.set_frequency(1, pair.right_frequency);
+    }
+    if (pair.amplitude != applied.amplitude) {
+      // Each voice is panned to its channel.
+      voices.set_gain(0, static_cast<float>(pair.amplitude), -1.0f);
+      voices.set_gain(1, static_cast<float>(pair.amplitude), 1.0f);
+    }
+    applied = pair;
+    const bool sounds = pair.amplitude != 0 || !voices.is_silent();
+    m_has_pairs = m_has_pairs || sounds;
+    m_has_routed_pairs = m_has_routed_pairs || (sounds && pair.channel_routing);
+  }
+}
+
+ToneDataGenerator::Kernel ToneDataGenerator::select_kernel() const {
+  const auto for_layout = [this](auto format) -> Kernel {
+    using Format = decltype(format);
+    switch (channels_count) {
+      case 2:  // Stereo.
+        return &ToneDataGenerator::write_frames<Format, 2>;
+      case 6:  // 5.1 surround.
+        return &ToneDataGenerator::write_frames<Format, 6>;
+      case 8:  // 7.1 surround.
+        return &ToneDataGenerator::write_frames<Format, 8>;
+      default:
+        return &ToneDataGenerator::write_frames<Format, 0>;
+    }
+  };
+  switch (bits_per_sample) {
+    case 8:
+      return for_layout(Uint8Format{});
+    case 16:
+      return for_layout(Int16Format{});
+    case 24:
+      return for_layout(Int24Format{});
+    default:
+      return is_float ? for_layout(Float32Format{}) : for_layout(Int32Format{});
+  }
+}
+
+void ToneDataGenerator::update_ramp() {
+  if (!m_parameters_initialized) {
+    // The first parameters are applied at once.
+    for (auto [value, parameter] : {std::pair{&m_left_amplitude, left_amplitude},
+                                    std::pair{&m_right_amplitude, right_amplitude},
+                                    std::pair{&m_left_frequency, left_frequency},
+                                    std::pair{&m_right_frequency, right_frequency}}) {
+      value->current = value->target = parameter;
+    }
+    m_parameters_initialized = true;
+    return;
+  }
+
+  if (m_left_amplitude.target == left_amplitude && m_right_amplitude.target == right_amplitude &&
+      m_left_frequency.target == left_frequency && m_right_frequency.target == right_frequency) {
+    return;
+  }
+
+  // A new ramp starts from the current values, even if the previous ramp has not finished.
+  m_ramp_frames = static_cast<unsigned int>(std::lround(smoothing_time * samples_per_second));
+  for (auto [value, parameter] : {std::pair{&m_left_amplitude, left_amplitude},
+                                  std::pair{&m_right_amplitude, right_amplitude},
+                                  std::pair{&m_left_frequency, left_frequency},
+                                  std::pair{&m_right_frequency, right_frequency}}) {
+    value->target = parameter;
+    if (m_ramp_frames == 0) {
+      value->current = parameter;
+    } else {
+      value->step = (value->target - value->current) / m_ramp_frames;
+    }
+  }
+}
+
+void ToneDataGenerator::advance_ramp(unsigned int frames_count) {
+  assert(frames_count <= m_ramp_frames);
+
+  m_ramp_frames -= frames_count;
+  for (SmoothedValue *value :
+       {&m_left_amplitude, &m_right_amplitude, &m_left_frequency, &m_right_frequency}) {
+    // Set the target at the end, so that the rounding error does not remain.
+    value->current =
+        m_ramp_frames == 0 ? value->target : value->current + value->step * frames_count;
+  }
+}
+
+bool ToneDataGenerator::set_format(const DeviceFormat &format) {
+  const unsigned int bits = format.bits_per_sample;
+  const unsigned int valid_bits =
+      format.valid_bits_per_sample != 0 ? format.valid_bits_per_sample : bits;
+  const bool is_supported_size =
+      format.is_float ? bits == 32 : bits == 8 || bits == 16 || bits == 24 || bits == 32;
+  if (!is_supported_size || valid_bits < 8 || valid_bits > bits || format.channels_count < 2) {
+    return false;
+  }
+  bits_per_sample = bits;
+  valid_bits_per_sample = valid_bits;
+  is_float = format.is_float;
+  samples_per_second = format.samples_per_second;
+  channels_count = format.channels_count;
+  // The longest loop is a second, or less than `2 * MIN_LOOP_FRAMES` frames if the period is
+  // shorter than `MIN_LOOP_FRAMES`.
+  const double max_loop_frames = samples_per_second + MIN_LOOP_FRAMES;
+  m_loop.resize(static_cast<std::size_t>(max_loop_frames) * channels_count * bits_per_sample / 8);
+  return true;
+}
+
+void ToneDataGenerator::write_tone_data(std::uint8_t *buffer, unsigned int frames_count,
+                                        bool is_stopping) {
+  assert(channels_count >= 2);
+  assert(bits_per_sample == 8 || bits_per_sample == 16 || bits_per_sample == 24 ||
+         bits_per_sample == 32);
+  assert(!is_float || bits_per_sample == 32);
+  assert(valid_bits_per_sample <= bits_per_sample);
+  // A frequency above the Nyquist frequency is clamped by `phase_delta_of`.
+  assert(left_frequency > 0 && right_frequency > 0);
+
+  if (m_has_timeline && m_timeline_rate != samples_per_second) {
+    compile_timeline();
+  }
+  update_pairs();
+
+  if (!is_stopping) {
+    if (!m_timeline_running) {
+      update_ramp();
+    }
+    update_loop();
+    if (m_loop_frames != 0 && m_loop_captured == m_loop_frames) {
+      play_loop(buffer, frames_count);
+    } else {
+      (this->*select_kernel())(buffer, frames_count, frames_count, frames_count);
+      capture_loop(buffer, frames_count);
+    }
+    m_left_silent = m_left_amplitude.current == 0;
+    m_right_silent = m_right_amplitude.current == 0;
+    is_silent = false;
+    return;
+  }
+
+  // A channel that has already reached zero stays silent. Otherwise, it is written up to the
+  // frame before its next zero crossing. The ramp and the timeline are paused while stopping, so
+  // that the frequencies used to compute the zero crossings do not change.
+  const unsigned int ramp_frames = m_ramp_frames;
+  const bool timeline_running = m_timeline_running;
+  m_ramp_frames = 0;
+  m_timeline_running = false;
+  m_is_stopping = true;
+  const unsigned int left_frames =
+      m_left_silent ? 0
+                    : frames_until_zero_crossing(
+                          left_waveform, m_left_phase,
+                          phase_delta_of(m_left_frequency.current, samples_per_second),
+                          frames_count);
+  const unsigned int right_frames =
+      m_right_silent ? 0
+                     : frames_until_zero_crossing(
+                           right_waveform, m_right_phase,
+                           phase_delta_of(m_right_frequency.current, samples_per_second),
+                           frames_count);
+  (this->*select_kernel())(buffer, frames_count, left_frames, right_frames);
+  m_ramp_frames = ramp_frames;
+  m_timeline_running = timeline_running;
+  m_is_stopping = false;
+  m_loop_periodic = false;
+
+  // Reset the phase of a silent channel so that the next playback starts from zero.
+  if (left_frames < frames_count) {
+    m_left_silent = true;
+    m_left_phase = 0;
+  }
+  if (right_frames < frames_count) {
+    m_right_silent = true;
+    m_right_phase = 0;
+  }
+  if (m_timeline_running) {
+    // The timeline continues from the phases where the tone stopped.
+    rebase_timeline_phases();
+  }
+  is_silent = m_left_silent && m_right_silent &&
+              std::all_of(m_pair_voices.begin(), m_pair_voices.end(),
+                          [](const VoiceBank &voices) { return voices.is_silent(); });
+}
+
+void ToneDataGenerator::start_timeline(const Timeline &timeline) {
+  // The segments are copied into the memory of the previous timeline.
+  for (auto [track, source] : {std::pair{&m_timeline.left_amplitude, &timeline.left_amplitude},
+                               std::pair{&m_timeline.right_amplitude, &timeline.right_amplitude},
+                               std::pair{&m_timeline.left_frequency, &timeline.left_frequency},
+                               std::pair{&m_timeline.right_frequency, &timeline.right_frequency}}) {
+    track->start_value = source->start_value;
+    track->segments.assign(source->segments.begin(), source->segments.end());
+  }
+  m_has_timeline = true;
+  m_timeline_running = true;
+  m_timeline_rate = 0.0;
+  m_timeline_frame = 0;
+  m_ramp_frames = 0;
+  m_parameters_initialized = true;
+  compile_timeline();
+  if (m_timeline_running) {
+    apply_timeline_values(0);
+  }
+}
+
+void ToneDataGenerator::reserve_timeline(std::size_t segments_count) {
+  for (TimelineTrack *track : {&m_timeline.left_amplitude, &m_timeline.right_amplitude,
+                               &m_timeline.left_frequency, &m_timeline.right_frequency}) {
+    track->segments.reserve(segments_count);
+  }
+  for (CompiledTrack *track : {&m_left_amplitude_track, &m_right_amplitude_track,
+                               &m_left_frequency_track, &m_right_frequency_track}) {
+    track->reserve(segments_count);
+  }
+}
+
+void ToneDataGenerator::stop_timeline() {
+  m_has_timeline = false;
+  m_timeline_running = false;
+  // The next call of `update_ramp` ramps from the values of the timeline.
+  for (SmoothedValue *value :
+       {&m_left_amplitude, &m_right_amplitude, &m_left_frequency, &m_right_frequency}) {
+    value->target = value->current;
+  }
+}
+
+void ToneDataGenerator::compile_timeline() {
+  const double position = timeline_position();
+  m_left_amplitude_track.compile(m_timeline.left_amplitude, samples_per_second);
+  m_right_amplitude_track.compile(m_timeline.right_amplitude, samples_per_second);
+  m_left_frequency_track.compile(m_timeline.left_frequency, samples_per_second);
+  m_right_frequency_track.compile(m_timeline.right_frequency, samples_per_second);
+  m_timeline_rate = samples_per_second;
+  m_timeline_end = std::max({m_left_amplitude_track.end_frame(),
+                             m_right_amplitude_track.end_frame(),
+                             m_left_frequency_track.end_frame(),
+                             m_right_frequency_track.end_frame()});
+  m_timeline_frame = std::min(static_cast<std::uint64_t>(std::llround(position * m_timeline_rate)),
+                              m_timeline_end);
+  rebase_timeline_phases();
+  if (m_timeline_running && m_timeline_frame == m_timeline_end) {
+    finish_timeline();
+  }
+}
+
+void ToneDataGenerator::rebase_timeline_phases() {
+  m_left_timeline_phase = m_left_phase - m_left_frequency_track.phase(m_timeline_frame);
+  m_right_timeline_phase = m_right_phase - m_right_frequency_track.phase(m_timeline_frame);
+}
+
+void ToneDataGenerator::apply_timeline_values(std::uint64_t frame) {
+  for (auto [value, track] : {std::pair{&m_left_amplitude, &m_left_amplitude_track},
+                              std::pair{&m_right_amplitude, &m_right_amplitude_track},
+                              std::pair{&m_left_frequency, &m_left_frequency_track},
+                              std::pair{&m_right_frequency, &m_right_frequency_track}}) {
+    value->current = value->target = track->value(frame);
+  }
+}
+
+void ToneDataGenerator::finish_timeline() {
+  m_timeline_running = false;
+  apply_timeline_values(m_timeline_end);
+  left_amplitude = m_left_amplitude.current;
+  right_amplitude = m_right_amplitude.current;
+  left_frequency = m_left_frequency.current;
+  right_frequency = m_right_frequency.current;
+}
+
+unsigned int ToneDataGenerator::render_timeline_block(OscillatorFunction render_left,
+                                                      OscillatorFunction render_right,
+                                                      float *left_values, float *right_values,
+                                                      unsigned int frames_count) {
+  const std::uint64_t start = m_timeline_frame;
+  const std::uint64_t boundary = std::min({m_left_amplitude_track.next_boundary(start),
+                                           m_right_amplitude_track.next_boundary(start),
+                                           m_left_frequency_track.next_boundary(start),
+                                           m_right_frequency_track.next_boundary(start),
+                                           m_timeline_end});
+  const auto frames =
+      static_cast<unsigned int>(std::min<std::uint64_t>(frames_count, boundary - start));
+  const std::uint64_t end = start + frames;
+
+  const auto render_channel = [&](OscillatorFunction render, const CompiledTrack &frequency,
+                                  const CompiledTrack &amplitude, Phase base, float *values) {
+    // The block starts at the exact phase, and its frequency is the frequency at its middle,
+    // corrected so that the block ends at the exact phase.
+    const Phase start_phase = base + frequency.phase(start);
+    const Phase end_phase = base + frequency.phase(end);
+    const Phase nominal_delta =
+        phase_delta_of(frequency.value(start + frames / 2), samples_per_second);
+    const auto error = static_cast<std::int64_t>(end_phase - start_phase - nominal_delta * frames);
+    const Phase phase_delta =
+        nominal_delta + static_cast<Phase>(error / static_cast<std::int64_t>(frames));
+    render(values, frames, start_phase, phase_delta, 1.0f);
+    // The amplitude can jump at `end`, so the ramp is interpolated to the last frame.
+    const double first_gain = amplitude.value(start);
+    const double step = frames > 1 ? (amplitude.value(end - 1) - first_gain) / (frames - 1) : 0.0;
+    apply_gain_ramp(values, frames, static_cast<float>(first_gain), static_cast<float>(step));
+    return end_phase;
+  };
+  m_left_phase = render_channel(render_left, m_left_frequency_track, m_left_amplitude_track,
+                                m_left_timeline_phase, left_values);
+  m_right_phase = render_channel(render_right, m_right_frequency_track, m_right_amplitude_track,
+                                 m_right_timeline_phase, right_values);
+
+  m_timeline_frame = end;
+  if (end == m_timeline_end) {
+    finish_timeline();
+  } else {
+    apply_timeline_values(end);
+  }
+  return frames;
+}
+
+void ToneDataGenerator::update_loop() {
+  const LoopParameters parameters{left_amplitude, right_amplitude, left_frequency,
+                                  right_frequency, left_waveform, right_waveform,
+                                  oscillator_mode, wavetable_size, bits_per_sample,
+                                  valid_bits_per_sample, is_float, samples_per_second,
+                                  channels_count};
+  const bool is_periodic = loop_playback && m_ramp_frames == 0 && !m_timeline_running &&
+                           !m_has_pairs && white_noise_gain == 0 &&
+                           pink_noise_gain == 0 && brown_noise_gain == 0 &&
+                           (is_float || dither_mode == DitherMode::none);
+  if (is_periodic && m_loop_periodic && parameters == m_loop_parameters &&
+      channel_routing == m_loop_channel_routing &&
+      left_channel_gains == m_loop_left_channel_gains &&
+      right_channel_gains == m_loop_right_channel_gains) {
+    return;
+  }
+
+  // Start a new capture from the next frame.
+  m_loop_periodic = is_periodic;
+  m_loop_parameters = parameters;
+  m_loop_channel_routing = channel_routing;
+  m_loop_left_channel_gains = left_channel_gains;
+  m_loop_right_channel_gains = right_channel_gains;
+  m_loop_frames = 0;
+  m_loop_captured = 0;
+  m_loop_position = 0;
+  if (!is_periodic) {
+    return;
+  }
+  const std::uint64_t left_period = period_frames(left_frequency, samples_per_second);
+  const std::uint64_t right_period = period_frames(right_frequency, samples_per_second);
+  if (left_period == 0 || right_period == 0) {
+    return;
+  }
+  // The common period may be much longer than either period, e.g., 15,625 frames and 1,024
+  // frames make 16,000,000 frames. Such a loop is not used.
+  const std::uint64_t period = std::lcm(left_period, right_period);
+  if (period > static_cast<std::uint64_t>(samples_per_second)) {
+    return;
+  }
+  // The loop is allocated by `set_format`. It is not used if the format has been set otherwise,
+  // so that the render thread does not allocate memory.
+  const auto loop_frames =
+      static_cast<unsigned int>(period * ((MIN_LOOP_FRAMES + period - 1) / period));
+  const std::size_t loop_bytes =
+      static_cast<std::size_t>(loop_frames) * channels_count * bits_per_sample / 8;
+  if (loop_bytes <= m_loop.size()) {
+    m_loop_frames = loop_frames;
+  }
+}
+
+void ToneDataGenerator::capture_loop(const std::uint8_t *buffer, unsigned int frames_count) {
+  if (m_loop_frames == 0) {
+    return;
+  }
+  const unsigned int bytes_per_frame = channels_count * bits_per_sample / 8;
+  const unsigned int frames = std::min(frames_count, m_loop_frames - m_loop_captured);
+  std::memcpy(m_loop.data() + static_cast<std::size_t>(m_loop_captured) * bytes_per_frame,
+              buffer, static_cast<std::size_t>(frames) * bytes_per_frame);
+  m_loop_captured += frames;
+  // The frames after the end of the loop are the first frames of the next period.
+  m_loop_position = (frames_count - frames) % m_loop_frames;
+}
+
+void ToneDataGenerator::play_loop(std::uint8_t *buffer, unsigned int frames_count) {
+  const unsigned int bytes_per_frame = channels_count * bits_per_sample / 8;
+  for (unsigned int i = 0; i < frames_count;) {
+    const unsigned int frames = std::min(frames_count - i, m_loop_frames - m_loop_position);
+    std::memcpy(buffer + static_cast<std::size_t>(i) * bytes_per_frame,
+                m_loop.data() + static_cast<std::size_t>(m_loop_position) * bytes_per_frame,
+                static_cast<std::size_t>(frames) * bytes_per_frame);
+    i += frames;
+    m_loop_position = (m_loop_position + frames) % m_loop_frames;
+  }
+  m_left_phase += frames_count * phase_delta_of(m_left_frequency.current, samples_per_second);
+  m_right_phase += frames_count * phase_delta_of(m_right_frequency.current, samples_per_second);
+}
+
+void ToneDataGenerator::reset_to_frame(std::uint64_t frame) {
+  m_parameters_initialized = false;
+  update_ramp();
+  m_ramp_frames = 0;
+  m_left_silent = m_left_amplitude.current == 0;
+  m_right_silent = m_right_amplitude.current == 0;
+
+  // The phase advances by an integer per frame and wraps, so the product is exact.
+  m_left_phase = frame * phase_delta_of(left_frequency, samples_per_second);
+  m_right_phase = frame * phase_delta_of(right_frequency, samples_per_second);
+  update_pairs();
+  for (VoiceBank &voices : m_pair_voices) {
+    voices.reset_phases(frame);
+  }
+
+  if (m_has_timeline) {
+    // The frame 0 is the start of the timeline.
+    if (m_timeline_rate != samples_per_second) {
+      compile_timeline();
+    }
+    m_timeline_frame = std::min(frame, m_timeline_end);
+    m_timeline_running = frame < m_timeline_end;
+    m_left_timeline_phase = 0;
+    m_right_timeline_phase = 0;
+    m_left_phase = m_left_frequency_track.phase(frame);
+    m_right_phase = m_right_frequency_track.phase(frame);
+    if (m_timeline_running) {
+      apply_timeline_values(frame);
+    } else {
+      finish_timeline();
+    }
+    m_left_silent = m_left_amplitude.current == 0;
+    m_right_silent = m_right_amplitude.current == 0;
+  }
+
+  // The seeds of the generators of the channels are consecutive, as in the initial state.
+  const auto seed = static_cast<std::uint32_t>((frame * 0x9e3779b97f4a7c15u) >> 32);
+  m_left_quantizer = QuantizerState(seed + 1);
+  m_right_quantizer = QuantizerState(seed + 2);
+  m_left_noise = NoiseState(seed + 3);
+  m_right_noise = NoiseState(seed + 4);
+  m_loop_periodic = false;
+  for (std::uint32_t channel = 0; channel < MAX_ROUTED_CHANNELS; ++channel) {
+    m_channel_quantizers[channel] = QuantizerState(seed + 5 + channel);
+  }
+}
+
+void ToneDataGenerator::seek(std::uint64_t frame) {
+  const bool has_noise = white_noise_gain != 0 || pink_noise_gain != 0 || brown_noise_gain != 0;
+  const bool has_dither = !is_float && dither_mode != DitherMode::none;
+  if (!has_noise && !has_dither) {
+    // Every frame is a function of its index.
+    reset_to_frame(frame);
+    return;
+  }
+
+  // Start from the seek block, and render the frames up to `frame`.
+  const std::uint64_t block_start = frame - frame % SEEK_BLOCK_FRAMES;
+  const std::uint64_t warmup_frames = has_noise ? std::min(block_start, NOISE_WARMUP_FRAMES) : 0;
+  reset_to_frame(block_start - warmup_frames);
+  std::uint64_t preroll_frames = frame - block_start + warmup_frames;
+  std::vector<std::uint8_t> scratch(std::min<std::uint64_t>(preroll_frames, PREROLL_FRAMES) *
+                                    channels_count * bits_per_sample / 8);
+  while (preroll_frames > 0) {
+    const auto frames = static_cast<unsigned int>(
+        std::min<std::uint64_t>(preroll_frames, PREROLL_FRAMES));
+    write_tone_data(scratch.data(), frames, false);
+    preroll_frames -= frames;
+  }
+}
+
+void ToneDataGenerator::render_frames(std::uint8_t *buffer, std::uint64_t offset,
+                                      unsigned int frames_count) const {
+  const unsigned int bytes_per_frame = channels_count * bits_per_sample / 8;
+  ToneDataGenerator generator = *this;
+  // A frame of the loop can differ from the synthesized frame in the last bit.
+  generator.loop_playback = false;
+
+  // The frames are written in whole blocks of `BLOCK_FRAMES` aligned to the frame 0, so that they
+  // are assigned to the SIMD lanes of the oscillators, the noise, and the dither in the same way
+  // in any range. The blocks at the ends of the range are written to `scratch`, and only the
+  // frames in the range are copied.
+  auto head_frames = static_cast<unsigned int>(offset % BLOCK_FRAMES);
+  std::uint64_t position = offset - head_frames;
+  std::vector<std::uint8_t> scratch;
+  generator.seek(position);
+  while (frames_count > 0) {
+    unsigned int frames = 0;
+    if (head_frames != 0 || frames_count < BLOCK_FRAMES) {
+      scratch.resize(BLOCK_FRAMES * bytes_per_frame);
+      generator.write_tone_data(scratch.data(), BLOCK_FRAMES, false);
+      frames = std::min(BLOCK_FRAMES - head_frames, frames_count);
+      std::memcpy(buffer, scratch.data() + head_frames * bytes_per_frame,
+                  frames * bytes_per_frame);
+      head_frames = 0;
+      position += BLOCK_FRAMES;
+    } else {
+      frames = static_cast<unsigned int>(std::min<std::uint64_t>(
+          frames_count - frames_count % BLOCK_FRAMES,
+          SEEK_BLOCK_FRAMES - position % SEEK_BLOCK_FRAMES));
+      generator.write_tone_data(buffer, frames, false);
+      position += frames;
+    }
+    buffer += static_cast<std::size_t>(frames) * bytes_per_frame;
+    frames_count -= frames;
+    if (frames_count > 0 && position % SEEK_BLOCK_FRAMES == 0) {
+      generator.seek(position);
+    }
+  }
+}
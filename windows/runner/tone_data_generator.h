@@ -0,0 +1,463 @@
+/**
+ * @file tone_data_generator.h
+ * @brief `ToneDataGenerator` class declaration.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "dsp.h"
+#include "oscillator.h"
+#include "timeline.h"
+#include "voice_bank.h"
+
+// Constants.
+constexpr unsigned int MAX_ROUTED_CHANNELS = 32;  // Channels of a device that can be routed.
+constexpr unsigned int MAX_TONE_PAIRS = 8;        // Tone pairs played with the tone.
+
+/**
+ * @brief Gains from a channel of `ToneDataGenerator` to each channel of the device (0.0-1.0),
+ * indexed by the channel of the device.
+ */
+using ChannelGains = std::array<float, MAX_ROUTED_CHANNELS>;
+
+/**
+ * @brief The sample format of a device, with the fields of `WAVEFORMATEXTENSIBLE` used by
+ * `ToneDataGenerator`.
+ */
+struct DeviceFormat {
+  unsigned int bits_per_sample = 16;       // Bits of a sample in the buffer (`wBitsPerSample`).
+  unsigned int valid_bits_per_sample = 0;  // `wValidBitsPerSample`, or 0 if all bits are valid.
+  bool is_float = false;                   // `true` if the samples are IEEE floats.
+  double samples_per_second = 48000;       // Samples per second in Hz (`nSamplesPerSec`).
+  unsigned int channels_count = 2;         // Number of channels (`nChannels`).
+};
+
+/**
+ * @brief A carrier/beat pair of sine waves played with the tone of `ToneDataGenerator`, e.g., a
+ * theta layer under a delta tone, or the tone of another listening station.
+ */
+struct TonePair {
+  double amplitude = 0.0;        // Amplitude of both channels (0.0-1.0). 0 if the pair is off.
+  double left_frequency = 440;   // Frequency of the left channel in Hz.
+  double right_frequency = 440;  // Frequency of the right channel in Hz.
+  // If `true`, the pair is mixed into each channel of the device with its own gains, like the
+  // tone with `ToneDataGenerator::channel_routing`. If `false`, it is added to the left and right
+  // channels of the tone.
+  bool channel_routing = false;
+  ChannelGains left_channel_gains{};
+  ChannelGains right_channel_gains{};
+};
+
+/**
+ * @brief A class to generate wave data (sine wave).
+ * @details By setting the waveform data parameters in the public member variables and calling
+ * `write_tone_data`, the waveform data generated by the calculation is written to the buffer.
+ * This class does not depend on the Windows API, so that the rendering code can be built and
+ * measured on any platform.
+ */
+class ToneDataGenerator {
+ private:
+  /**
+   * @brief A parameter that follows its target value linearly.
+   */
+  struct SmoothedValue {
+    double current = 0.0;  // Value used to generate the next frame.
+    double target = 0.0;   // Value reached at the end of the ramp.
+    double step = 0.0;     // Change per frame during the ramp.
+  };
+
+  // Parameters actually used to generate waveform data. They follow the public parameters over
+  // `smoothing_time`, so that changes do not produce clicks.
+  SmoothedValue m_left_amplitude;
+  SmoothedValue m_right_amplitude;
+  SmoothedValue m_left_frequency;
+  SmoothedValue m_right_frequency;
+  unsigned int m_ramp_frames = 0;         // Remaining frames of the ramp. 0 if not ramping.
+  bool m_parameters_initialized = false;  // `false` until the first call of `write_tone_data`.
+
+  // The phases wrap at the end of each period, so they do not lose precision over long sessions.
+  Phase m_left_phase = 0;      // Phase of the next generated data (left).
+  Phase m_right_phase = 0;     // Phase of the next generated data (right).
+  bool m_left_silent = true;   // `true` if the left channel has reached 0 while stopping.
+  bool m_right_silent = true;  // `true` if the right channel has reached 0 while stopping.
+
+  // States of the dither of each channel.
+  QuantizerState m_left_quantizer{1};
+  QuantizerState m_right_quantizer{2};
+
+  // States of the dither of each channel of the device, used when the channels are routed.
+  std::vector<QuantizerState> m_channel_quantizers = make_channel_quantizers(5);
+
+  // States of the noise of each channel. The channels are uncorrelated.
+  NoiseState m_left_noise{3};
+  NoiseState m_right_noise{4};
+
+  // Voices of `pairs`. Each pair has its own bank, whose voice 0 is the left channel and voice 1
+  // is the right channel, so that it can be rendered apart from the others when it is routed.
+  std::array<VoiceBank, MAX_TONE_PAIRS> m_pair_voices = make_pair_voices();
+  std::array<TonePair, MAX_TONE_PAIRS> m_applied_pairs{};  // `pairs` applied to the voices.
+  double m_pairs_rate = 0.0;     // `samples_per_second` of the voices. 0 if not set.
+  bool m_has_pairs = false;      // `true` if a voice of the pairs sounds in the current call.
+  bool m_has_routed_pairs = false;  // `true` if a routed pair sounds in the current call.
+  bool m_is_stopping = false;    // `is_stopping` of the current call of `write_tone_data`.
+
+  // Timeline of the amplitudes and the frequencies (see `start_timeline`). The tracks are
+  // compiled for `m_timeline_rate`, and compiled again if `samples_per_second` changes.
+  Timeline m_timeline;
+  CompiledTrack m_left_amplitude_track;
+  CompiledTrack m_right_amplitude_track;
+  CompiledTrack m_left_frequency_track;
+  CompiledTrack m_right_frequency_track;
+  double m_timeline_rate = 0.0;         // Samples per second of the tracks. 0 if not compiled.
+  std::uint64_t m_timeline_frame = 0;   // Frames of the timeline written.
+  std::uint64_t m_timeline_end = 0;     // Length of the timeline in frames.
+  Phase m_left_timeline_phase = 0;      // Phase of the left channel at the frame 0.
+  Phase m_right_timeline_phase = 0;     // Phase of the right channel at the frame 0.
+  bool m_has_timeline = false;          // `true` from `start_timeline` to `stop_timeline`.
+  bool m_timeline_running = false;      // `true` until the end of the timeline.
+
+  /**
+   * @brief The public parameters that determine the output when it is periodic.
+   */
+  using LoopParameters = std::tuple<double, double, double, double, Waveform, Waveform,
+                                    OscillatorMode, WavetableSize, unsigned int, unsigned int,
+                                    bool, double, unsigned int>;
+
+  // Whole periods of the output, captured from the synthesized frames while the output is
+  // periodic, and played back by copying instead of the synthesis (see `loop_playback`).
+  std::vector<std::uint8_t> m_loop;
+  unsigned int m_loop_frames = 0;    // Length of the loop in frames. 0 if no loop is used.
+  unsigned int m_loop_captured = 0;  // Frames of the loop captured so far.
+  unsigned int m_loop_position = 0;  // Frame of the loop played next.
+  bool m_loop_periodic = false;      // `true` if the output was periodic in the last call.
+  LoopParameters m_loop_parameters;  // Parameters of the loop.
+  bool m_loop_channel_routing = false;      // `channel_routing` of the loop.
+  ChannelGains m_loop_left_channel_gains{};   // `left_channel_gains` of the loop.
+  ChannelGains m_loop_right_channel_gains{};  // `right_channel_gains` of the loop.
+
+  /**
+   * @brief Pointer to one of the instantiations of `write_frames`.
+   */
+  using Kernel = void (ToneDataGenerator::*)(std::uint8_t *, unsigned int, unsigned int,
+                                             unsigned int);
+
+  /**
+   * @brief Returns the states of the dither of the routed channels, whose seeds are consecutive
+   * from `seed`.
+   */
+  static std::vector<QuantizerState> make_channel_quantizers(std::uint32_t seed);
+
+  /**
+   * @brief Returns the voices of the pairs, which are stopped.
+   */
+  static std::array<VoiceBank, MAX_TONE_PAIRS> make_pair_voices();
+
+  /**
+   * @brief Applies the changes of `pairs` and `samples_per_second` to the voices of the pairs.
+   */
+  void update_pairs();
+
+  /**
+   * @brief Returns the kernel for the current format.
+   */
+  Kernel select_kernel() const;
+
+  /**
+   * @brief Compiles the tracks of the timeline for `samples_per_second`.
+   * @details The position of the timeline is kept in seconds.
+   */
+  void compile_timeline();
+
+  /**
+   * @brief Sets the phases at the frame 0 of the timeline from the current phases.
+   */
+  void rebase_timeline_phases();
+
+  /**
+   * @brief Sets the current values of the parameters to the values of the timeline at a frame.
+   */
+  void apply_timeline_values(std::uint64_t frame);
+
+  /**
+   * @brief Ends the timeline, and sets the parameters to its last values.
+   */
+  void finish_timeline();
+
+  /**
+   * @brief Renders a block of the left and right channels from the timeline.
+   * @param render_left The oscillator of the left channel.
+   * @param render_right The oscillator of the right channel.
+   * @param left_values A pointer to the buffer to write the left channel.
+   * @param right_values A pointer to the buffer to write the right channel.
+   * @param frames_count The maximum number of frames to render.
+   * @return The number of frames rendered. The block ends at the next boundary of the segments.
+   * @details The amplitudes are interpolated linearly within the block. The phases at the start
+   * and the end of the block are computed in closed form, and the phase delta of the block is
+   * set so that the block ends exactly at the end phase, so the phase does not drift.
+   */
+  unsigned int render_timeline_block(OscillatorFunction render_left,
+                                     OscillatorFunction render_right, float *left_values,
+                                     float *right_values, unsigned int frames_count);
+
+  /**
+   * @brief Restarts the capture of the loop if the output is no longer periodic with it.
+   * @details Called after `update_ramp`. The output is periodic if no ramp or timeline is
+   * running, there is no noise and no dither, and the frequencies are multiples of 0.001 Hz
+   * whose common period is a second or less. Every integer frequency has a period that divides
+   * `samples_per_second`.
+   */
+  void update_loop();
+
+  /**
+   * @brief Copies the synthesized frames to the loop until it is complete.
+   */
+  void capture_loop(const std::uint8_t *buffer, unsigned int frames_count);
+
+  /**
+   * @brief Writes the frames from the complete loop, and advances the phases as the synthesis.
+   */
+  void play_loop(std::uint8_t *buffer, unsigned int frames_count);
+
+  /**
+   * @brief Sets the state to that of a render that started at the frame 0 with the current
+   * parameters, as far as it can be computed in closed form.
+   * @param frame The index of the next frame to write.
+   * @details The parameters are applied at once without a ramp, and the phases are set to those
+   * of the frame. The noise and the dither are reseeded from the frame, and the noise filters
+   * start from 0.
+   */
+  void reset_to_frame(std::uint64_t frame);
+
+  /**
+   * @brief Starts a ramp toward the public parameters if they have been changed.
+   */
+  void update_ramp();
+
+  /**
+   * @brief Advances the smoothed parameters by the frames.
+   * @param frames_count The number of frames. `m_ramp_frames` or less.
+   */
+  void advance_ramp(unsigned int frames_count);
+
+  /**
+   * @brief Writes the frames with a kernel specialized for the sample format and channel layout.
+   * @tparam Format The sample format (see `tone_data_generator.cpp`).
+   * @tparam Channels The number of channels, or 0 to use `channels_count` at run time.
+   * @param buffer A pointer to the buffer to write the waveform data.
+   * @param frames_count The number of frames to write.
+   * @param left_frames The number of frames of the left channel to write before the sequence of
+   * 0. `frames_count` or less.
+   * @param right_frames The same as `left_frames` for the right channel.
+   * @details The phases advance by the larger of `left_frames` and `right_frames`, and the frames
+   * after that are filled with silence at once. While a ramp is active, the amplitudes change
+   * per frame and the frequencies per block of frames.
+   */
+  template <class Format, unsigned int Channels>
+  void write_frames(std::uint8_t *buffer, unsigned int frames_count, unsigned int left_frames,
+                    unsigned int right_frames);
+
+  /**
+   * @brief Mixes a block of the left and right channels and of the routed pairs into the channels
+   * of the device with their gains, and writes it to the buffer.
+   * @tparam Format The sample format (see `tone_data_generator.cpp`).
+   * @param output A pointer to the first frame of the block in the buffer.
+   * @param left_values The values of the left channel. The values from `left_end` are set to 0.
+   * @param right_values The same as `left_values` for the right channel.
+   * @param pair_values The values of the routed pairs, in blocks of `BLOCK_FRAMES` (see
+   * `tone_data_generator.cpp`). The block `2 * i` is the left channel of the pair `i`, and the
+   * block `2 * i + 1` is its right channel.
+   * @param pair_ends The number of frames of each routed pair before the silence. 0 if the pair
+   * is not routed or does not sound.
+   * @param frames_count The number of frames of the block.
+   * @param channels The number of channels of the device.
+   * @param left_end The number of frames of the left channel before the silence while stopping.
+   * @param right_end The same as `left_end` for the right channel.
+   * @param valid_bits The number of valid bits of the samples.
+   * @details Each channel of the device is mixed from the whole block at once, so there are no
+   * branches per sample. Without `channel_routing`, the left and right channels are mixed into
+   * the first two channels. The channels without a source are filled with silence in bulk.
+   */
+  template <class Format>
+  void write_routed_block(typename Format::Sample *output, float *left_values,
+                          float *right_values, const float *pair_values,
+                          const unsigned int *pair_ends, unsigned int frames_count,
+                          unsigned int channels, unsigned int left_end, unsigned int right_end,
+                          unsigned int valid_bits);
+
+ public:
+  // Parameters used to generate waveform data.
+  double left_amplitude;         // Amplitude of the left channel (0.0-1.0).
+  double right_amplitude;        // Amplitude of the right channel (0.0-1.0).
+  double left_frequency;         // Frequency of the left channel in Hz.
+  double right_frequency;        // Frequency of the right channel in Hz.
+  unsigned int bits_per_sample;  // Bits per sample in the buffer (8, 16, 24, or 32).
+  // Bits per sample that hold the data (`bits_per_sample` or less). The data is left-justified in
+  // the sample, and the lower bits are 0. Used by the 24- and 32-bit integer formats.
+  unsigned int valid_bits_per_sample = 0;
+  bool is_float = false;  // `true` if the samples are IEEE floats. Only with 32 bits per sample.
+  double samples_per_second;     // Samples per second in Hz. Must be greater than the frequency.
+  unsigned int channels_count;   // Number of channels (2 or more).
+
+  // Time in seconds over which changes of the amplitudes and the frequencies are ramped linearly.
+  // 0 applies the changes at once.
+  double smoothing_time = 0.05;
+
+  // Waveforms of the channels.
+  Waveform left_waveform = Waveform::sine;
+  Waveform right_waveform = Waveform::sine;
+
+  // Algorithm used to compute the sine waves. This can be changed between the calls of
+  // `write_tone_data` to compare the CPU cost and the spectral purity on the same buffers.
+  OscillatorMode oscillator_mode = OscillatorMode::polynomial;
+  WavetableSize wavetable_size = WavetableSize::medium;  // Used by the wavetable modes.
+
+  // Gains of the noise beds mixed under the sine waves in both channels (0.0-1.0). At 1.0, the
+  // RMS of each noise is -12 dBFS (see `add_noise`). The noise stops with the sine waves.
+  double white_noise_gain = 0.0;
+  double pink_noise_gain = 0.0;
+  double brown_noise_gain = 0.0;
+
+  // Carrier/beat pairs, each rendered by a `VoiceBank` with its own phases. A pair is added to
+  // the left and right channels, or routed to the channels of the device with its own gains, so
+  // that one device can play several independent stereo pairs. A pair starts and stops at the
+  // zero crossings of its sine waves, and its changes are applied at the next call of
+  // `write_tone_data` without a ramp. The pairs stop with the tone.
+  std::array<TonePair, MAX_TONE_PAIRS> pairs{};
+
+  // If `true`, the left and right channels are mixed into each channel of the device with
+  // `left_channel_gains` and `right_channel_gains`. This is used to drive several stereo pairs of
+  // a multichannel device. Each routed channel has its own dither, and the channels after
+  // `MAX_ROUTED_CHANNELS` are silent. If `false`, the left and right channels are written to the
+  // first two channels, and the others are silent.
+  bool channel_routing = false;
+  ChannelGains left_channel_gains{};
+  ChannelGains right_channel_gains{};
+
+  // Dither applied when the waveform data is written in integers.
+  DitherMode dither_mode = DitherMode::tpdf;
+
+  // If `true`, a periodic output is synthesized for one loop (a second or less), and then played
+  // back from the loop by copying, which takes almost no CPU time. The output is periodic while
+  // the parameters are steady, there is no noise, and the samples are not dithered (floats, or
+  // `DitherMode::none`), since a repeated dither would turn its noise into tones.
+  bool loop_playback = true;
+
+  /**
+   * @brief Sets the sample format and the layout of the buffer to those of a device.
+   * @param format The format of the device.
+   * @return `false` if the format is not supported, in which case nothing is changed. Integer
+   * samples of 8, 16, 24 (packed in 3 bytes), or 32 bits, and float samples of 32 bits with 2 or
+   * more channels are supported. The valid bits must be 8 or more.
+   * @details The memory of the loop (see `loop_playback`) is allocated for the format here, so
+   * that `write_tone_data` does not allocate memory. Call this function when the device is
+   * prepared, not for each buffer.
+   */
+  bool set_format(const DeviceFormat &format);
+
+  /**
+   * If `stopping` is `true` in the call of `write_tone_data`, glitches can occur if
+   * playback is stopped immediately. To prevent this, playback continues until the waveform data
+   * value reaches 0, after which sequence of 0 is written to the buffer. This function is used
+   * to determine if the value has reached 0 for both the left and right channels.
+   */
+  bool is_silent = false;
+
+  /**
+   * @brief Function to write waveform data to the buffer.
+   * @param buffer A pointer to the buffer to write the waveform data.
+   * @param frames_count The number of frames to write.
+   * @param is_stopping If true, waveform data is written to the point where the value reaches 0,
+   * then sequence of 0 is written after that. The square wave, which does not pass through 0,
+   * stops at an edge.
+   * @details The kernel is selected once per call from the sample format and `channels_count`, so
+   * that the per-frame loop has no branches on these values. When stopping, the number of frames
+   * until each channel crosses zero is computed from its phase, so the stopping path uses the
+   * same kernel.
+   */
+  void write_tone_data(std::uint8_t *buffer, unsigned int frames_count, bool is_stopping);
+
+  /**
+   * @brief Starts a timeline of the amplitudes and the frequencies from the next frame.
+   * @param timeline The timeline. The values must be in the ranges of the parameters.
+   * @details While the timeline is running, `left_amplitude`, `right_amplitude`,
+   * `left_frequency`, and `right_frequency` are ignored, and the values of the timeline are used
+   * for every frame. The frames of the timeline are counted only while the tone is written, so
+   * the timeline pauses while stopping and while the playback is stopped. When the timeline
+   * ends, the four parameters are set to its last values, and the tone continues with them.
+   * `seek` and `render_frames` follow the timeline from its frame 0.
+   */
+  void start_timeline(const Timeline &timeline);
+
+  /**
+   * @brief Allocates the memory for the timelines, so that `start_timeline` and `write_tone_data`
+   * do not allocate memory for a timeline with up to `segments_count` segments per track.
+   */
+  void reserve_timeline(std::size_t segments_count);
+
+  /**
+   * @brief Stops the timeline. The parameters ramp from the values of the timeline to the public
+   * parameters over `smoothing_time`.
+   */
+  void stop_timeline();
+
+  /**
+   * @brief `true` from `start_timeline` until the end of the timeline or `stop_timeline`.
+   */
+  bool timeline_running() const { return m_timeline_running; }
+
+  /**
+   * @brief Seconds of the timeline written.
+   */
+  double timeline_position() const {
+    return m_timeline_rate != 0 ? static_cast<double>(m_timeline_frame) / m_timeline_rate : 0.0;
+  }
+
+  /**
+   * @brief Length of the timeline in seconds.
+   */
+  double timeline_duration() const {
+    return m_timeline_rate != 0 ? static_cast<double>(m_timeline_end) / m_timeline_rate : 0.0;
+  }
+
+  /**
+   * @brief The amplitudes and the frequencies used for the next frame. They follow the
+   * parameters over `smoothing_time`, or the timeline.
+   */
+  double current_left_amplitude() const { return m_left_amplitude.current; }
+  double current_right_amplitude() const { return m_right_amplitude.current; }
+  double current_left_frequency() const { return m_left_frequency.current; }
+  double current_right_frequency() const { return m_right_frequency.current; }
+
+  /**
+   * @brief Moves the generator to a frame of the render of `render_frames`.
+   * @param frame The index of the next frame to write.
+   * @details If `frame` and the sizes of the next calls of `write_tone_data` are multiples of 64,
+   * the frames written by them are the same as those of `render_frames` up to the end of the seek
+   * block. Otherwise, they can differ slightly, because the frames are assigned to the SIMD lanes
+   * in blocks from the start of each call. The parameters are applied at once without a ramp.
+   * When the noise or the dither is used, the frames from the start of the seek block are
+   * rendered and discarded, so this takes up to a few milliseconds.
+   */
+  void seek(std::uint64_t frame);
+
+  /**
+   * @brief Renders frames at any position of a render that started at the frame 0 with the
+   * current parameters, without changing the generator.
+   * @param buffer A pointer to the buffer to write the waveform data.
+   * @param offset The index of the first frame to write.
+   * @param frames_count The number of frames to write.
+   * @details The phases of the tone are computed in closed form from the frame index, so a frame
+   * has the same value whichever range it is rendered in, and the ranges can be rendered
+   * independently, in any order, and in parallel. The noise and the dither, which are sequential,
+   * are reseeded from the frame index at the start of each seek block (65536 frames), after the
+   * noise filters have been run over the frames before it, so they are also the same in any
+   * range. The stopping path is not used.
+   */
+  void render_frames(std::uint8_t *buffer, std::uint64_t offset, unsigned int frames_count) const;
+};
@@ -7,12 +7,30 @@
 
 #include <functiondiscoverykeys_devpkey.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iomanip>
 #include <sstream>
 
 // Constants.
-constexpr double PI = 3.14159265358979323846;
+// Range of the frequencies of the tone (Hz). The highest is below the Nyquist frequency of the
+// usual rates (44.1 kHz and more).
+constexpr double MIN_FREQUENCY = 0.001;
+constexpr double MAX_FREQUENCY = 20000;
+constexpr double MAX_SEGMENT_DURATION = 7 * 24 * 60 * 60;  // Longest segment of a timeline (s).
+constexpr double PROGRESS_INTERVAL = 1.0;  // Interval of the reports of the timeline progress (s).
+// The device is initialized again when no notification of the device has been received for
+// `DEVICE_SETTLE_TIME` milliseconds, or `DEVICE_SETTLE_MAX_TIME` milliseconds after the first
+// one at the latest. A change of the default device notifies each role in a burst of a few
+// milliseconds.
+constexpr ULONGLONG DEVICE_SETTLE_TIME = 50;
+constexpr ULONGLONG DEVICE_SETTLE_MAX_TIME = 500;
+// The client is stopped `DRAIN_MARGIN_TIME` milliseconds plus the latency after the end of the
+// playback has been written, so that the data written is played.
+constexpr ULONGLONG DRAIN_MARGIN_TIME = 100;
+constexpr unsigned int RENDER_AHEAD_BLOCK_TIME = 5;  // Rendered at a time into the ring (ms).
+constexpr unsigned int MAX_LATENCY = 2000;           // Maximum latency of the client (ms).
 
 /**
  * @brief Helper function to safely release a COM interface pointer.
@@ -27,6 +45,97 @@ static void safe_release(T **ppT) {
   }
 }
 
+/**
+ * @brief Helper function to validate the parameters of the waves.
+ * @exception `std::invalid_argument` is thrown if the parameters are out of range.
+ */
+static void validate_wave_parameters(double left_amplitude, double right_amplitude,
+                                     double left_frequency, double right_frequency) {
+  if (left_amplitude < 0 || left_amplitude > 1 || right_amplitude < 0 || right_amplitude > 1) {
+    throw std::invalid_argument("Amplitude must be in the range [0, 1].");
+  }
+  // The negated comparisons also reject NaN.
+  for (double frequency : {left_frequency, right_frequency}) {
+    if (!(frequency >= MIN_FREQUENCY && frequency <= MAX_FREQUENCY)) {
+      throw std::invalid_argument("Frequencies must be in the range [0.001, 20000].");
+    }
+  }
+}
+
+/**
+ * @brief Helper function to validate the gains of the noise.
+ * @exception `std::invalid_argument` is thrown if the gains are out of range.
+ */
+static void validate_noise_parameters(double white_gain, double pink_gain, double brown_gain) {
+  for (double gain : {white_gain, pink_gain, brown_gain}) {
+    if (gain < 0 || gain > 1) {
+      throw std::invalid_argument("Noise gains must be in the range [0, 1].");
+    }
+  }
+}
+
+/**
+ * @brief Helper function to validate the gains of the speaker positions.
+ * @exception `std::invalid_argument` is thrown if the gains are out of range, or the sizes are
+ * different.
+ */
+static void validate_speaker_gains(const std::vector<double> &left_gains,
+                                   const std::vector<double> &right_gains) {
+  if (left_gains.size() != right_gains.size() || left_gains.size() > SPEAKER_POSITIONS_COUNT) {
+    throw std::invalid_argument(
+        "Channel gains must have the same size for both channels, up to 18 positions.");
+  }
+  for (const auto *gains : {&left_gains, &right_gains}) {
+    for (double gain : *gains) {
+      if (gain < 0 || gain > 1) {
+        throw std::invalid_argument("Channel gains must be in the range [0, 1].");
+      }
+    }
+  }
+}
+
+/**
+ * @brief Helper function to validate a latency.
+ * @exception `std::invalid_argument` is thrown if the latency is out of range.
+ */
+static void validate_latency(unsigned int latency) {
+  if (latency == 0 || latency > MAX_LATENCY) {
+    throw std::invalid_argument("Latency must be in the range [1, 2000] ms.");
+  }
+}
+
+/**
+ * @brief Helper function to validate a track of a timeline.
+ * @param track The track.
+ * @param min_value The minimum value.
+ * @param max_value The maximum value.
+ * @exception `std::invalid_argument` is thrown if the track is invalid.
+ */
+static void validate_track(const TimelineTrack &track, double min_value, double max_value) {
+  double value = track.start_value;
+  if (!(value >= min_value && value <= max_value)) {
+    throw std::invalid_argument("Timeline values are out of range.");
+  }
+  if (track.segments.size() > MAX_TIMELINE_SEGMENTS) {
+    throw std::invalid_argument("Timeline tracks must have at most 1024 segments.");
+  }
+  for (const TimelineSegment &segment : track.segments) {
+    if (!(segment.duration >= 0 && segment.duration <= MAX_SEGMENT_DURATION)) {
+      throw std::invalid_argument("Timeline durations must be in the range [0, 1 week].");
+    }
+    if (segment.shape == SegmentShape::hold) {
+      continue;
+    }
+    if (!(segment.end_value >= min_value && segment.end_value <= max_value)) {
+      throw std::invalid_argument("Timeline values are out of range.");
+    }
+    if (segment.shape == SegmentShape::exponential && (value <= 0 || segment.end_value <= 0)) {
+      throw std::invalid_argument("Exponential segments must have positive values.");
+    }
+    value = segment.end_value;
+  }
+}
+
 /**
  * @brief Helper function to safely close a handle.
  * @param ph A pointer to the handle.
@@ -53,6 +162,42 @@ static HANDLE create_event() {
   return event;
 }
 
+/**
+ * @brief Helper function to create a waitable timer.
+ * @return The handle to the timer.
+ * @exception `std::runtime_error` is thrown if `CreateWaitableTimerEx` fails.
+ */
+static HANDLE create_timer() {
+  // The high resolution timer is not available before Windows 10, version 1803.
+  HANDLE timer = CreateWaitableTimerEx(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                       TIMER_MODIFY_STATE | SYNCHRONIZE);
+  if (timer == NULL) {
+    timer = CreateWaitableTimerEx(NULL, NULL, 0, TIMER_MODIFY_STATE | SYNCHRONIZE);
+  }
+  if (timer == NULL) {
+    std::stringstream ss;
+    ss << "CreateWaitableTimerEx failed. GetLastError: " << GetLastError();
+    throw std::runtime_error(ss.str());
+  }
+  return timer;
+}
+
+/**
+ * @brief Helper function to set a waitable timer.
+ * @param timer The handle to the timer.
+ * @param milliseconds The time until the timer is signaled.
+ * @exception `std::runtime_error` is thrown if `SetWaitableTimer` fails.
+ */
+static void set_timer(HANDLE timer, ULONGLONG milliseconds) {
+  LARGE_INTEGER due_time;
+  due_time.QuadPart = -static_cast<LONGLONG>(milliseconds * 10000);  // Relative, in 100 ns.
+  if (SetWaitableTimer(timer, &due_time, 0, NULL, NULL, FALSE) == 0) {
+    std::stringstream ss;
+    ss << "SetWaitableTimer failed. GetLastError: " << GetLastError();
+    throw std::runtime_error(ss.str());
+  }
+}
+
 /**
  * @brief Helper function to set an event.
  * @param event The handle to the event object.
@@ -79,79 +224,6 @@ static void reset_event(HANDLE event) {
   }
 }
 
-void ToneGenerator::ToneDataGenerator::write_tone_data(BYTE *buffer, unsigned int frames_count,
-                                                       bool is_stopping) {
-  assert(channels_count >= 2);
-  assert(bits_per_sample == 8 || bits_per_sample == 16 || bits_per_sample == 32);
-  assert(left_frequency > 0 && right_frequency > 0);
-  assert(left_frequency < samples_per_second && right_frequency < samples_per_second);
-
-  double left_phase_delta = 2 * PI * left_frequency / samples_per_second;
-  double right_phase_delta = 2 * PI * right_frequency / samples_per_second;
-
-  for (unsigned int i = 0; i < frames_count; ++i) {
-    double left_value = left_amplitude * std::sin(m_left_phase);
-    double right_value = right_amplitude * std::sin(m_right_phase);
-    if (is_stopping) {
-      // The value of the waveform data is determined to have reached to zero if the immediately
-      // preceding value is zero or has a different sign.
-      if (m_left_prev_sign == 0 || left_value > 0 && m_left_prev_sign < 0 ||
-          left_value < 0 && m_left_prev_sign > 0) {
-        left_value = 0;
-      }
-      if (m_right_prev_sign == 0 || right_value > 0 && m_right_prev_sign < 0 ||
-          right_value < 0 && m_right_prev_sign > 0) {
-        right_value = 0;
-      }
-      is_silent = (left_value == 0 && right_value == 0);
-    } else {
-      is_silent = false;
-    }
-    m_left_prev_sign = left_value > 0 ? 1 : left_value < 0 ? -1 : 0;
-    m_right_prev_sign = right_value > 0 ? 1 : right_value < 0 ? -1 : 0;
-
-    if (bits_per_sample == 8) {
-      UINT8 *wave_data = static_cast<UINT8 *>(buffer);
-      wave_data[i * channels_count] = static_cast<UINT8>(left_value * 127 + 128);
-      wave_data[i * channels_count + 1] = static_cast<UINT8>(right_value * 127 + 128);
-      for (unsigned int j = 2; j < channels_count; ++j) {
-        wave_data[i * channels_count + j] = 128;
-      }
-    } else if (bits_per_sample == 16) {
-      INT16 *wave_data = reinterpret_cast<INT16 *>(buffer);
-      wave_data[i * channels_count] = static_cast<INT16>(left_value * 32767);
-      wave_data[i * channels_count + 1] = static_cast<INT16>(right_value * 32767);
-      for (unsigned int j = 2; j < channels_count; ++j) {
-        wave_data[i * channels_count + j] = 0;
-      }
-    } else if (bits_per_sample == 32) {
-      float *wave_data = reinterpret_cast<float *>(buffer);
-      wave_data[i * channels_count] = static_cast<float>(left_value);
-      wave_data[i * channels_count + 1] = static_cast<float>(right_value);
-      for (unsigned int j = 2; j < channels_count; ++j) {
-        wave_data[i * channels_count + j] = 0.0f;
-      }
-    }
-
-    m_left_phase += left_phase_delta;
-    m_right_phase += right_phase_delta;
-    while (m_left_phase >= 2 * PI) {
-      m_left_phase -= 2 * PI;
-    }
-    while (m_right_phase >= 2 * PI) {
-      m_right_phase -= 2 * PI;
-    }
-    if (is_stopping) {
-      if (left_value == 0) {
-        m_left_phase = 0;
-      }
-      if (right_value == 0) {
-        m_right_phase = 0;
-      }
-    }
-  }
-}
-
 ULONG ToneGenerator::AudioEventHandler::AddRef() {
   return InterlockedIncrement(&m_reference_count);
 }
@@ -292,20 +364,33 @@ void ToneGenerator::AudioApiWrapper::initialize_device(unsigned int latency,
         "(ToneGenerator::initialize_device).");
   }
 
+  // The valid bits are given only by `WAVEFORMATEXTENSIBLE`. Otherwise, all bits are valid.
+  DeviceFormat format;
+  format.bits_per_sample = m_wave_format->Format.wBitsPerSample;
+  format.samples_per_second = m_wave_format->Format.nSamplesPerSec;
+  format.channels_count = m_wave_format->Format.nChannels;
   if (m_wave_format->Format.wFormatTag == WAVE_FORMAT_EXTENSIBLE) {
     if (m_wave_format->SubFormat != KSDATAFORMAT_SUBTYPE_PCM &&
         m_wave_format->SubFormat != KSDATAFORMAT_SUBTYPE_IEEE_FLOAT) {
       throw std::runtime_error("Unsupported format (ToneGenerator::initialize_device).");
     }
+    format.is_float = m_wave_format->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
+    format.valid_bits_per_sample = m_wave_format->Samples.wValidBitsPerSample;
   } else {
-    if (m_wave_format->Format.wFormatTag != WAVE_FORMAT_PCM) {
+    if (m_wave_format->Format.wFormatTag != WAVE_FORMAT_PCM &&
+        m_wave_format->Format.wFormatTag != WAVE_FORMAT_IEEE_FLOAT) {
       throw std::runtime_error("Unsupported format (ToneGenerator::initialize_device).");
     }
+    format.is_float = m_wave_format->Format.wFormatTag == WAVE_FORMAT_IEEE_FLOAT;
   }
 
-  tone_data_generator.bits_per_sample = m_wave_format->Format.wBitsPerSample;
-  tone_data_generator.samples_per_second = m_wave_format->Format.nSamplesPerSec;
-  tone_data_generator.channels_count = m_wave_format->Format.nChannels;
+  // Integer samples of 8, 16, 24, or 32 bits, or float samples of 32 bits.
+  if (!tone_data_generator.set_format(format)) {
+    ss << "Unsupported format. " << format.bits_per_sample << " bit ("
+       << format.valid_bits_per_sample << " valid bits) " << (format.is_float ? "float" : "integer")
+       << " samples (ToneGenerator::initialize_device).";
+    throw std::runtime_error(ss.str());
+  }
 
   hr = m_client->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
                             static_cast<REFERENCE_TIME>(latency) * 10000, 0,
@@ -350,6 +435,134 @@ void ToneGenerator::AudioApiWrapper::initialize_device(unsigned int latency,
   m_device_initialized = true;
 }
 
+UINT32 ToneGenerator::AudioApiWrapper::resize_buffer(unsigned int latency,
+                                                    HANDLE buffer_ready_event) {
+  assert(m_device_initialized);
+
+  HRESULT hr;
+  std::stringstream ss;
+  assert(!m_retired_client);
+
+  IAudioClient *client = NULL;
+  IAudioRenderClient *render_client = NULL;
+  UINT32 buffer_size = 0;
+  UINT32 remaining = 0;
+  try {
+    hr = m_device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, NULL,
+                            reinterpret_cast<void **>(&client));
+    if (FAILED(hr)) {
+      ss << "IMMDevice::Activate failed. HRESULT: " << std::hex << hr;
+      throw std::runtime_error(ss.str());
+    }
+
+    hr = client->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                            static_cast<REFERENCE_TIME>(latency) * 10000, 0,
+                            reinterpret_cast<WAVEFORMATEX *>(m_wave_format), NULL);
+    if (FAILED(hr)) {
+      ss << "IAudioClient::Initialize failed. HRESULT: " << std::hex << hr;
+      throw std::runtime_error(ss.str());
+    }
+
+    hr = client->SetEventHandle(buffer_ready_event);
+    if (FAILED(hr)) {
+      ss << "IAudioClient::SetEventHandle failed. HRESULT: " << std::hex << hr;
+      throw std::runtime_error(ss.str());
+    }
+
+    hr = client->GetService(IID_PPV_ARGS(&render_client));
+    if (FAILED(hr)) {
+      ss << "IAudioClient::GetService failed. HRESULT: " << std::hex << hr;
+      throw std::runtime_error(ss.str());
+    }
+
+    hr = client->GetBufferSize(&buffer_size);
+    if (FAILED(hr)) {
+      ss << "IAudioClient::GetBufferSize failed. HRESULT: " << std::hex << hr;
+      throw std::runtime_error(ss.str());
+    }
+
+    if (m_client_started) {
+      // Both clients are mixed by the audio engine in the same periods, so the new client plays
+      // its first frame of wave data right after the last frame of the old client. The padding
+      // is read just before the start to keep them in the same period.
+      UINT32 padding;
+      hr = m_client->GetCurrentPadding(&padding);
+      if (FAILED(hr)) {
+        ss << "IAudioClient::GetCurrentPadding failed. HRESULT: " << std::hex << hr;
+        throw std::runtime_error(ss.str());
+      }
+      const UINT32 silence = std::min(padding, buffer_size);
+      if (silence != 0) {
+        BYTE *buffer;
+        hr = render_client->GetBuffer(silence, &buffer);
+        if (FAILED(hr)) {
+          ss << "IAudioRenderClient::GetBuffer failed. HRESULT: " << std::hex << hr;
+          throw std::runtime_error(ss.str());
+        }
+        hr = render_client->ReleaseBuffer(silence, AUDCLNT_BUFFERFLAGS_SILENT);
+        if (FAILED(hr)) {
+          ss << "IAudioRenderClient::ReleaseBuffer failed. HRESULT: " << std::hex << hr;
+          throw std::runtime_error(ss.str());
+        }
+      }
+      hr = client->Start();
+      if (FAILED(hr)) {
+        ss << "IAudioClient::Start failed. HRESULT: " << std::hex << hr;
+        throw std::runtime_error(ss.str());
+      }
+      remaining = padding - silence;
+    }
+  } catch (const std::runtime_error &e) {
+    safe_release(&render_client);
+    if (client) {
+      client->Stop();
+    }
+    safe_release(&client);
+    throw e;
+  }
+
+  // The session is shared by the clients of the process, so `m_session_control` is kept.
+  if (m_client_started) {
+    m_retired_client = m_client;
+  } else {
+    safe_release(&m_client);
+  }
+  safe_release(&m_render_client);
+  m_client = client;
+  m_render_client = render_client;
+  m_buffer_size = buffer_size;
+  return remaining;
+}
+
+void ToneGenerator::AudioApiWrapper::release_retired_client(bool force) {
+  if (!m_retired_client) {
+    return;
+  }
+  UINT32 padding = 0;
+  if (!force && SUCCEEDED(m_retired_client->GetCurrentPadding(&padding)) && padding != 0) {
+    return;
+  }
+  m_retired_client->Stop();
+  safe_release(&m_retired_client);
+}
+
+void ToneGenerator::AudioApiWrapper::write_silence(UINT32 frames) {
+  HRESULT hr;
+  std::stringstream ss;
+
+  BYTE *buffer;
+  hr = m_render_client->GetBuffer(frames, &buffer);
+  if (FAILED(hr)) {
+    ss << "IAudioRenderClient::GetBuffer failed. HRESULT: " << std::hex << hr;
+    throw std::runtime_error(ss.str());
+  }
+  hr = m_render_client->ReleaseBuffer(frames, AUDCLNT_BUFFERFLAGS_SILENT);
+  if (FAILED(hr)) {
+    ss << "IAudioRenderClient::ReleaseBuffer failed. HRESULT: " << std::hex << hr;
+    throw std::runtime_error(ss.str());
+  }
+}
+
 std::string ToneGenerator::AudioApiWrapper::get_device_info() {
   if (!m_device || !m_wave_format) {
     throw std::runtime_error("Audio device information is not available.");
@@ -403,9 +616,18 @@ std::string ToneGenerator::AudioApiWrapper::get_device_info() {
 
     device_name.resize(len - 1);
 
-    ss << device_name << "\n[" << m_wave_format->Format.wBitsPerSample << " bit, "
+    const bool is_float =
+        m_wave_format->Format.wFormatTag == WAVE_FORMAT_IEEE_FLOAT ||
+        (m_wave_format->Format.wFormatTag == WAVE_FORMAT_EXTENSIBLE &&
+         m_wave_format->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT);
+    ss << device_name << "\n[" << m_wave_format->Format.wBitsPerSample
+       << (is_float ? " bit float, " : " bit, ")
        << std::setprecision(4) << static_cast<double>(m_wave_format->Format.nSamplesPerSec) / 1000.0
-       << " kHz, " << m_wave_format->Format.nChannels << " channels]";
+       << " kHz, " << m_wave_format->Format.nChannels << " channels";
+    if (channel_mask() != 0) {
+      ss << ", mask 0x" << std::hex << channel_mask();
+    }
+    ss << "]";
 
     PropVariantClear(&name);
     safe_release(&props);
@@ -456,6 +678,7 @@ void ToneGenerator::AudioApiWrapper::stop_client() {
     throw std::runtime_error(ss.str());
   }
 
+  release_retired_client(true);
   m_client_started = false;
 }
 
@@ -468,6 +691,7 @@ void ToneGenerator::AudioApiWrapper::cleanup_device() {
   if (m_client && m_client_started) {
     m_client->Stop();
   }
+  release_retired_client(true);
   m_client_started = false;
 
   if (m_session_control && m_event_handler && m_session_callback_registered) {
@@ -505,22 +729,39 @@ DWORD ToneGenerator::render_thread(LPVOID lpParam) {
   ToneGenerator &instance = *static_cast<ToneGenerator *>(lpParam);
   std::stringstream ss;
 
+  // The scheduling is restored when the thread exits.
+  const RealtimeScope realtime(instance.m_realtime_options);
+  instance.m_realtime_status = realtime.status();
+
   try {
     instance.m_audio_api_wrapper.initialize(instance);
-    instance.initialize_device();
+    {
+      std::lock_guard<std::mutex> lock(instance.m_render_mutex);
+      instance.initialize_device();
+    }
 
     HANDLE events[] = {instance.m_exit_event,
                        instance.m_stream_switch_event,
                        instance.m_release_device_event,
                        instance.m_parameter_changed_event,
                        instance.m_play_state_changed_event,
-                       instance.m_buffer_ready_event};
+                       instance.m_buffer_ready_event,
+                       instance.m_command_queued_event,
+                       instance.m_device_settle_timer,
+                       instance.m_drain_timer};
 
     // Event loop.
     while (true) {
       DWORD result =
           WaitForMultipleObjects(sizeof(events) / sizeof(HANDLE), events, FALSE, INFINITE);
 
+      // The events are handled while `m_render_mutex` is locked, so that the producer thread
+      // does not render meanwhile. The copy from the render-ahead ring does not need it.
+      std::unique_lock<std::mutex> lock(instance.m_render_mutex, std::defer_lock);
+      if (result != WAIT_OBJECT_0 + 5 || instance.m_render_ahead == 0) {
+        lock.lock();
+      }
+
       if (result == WAIT_OBJECT_0) {  // exit_event
         instance.m_is_stopping = true;
         instance.m_is_exiting = true;
@@ -535,73 +776,27 @@ DWORD ToneGenerator::render_thread(LPVOID lpParam) {
         // recreated (e.g., the default audio device has been changed).
         // The release device event is set when the current audio device needs to be
         // released (e.g., the current audio device has been disconnected).
-
-        // Release the current audio device.
-        if (instance.m_audio_api_wrapper.device_initialized()) {
-          if (instance.m_audio_api_wrapper.client_started()) {
-            instance.stop_client();
-          }
-          instance.cleanup_device();
-        }
-
-        // Since the stream switch event and the release device event might be set multiple times
-        // in a short period, wait for a while before initializing the audio device.
-        bool initialization_required = result == WAIT_OBJECT_0 + 1;  // stream_switch_event
-        Sleep(500);
-        switch (WaitForSingleObject(instance.m_stream_switch_event, 0)) {
-          case WAIT_OBJECT_0:
-            initialization_required = true;
-            break;
-          case WAIT_TIMEOUT:
-            break;
-          case WAIT_FAILED:
-            ss << "WaitForSingleObject failed. GetLastError: " << GetLastError();
-            throw std::runtime_error(ss.str());
-        }
-        reset_event(instance.m_release_device_event);
-
-        if (initialization_required) {
-          instance.initialize_device();
-          if (instance.m_audio_api_wrapper.device_initialized()) {
-            {
-              bool is_playing;
-              {
-                std::lock_guard<std::mutex> lock(instance.m_mutex);
-                is_playing = instance.m_is_playing;
-              }
-              if (is_playing) {
-                // If the audio was playing before the stream switch event,
-                // start playing the audio again.
-                instance.write_wave_data();  // Prevent glitches.
-                instance.start_client();
-              }
-            }
-          }
-        }
+        instance.on_device_notification(result == WAIT_OBJECT_0 + 1);
       } else if (result == WAIT_OBJECT_0 + 3) {  // parameter_changed_event
         // The parameter changed event is set when the audio parameters (e.g., amplitude,
         // frequency) have been changed by the user of this class.
         if (!instance.m_audio_api_wrapper.device_initialized()) {
-          instance.initialize_device();
+          // The parameters are applied when the device is initialized.
+          instance.prepare_device();
         } else {
           instance.update_wave_parameters();
         }
       } else if (result == WAIT_OBJECT_0 + 4) {  // play_state_changed_event
         // The play state changed event is set when the play state (playing or stopped) has
         // been changed by the user of this class.
-        bool is_playing;
-        {
-          std::lock_guard<std::mutex> lock(instance.m_mutex);
-          is_playing = instance.m_is_playing;
-        }
-        if (is_playing) {
-          if (!instance.m_audio_api_wrapper.device_initialized()) {
-            instance.initialize_device();
-          }
-          if (instance.m_audio_api_wrapper.device_initialized() &&
-              !instance.m_audio_api_wrapper.client_started()) {
-            instance.write_wave_data();  // Prevent glitches.
-            instance.start_client();
+        if (instance.m_is_playing) {
+          if (instance.prepare_device() && !instance.m_audio_api_wrapper.client_started()) {
+            instance.start_playback();
+          } else if (instance.m_audio_api_wrapper.client_started() && !instance.m_is_exiting) {
+            // Cancel the stop in progress, or the silence before a scheduled start.
+            instance.m_is_stopping = false;
+            instance.m_is_draining = false;
+            CancelWaitableTimer(instance.m_drain_timer);
           }
         } else {
           // To prevent glitches, do not stop the playback immediately.
@@ -612,38 +807,176 @@ DWORD ToneGenerator::render_thread(LPVOID lpParam) {
         // data. This event is set by the audio client.
         if (instance.m_audio_api_wrapper.device_initialized() &&
             instance.m_audio_api_wrapper.client_started()) {
-          instance.write_wave_data();
-
-          if ((instance.m_is_exiting || instance.m_is_stopping) &&
-              instance.m_tone_data_generator.is_silent) {
-            Sleep(instance.m_latency + 100);  // Wait for written data to be played.
-            instance.stop_client();
-            if (instance.m_is_exiting) {
-              break;
-            } else {
-              instance.m_is_stopping = false;
+          if (instance.m_render_ahead != 0) {
+            if (!instance.copy_wave_data()) {
+              lock.lock();
+              instance.abandon_device();
+            }
+          } else {
+            instance.write_wave_data();
+          }
+          if (instance.m_audio_api_wrapper.device_initialized() && instance.update_latency()) {
+            // The clients are changed while the producer thread does not render.
+            if (!lock.owns_lock()) {
+              lock.lock();
             }
+            instance.apply_latency();
+          }
+
+          // With the render-ahead ring, the client stops after the ring has been played.
+          if (instance.m_render_ahead != 0 && instance.m_render_ahead_ring.size() == 0 &&
+              !lock.owns_lock()) {
+            lock.lock();
+          }
+          const bool ring_played =
+              instance.m_render_ahead == 0 || instance.m_render_ahead_ring.size() == 0;
+          if (lock.owns_lock() && ring_played && !instance.m_is_draining &&
+              instance.playback_finished()) {
+            // Stop the client when the data written has been played. The other events are
+            // handled meanwhile.
+            instance.m_is_draining = true;
+            set_timer(instance.m_drain_timer, instance.m_latency + DRAIN_MARGIN_TIME);
+          }
+        }
+      } else if (result == WAIT_OBJECT_0 + 6) {  // command_queued_event
+        // The command queued event is set when commands have been scheduled by the user of this
+        // class. While the client is started, they are received when the buffer is written.
+        if (!instance.m_audio_api_wrapper.client_started()) {
+          instance.receive_commands(0);
+          if (instance.has_pending_start() && !instance.m_is_exiting && instance.prepare_device()) {
+            // Write silence until the start.
+            instance.m_is_stopping = true;
+            instance.start_playback();
+          }
+        }
+      } else if (result == WAIT_OBJECT_0 + 7) {  // device_settle_timer
+        // The device settle timer is signaled when the notifications of the device have settled.
+        instance.on_device_settled();
+      } else if (result == WAIT_OBJECT_0 + 8) {  // drain_timer
+        // The drain timer is signaled when the data written before the end of the playback has
+        // been played.
+        instance.m_is_draining = false;
+        if (instance.m_audio_api_wrapper.client_started() && instance.playback_finished()) {
+          instance.stop_client();
+          if (!instance.m_is_exiting) {
+            instance.m_is_stopping = false;
           }
         }
+        // The client may also have been stopped by a notification of the device meanwhile.
+        if (instance.m_is_exiting && !instance.m_audio_api_wrapper.client_started()) {
+          break;
+        }
       } else if (result == WAIT_FAILED) {
         ss << "WaitForMultipleObjects failed. GetLastError: " << GetLastError();
         throw std::runtime_error(ss.str());
       }
+
+      if (instance.m_render_ahead != 0) {
+        // Let the producer thread refill the ring, or apply what has changed.
+        if (lock.owns_lock()) {
+          lock.unlock();
+        }
+        set_event(instance.m_produce_event);
+      }
     }
   } catch (const std::runtime_error &e) {  // Exit the event loop when a fatal error occurs.
     instance.report_error(e.what());
+    std::lock_guard<std::mutex> lock(instance.m_render_mutex);
     instance.cleanup_device();
     instance.m_audio_api_wrapper.cleanup();
     return 1;
   }
 
+  std::lock_guard<std::mutex> lock(instance.m_render_mutex);
   instance.cleanup_device();
   instance.m_audio_api_wrapper.cleanup();
 
   return 0;
 }
 
+DWORD ToneGenerator::producer_thread(LPVOID lpParam) {
+  ToneGenerator &instance = *static_cast<ToneGenerator *>(lpParam);
+  const RealtimeScope realtime(instance.m_realtime_options);
+
+  HANDLE events[] = {instance.m_producer_exit_event, instance.m_produce_event};
+  while (true) {
+    DWORD result =
+        WaitForMultipleObjects(sizeof(events) / sizeof(HANDLE), events, FALSE, INFINITE);
+    if (result == WAIT_OBJECT_0) {  // producer_exit_event
+      break;
+    } else if (result == WAIT_OBJECT_0 + 1) {  // produce_event
+      // The lock is released between the blocks, so that the render thread can handle the
+      // events, and a change of the parameters is applied from the next block.
+      while (true) {
+        std::lock_guard<std::mutex> lock(instance.m_render_mutex);
+        if (!instance.m_audio_api_wrapper.client_started() || !instance.render_ahead_block()) {
+          break;
+        }
+      }
+    } else if (result == WAIT_FAILED) {
+      std::stringstream ss;
+      ss << "WaitForMultipleObjects failed. GetLastError: " << GetLastError();
+      instance.report_error(ss.str());
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+void ToneGenerator::on_device_notification(bool stream_switch) {
+  // Release the current audio device.
+  if (m_audio_api_wrapper.device_initialized()) {
+    if (m_audio_api_wrapper.client_started()) {
+      stop_client();
+    }
+    cleanup_device();
+  }
+  // A stop in progress is finished with the device.
+  if (!m_is_exiting) {
+    m_is_stopping = false;
+  }
+
+  // The notifications may come several times in a short period, so the device is initialized
+  // again when they settle. The other events are handled meanwhile.
+  const ULONGLONG now = GetTickCount64();
+  if (m_device_state != DeviceState::settling) {
+    m_device_state = DeviceState::settling;
+    m_settle_deadline = now + DEVICE_SETTLE_MAX_TIME;
+    m_reinitialization_required = false;
+  }
+  m_reinitialization_required = m_reinitialization_required || stream_switch;
+  set_timer(m_device_settle_timer,
+            m_settle_deadline > now ? std::min(DEVICE_SETTLE_TIME, m_settle_deadline - now) : 0);
+}
+
+void ToneGenerator::on_device_settled() {
+  if (m_device_state != DeviceState::settling) {
+    return;
+  }
+  m_device_state = DeviceState::active;
+  if (!m_reinitialization_required || m_is_exiting) {
+    return;
+  }
+
+  initialize_device();
+  if (m_audio_api_wrapper.device_initialized() && (m_is_playing || has_pending_start())) {
+    // If the audio was playing before the stream switch event, start playing the audio again.
+    // If a start is scheduled, write silence until then.
+    m_is_stopping = !m_is_playing;
+    start_playback();
+  }
+}
+
+bool ToneGenerator::prepare_device() {
+  if (!m_audio_api_wrapper.device_initialized() && m_device_state == DeviceState::active) {
+    initialize_device();
+  }
+  return m_audio_api_wrapper.device_initialized();
+}
+
 void ToneGenerator::initialize_device() {
+  m_handover_silence = 0;
   try {
     m_audio_api_wrapper.initialize_device(m_latency, m_buffer_ready_event, m_tone_data_generator);
   } catch (const std::runtime_error &e) {
@@ -661,19 +994,111 @@ void ToneGenerator::initialize_device() {
     } catch (std::runtime_error &) {
       device_info = "";
     }
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> lock(m_device_info_mutex);
     m_device_info = std::move(device_info);
   }
 
+  if (m_render_ahead != 0) {
+    // The frames rendered for the previous device are discarded.
+    const double samples_per_second = m_tone_data_generator.samples_per_second;
+    const auto depth = static_cast<std::uint32_t>(
+        std::max(std::ceil(samples_per_second * m_render_ahead / 1000), 1.0));
+    m_render_ahead_block = std::min(
+        static_cast<std::uint32_t>(
+            std::max(std::ceil(samples_per_second * RENDER_AHEAD_BLOCK_TIME / 1000), 1.0)),
+        depth);
+    m_render_ahead_ring.reset(static_cast<std::size_t>(depth) *
+                              m_tone_data_generator.channels_count *
+                              m_tone_data_generator.bits_per_sample / 8);
+    m_render_ahead_depth = depth;
+    m_render_ahead_fill = 0;
+    m_device_padding = 0;
+  }
+
   update_wave_parameters();
 }
 
+void ToneGenerator::publish_parameters() {
+  m_parameter_buffer.back() = m_parameters;
+  m_parameter_buffer.publish();
+  set_event(m_parameter_changed_event);
+}
+
 void ToneGenerator::update_wave_parameters() {
-  std::lock_guard<std::mutex> lock(m_mutex);
-  m_tone_data_generator.left_amplitude = m_left_amplitude;
-  m_tone_data_generator.right_amplitude = m_right_amplitude;
-  m_tone_data_generator.left_frequency = m_left_frequency;
-  m_tone_data_generator.right_frequency = m_right_frequency;
+  m_parameter_buffer.update();
+  const WaveParameters &parameters = m_parameter_buffer.front();
+  if (parameters.wave_generation != m_applied_wave_generation) {
+    m_tone_data_generator.left_amplitude = parameters.left_amplitude;
+    m_tone_data_generator.right_amplitude = parameters.right_amplitude;
+    m_tone_data_generator.left_frequency = parameters.left_frequency;
+    m_tone_data_generator.right_frequency = parameters.right_frequency;
+    m_tone_data_generator.left_waveform = parameters.left_waveform;
+    m_tone_data_generator.right_waveform = parameters.right_waveform;
+    m_applied_wave_generation = parameters.wave_generation;
+  }
+  if (parameters.noise_generation != m_applied_noise_generation) {
+    m_tone_data_generator.white_noise_gain = parameters.white_noise_gain;
+    m_tone_data_generator.pink_noise_gain = parameters.pink_noise_gain;
+    m_tone_data_generator.brown_noise_gain = parameters.brown_noise_gain;
+    m_applied_noise_generation = parameters.noise_generation;
+  }
+  if (parameters.tone_pairs_generation != m_applied_tone_pairs_generation) {
+    for (unsigned int i = 0; i < MAX_TONE_PAIRS; ++i) {
+      TonePair &pair = m_tone_data_generator.pairs[i];
+      pair.amplitude = parameters.tone_pairs[i].amplitude;
+      pair.left_frequency = parameters.tone_pairs[i].left_frequency;
+      pair.right_frequency = parameters.tone_pairs[i].right_frequency;
+    }
+    m_applied_tone_pairs_generation = parameters.tone_pairs_generation;
+  }
+  if (parameters.timeline_generation != m_applied_timeline_generation) {
+    if (parameters.has_timeline) {
+      m_tone_data_generator.start_timeline(parameters.timeline);
+      m_next_progress_position = 0;
+    } else {
+      m_tone_data_generator.stop_timeline();
+    }
+    m_applied_timeline_generation = parameters.timeline_generation;
+  }
+  if (parameters.latency_generation != m_applied_latency_generation) {
+    if (parameters.adaptive_latency) {
+      // The automatic latency starts from the minimum.
+      m_latency_controller.configure(parameters.min_latency, parameters.max_latency,
+                                     parameters.min_latency);
+    } else {
+      m_latency_controller.configure(parameters.latency, parameters.latency, parameters.latency);
+    }
+    m_adaptive_latency = parameters.adaptive_latency;
+    m_applied_latency_generation = parameters.latency_generation;
+    change_latency(m_latency_controller.latency());
+  }
+  apply_channel_routing(parameters, m_audio_api_wrapper.channel_mask(), m_tone_data_generator);
+  publish_live_parameters();
+}
+
+void ToneGenerator::publish_live_parameters() {
+  const ToneDataGenerator &generator = m_tone_data_generator;
+  LiveParameters &live = m_live_parameters.back();
+  live.left_amplitude = generator.current_left_amplitude();
+  live.right_amplitude = generator.current_right_amplitude();
+  live.left_frequency = generator.current_left_frequency();
+  live.right_frequency = generator.current_right_frequency();
+  live.left_waveform = generator.left_waveform;
+  live.right_waveform = generator.right_waveform;
+  live.white_noise_gain = generator.white_noise_gain;
+  live.pink_noise_gain = generator.pink_noise_gain;
+  live.brown_noise_gain = generator.brown_noise_gain;
+  live.is_playing = m_audio_api_wrapper.client_started();
+  live.stream_position = m_stream_position;
+  live.samples_per_second = generator.samples_per_second;
+  live.timeline_running = generator.timeline_running();
+  live.timeline_position = generator.timeline_position();
+  live.timeline_duration = generator.timeline_duration();
+  live.timeline_reports = m_timeline_reports;
+  live.reported_timeline_position = m_reported_timeline_position;
+  live.reported_timeline_duration = m_reported_timeline_duration;
+  live.scheduling = m_realtime_status;
+  m_live_parameters.publish();
 }
 
 void ToneGenerator::write_wave_data() {
@@ -690,6 +1115,11 @@ void ToneGenerator::write_wave_data() {
     }
 
     UINT32 frames_to_write = m_audio_api_wrapper.buffer_size() - padding;
+    m_last_padding = padding;
+    m_last_frames = frames_to_write;
+    const UINT32 silence = write_handover_silence(frames_to_write);
+    padding += silence;
+    frames_to_write -= silence;
     if (frames_to_write == 0) {
       return;
     }
@@ -701,7 +1131,7 @@ void ToneGenerator::write_wave_data() {
       throw std::runtime_error(ss.str());
     }
 
-    m_tone_data_generator.write_tone_data(buffer, frames_to_write, m_is_stopping);
+    render_wave_data(buffer, frames_to_write, padding);
 
     hr = m_audio_api_wrapper.render_client()->ReleaseBuffer(frames_to_write, 0);
     if (FAILED(hr)) {
@@ -712,30 +1142,277 @@ void ToneGenerator::write_wave_data() {
     // Record the error message and continue, as the failure of
     // writing can be caused by the audio device lost.
     report_error(e.what());
-    cleanup_device();
-    m_tone_data_generator.is_silent = true;  // Prevent the thread from being blocked from exiting.
+    abandon_device();
+  }
+}
+
+void ToneGenerator::render_wave_data(BYTE *buffer, UINT32 frames_to_write, UINT32 padding) {
+  // The buffer is split at the stream positions of the commands.
+  receive_commands(padding);
+  const unsigned int bytes_per_frame =
+      m_tone_data_generator.channels_count * m_tone_data_generator.bits_per_sample / 8;
+  for (UINT32 written = 0; written < frames_to_write;) {
+    while (!m_pending_commands.empty() &&
+           m_pending_commands.front().stream_position <= m_stream_position) {
+      apply_command(m_pending_commands.front().command);
+      m_pending_commands.erase(m_pending_commands.begin());
+      --m_scheduled_count;
+    }
+    UINT32 frames = frames_to_write - written;
+    if (!m_pending_commands.empty()) {
+      frames = static_cast<UINT32>(std::min<std::uint64_t>(
+          frames, m_pending_commands.front().stream_position - m_stream_position));
+    }
+    m_tone_data_generator.write_tone_data(buffer + written * bytes_per_frame, frames,
+                                          m_is_stopping);
+    written += frames;
+    m_stream_position += frames;
+  }
+  report_timeline_progress();
+  publish_live_parameters();
+}
+
+bool ToneGenerator::render_ahead_block() {
+  m_render_ahead_finished = playback_finished();
+  if (!m_audio_api_wrapper.device_initialized() || m_render_ahead_finished) {
+    return false;
+  }
+
+  const unsigned int bytes_per_frame =
+      m_tone_data_generator.channels_count * m_tone_data_generator.bits_per_sample / 8;
+  std::uint8_t *region;
+  const std::size_t bytes = m_render_ahead_ring.write_region(region);
+  const auto frames = static_cast<UINT32>(
+      std::min<std::size_t>(bytes / bytes_per_frame, m_render_ahead_block));
+  if (frames == 0) {
+    return false;
+  }
+
+  // The next frame rendered is played after the frames in the ring and in the audio buffer.
+  const auto queued = static_cast<UINT32>(m_render_ahead_ring.size() / bytes_per_frame);
+  render_wave_data(region, frames, m_device_padding + queued);
+  m_render_ahead_ring.commit(static_cast<std::size_t>(frames) * bytes_per_frame);
+  return true;
+}
+
+bool ToneGenerator::copy_wave_data() {
+  try {
+    HRESULT hr;
+    std::stringstream ss;
+
+    UINT32 padding;
+    hr = m_audio_api_wrapper.client()->GetCurrentPadding(&padding);
+    if (FAILED(hr)) {
+      ss << "IAudioClient::GetCurrentPadding failed. HRESULT: " << std::hex << hr;
+      throw std::runtime_error(ss.str());
+    }
+
+    // The format is changed only by this thread, so it can be read without `m_render_mutex`.
+    const unsigned int bytes_per_frame =
+        m_tone_data_generator.channels_count * m_tone_data_generator.bits_per_sample / 8;
+    m_last_padding = padding;
+    const UINT32 silence = write_handover_silence(m_audio_api_wrapper.buffer_size() - padding);
+    padding += silence;
+    const UINT32 space = m_audio_api_wrapper.buffer_size() - padding;
+    const auto available = static_cast<UINT32>(m_render_ahead_ring.size() / bytes_per_frame);
+    const UINT32 frames_to_write = std::min(space, available);
+    // The ring runs short only at the end of the playback unless the producer thread is late.
+    if (available < space && !m_render_ahead_finished) {
+      m_producer_late_frames += space - available;
+    }
+
+    if (frames_to_write != 0) {
+      BYTE *buffer;
+      hr = m_audio_api_wrapper.render_client()->GetBuffer(frames_to_write, &buffer);
+      if (FAILED(hr)) {
+        ss << "IAudioRenderClient::GetBuffer failed. HRESULT: " << std::hex << hr;
+        throw std::runtime_error(ss.str());
+      }
+      m_render_ahead_ring.read(buffer, static_cast<std::size_t>(frames_to_write) * bytes_per_frame);
+      hr = m_audio_api_wrapper.render_client()->ReleaseBuffer(frames_to_write, 0);
+      if (FAILED(hr)) {
+        ss << "IAudioRenderClient::ReleaseBuffer failed. HRESULT: " << std::hex << hr;
+        throw std::runtime_error(ss.str());
+      }
+    }
+    m_last_frames = silence + frames_to_write;
+    m_device_padding = padding + frames_to_write;
+    m_render_ahead_fill = static_cast<std::uint32_t>(m_render_ahead_ring.size() / bytes_per_frame);
+  } catch (const std::runtime_error &e) {
+    // Record the error message. The caller releases the device with `m_render_mutex` locked.
+    report_error(e.what());
+    return false;
+  }
+  return true;
+}
+
+void ToneGenerator::abandon_device() {
+  cleanup_device();
+  m_tone_data_generator.is_silent = true;  // Prevent the thread from being blocked from exiting.
+}
+
+UINT32 ToneGenerator::write_handover_silence(UINT32 frames) {
+  const UINT32 silence = std::min(frames, m_handover_silence);
+  if (silence != 0) {
+    m_audio_api_wrapper.write_silence(silence);
+    m_handover_silence -= silence;
+  }
+  return silence;
+}
+
+bool ToneGenerator::update_latency() {
+  const unsigned int latency =
+      m_latency_controller.update(m_last_padding, m_audio_api_wrapper.buffer_size(),
+                                  m_last_frames, m_tone_data_generator.samples_per_second);
+  m_underruns = m_latency_controller.underruns();
+  return latency != m_latency || m_audio_api_wrapper.has_retired_client();
+}
+
+void ToneGenerator::apply_latency() {
+  m_audio_api_wrapper.release_retired_client(false);
+  change_latency(m_latency_controller.latency());
+}
+
+void ToneGenerator::change_latency(unsigned int latency) {
+  if (!m_audio_api_wrapper.device_initialized()) {
+    m_latency = latency;  // Applied when the device is initialized.
+    return;
+  }
+  if (latency == m_latency || m_audio_api_wrapper.has_retired_client()) {
+    return;
+  }
+  try {
+    // The silence not written yet for a previous resize still comes first.
+    m_handover_silence += m_audio_api_wrapper.resize_buffer(latency, m_buffer_ready_event);
+    m_latency = latency;
+  } catch (const std::runtime_error &e) {
+    // Keep the current client. The controller may try again later.
+    report_error(e.what());
+    m_latency_controller.set_latency(m_latency);
+  }
+}
+
+void ToneGenerator::start_playback() {
+  if (m_render_ahead != 0) {
+    // The producer thread does not render while the client is stopped.
+    while (render_ahead_block()) {
+    }
+    if (!copy_wave_data()) {
+      abandon_device();
+    }
+  } else {
+    write_wave_data();  // Prevent glitches.
   }
+  start_client();
+}
+
+bool ToneGenerator::playback_finished() const {
+  // The client keeps running while a scheduled start is waiting.
+  return m_tone_data_generator.is_silent &&
+         (m_is_exiting || (m_is_stopping && !has_pending_start()));
+}
+
+void ToneGenerator::receive_commands(UINT32 padding) {
+  const auto now = std::chrono::steady_clock::now();
+  const double samples_per_second = m_tone_data_generator.samples_per_second;
+  QueuedCommand queued;
+  while (m_command_queue.pop(queued)) {
+    std::uint64_t stream_position = queued.stream_position;
+    if (queued.at_time) {
+      // The next frame written is played after `padding` frames.
+      const double frames =
+          std::chrono::duration<double>(queued.time - now).count() * samples_per_second -
+          padding;
+      stream_position = m_stream_position + static_cast<std::uint64_t>(
+                                                std::max(std::llround(frames), 0LL));
+    }
+    // The commands at the same position stay in the order of the queue.
+    const auto it = std::upper_bound(
+        m_pending_commands.begin(), m_pending_commands.end(), stream_position,
+        [](std::uint64_t position, const PendingCommand &pending) {
+          return position < pending.stream_position;
+        });
+    m_pending_commands.insert(it, {stream_position, queued.command});
+  }
+}
+
+void ToneGenerator::apply_command(const ToneCommand &command) {
+  ToneDataGenerator &generator = m_tone_data_generator;
+  switch (command.type) {
+    case ToneCommand::Type::set_wave_parameters:
+      generator.left_amplitude = command.left_amplitude;
+      generator.right_amplitude = command.right_amplitude;
+      generator.left_frequency = command.left_frequency;
+      generator.right_frequency = command.right_frequency;
+      generator.left_waveform = command.left_waveform;
+      generator.right_waveform = command.right_waveform;
+      if (generator.timeline_running()) {
+        generator.stop_timeline();
+      }
+      break;
+    case ToneCommand::Type::set_noise_parameters:
+      generator.white_noise_gain = command.white_noise_gain;
+      generator.pink_noise_gain = command.pink_noise_gain;
+      generator.brown_noise_gain = command.brown_noise_gain;
+      break;
+    case ToneCommand::Type::start:
+      // The exit is not cancelled.
+      if (!m_is_exiting) {
+        m_is_stopping = false;
+        m_is_playing = true;
+      }
+      break;
+    case ToneCommand::Type::stop:
+      m_is_stopping = true;
+      m_is_playing = false;
+      break;
+  }
+}
+
+bool ToneGenerator::has_pending_start() const {
+  return std::any_of(m_pending_commands.begin(), m_pending_commands.end(),
+                     [](const PendingCommand &pending) {
+                       return pending.command.type == ToneCommand::Type::start;
+                     });
+}
+
+void ToneGenerator::report_timeline_progress() {
+  const bool running = m_tone_data_generator.timeline_running();
+  const double position = m_tone_data_generator.timeline_position();
+  if (running ? position < m_next_progress_position : !m_timeline_reported) {
+    return;
+  }
+
+  m_timeline_reported = running;
+  m_next_progress_position = std::floor(position / PROGRESS_INTERVAL + 1) * PROGRESS_INTERVAL;
+  m_reported_timeline_position = position;
+  m_reported_timeline_duration = m_tone_data_generator.timeline_duration();
+  ++m_timeline_reports;
 }
 
 void ToneGenerator::start_client() {
+  m_latency_controller.restart();
   try {
     m_audio_api_wrapper.start_client();
   } catch (const std::runtime_error &e) {
     report_error(e.what());
   }
+  publish_live_parameters();
 }
 
 void ToneGenerator::stop_client() {
+  m_handover_silence = 0;  // The buffer is reset, so the frames to follow are gone.
   try {
     m_audio_api_wrapper.stop_client();
   } catch (const std::runtime_error &e) {
     report_error(e.what());
   }
+  publish_live_parameters();
 }
 
 void ToneGenerator::cleanup_device() {
   m_audio_api_wrapper.cleanup_device();
-  std::lock_guard<std::mutex> lock(m_mutex);
+  std::lock_guard<std::mutex> lock(m_device_info_mutex);
   m_device_info = "";
 }
 
@@ -746,12 +1423,26 @@ void ToneGenerator::close_handles() {
   safe_close(&m_parameter_changed_event);
   safe_close(&m_play_state_changed_event);
   safe_close(&m_buffer_ready_event);
+  safe_close(&m_command_queued_event);
+  safe_close(&m_device_settle_timer);
+  safe_close(&m_drain_timer);
+  safe_close(&m_producer_exit_event);
+  safe_close(&m_produce_event);
+  safe_close(&m_producer_thread);
   safe_close(&m_render_thread);
 }
 
 ToneGenerator::ToneGenerator(unsigned int latency,
-                             std::function<void(const std::string &)> error_callback)
-    : m_latency(latency), m_error_callback(error_callback) {
+                             std::function<void(const std::string &)> error_callback,
+                             const RealtimeOptions &realtime_options,
+                             unsigned int render_ahead)
+    : m_latency(latency),
+      m_realtime_options(realtime_options),
+      m_render_ahead(render_ahead),
+      m_error_callback(error_callback) {
+  m_pending_commands.reserve(MAX_SCHEDULED_COMMANDS);
+  m_tone_data_generator.reserve_timeline(MAX_TIMELINE_SEGMENTS);
+  m_latency_controller.configure(latency, latency, latency);
   try {
     m_exit_event = create_event();
     m_stream_switch_event = create_event();
@@ -759,15 +1450,33 @@ ToneGenerator::ToneGenerator(unsigned int latency,
     m_parameter_changed_event = create_event();
     m_play_state_changed_event = create_event();
     m_buffer_ready_event = create_event();
+    m_command_queued_event = create_event();
+    m_device_settle_timer = create_timer();
+    m_drain_timer = create_timer();
+    m_producer_exit_event = create_event();
+    m_produce_event = create_event();
   } catch (const std::runtime_error &e) {
     close_handles();
     throw e;
   }
 
+  if (m_render_ahead != 0) {
+    m_producer_thread = CreateThread(NULL, 0, producer_thread, this, 0, NULL);
+    if (m_producer_thread == NULL) {
+      std::stringstream ss;
+      ss << "CreateThread failed. GetLastError: " << GetLastError();
+      close_handles();
+      throw std::runtime_error(ss.str());
+    }
+  }
+
   m_render_thread = CreateThread(NULL, 0, render_thread, this, 0, NULL);
   if (m_render_thread == NULL) {
+    std::stringstream ss;
+    ss << "CreateThread failed. GetLastError: " << GetLastError();
+    stop_producer_thread();
     close_handles();
-    throw std::runtime_error("CreateThread failed. GetLastError: " + GetLastError());
+    throw std::runtime_error(ss.str());
   }
 }
 
@@ -791,42 +1500,219 @@ ToneGenerator::~ToneGenerator() {
     }
   }
 
+  stop_producer_thread();
   close_handles();
 }
 
+void ToneGenerator::stop_producer_thread() {
+  if (m_producer_thread) {
+    SetEvent(m_producer_exit_event);
+    // The producer thread renders a block at most before it checks the event.
+    const DWORD result = WaitForSingleObject(m_producer_thread, 1000);
+    if (result == WAIT_TIMEOUT || result == WAIT_FAILED) {
+      TerminateThread(m_producer_thread, 1);
+    }
+  }
+}
+
 void ToneGenerator::set_wave_parameters(double left_amplitude, double right_amplitude,
-                                        double left_frequency, double right_frequency) {
+                                        double left_frequency, double right_frequency,
+                                        Waveform left_waveform, Waveform right_waveform) {
   std::lock_guard<std::mutex> lock(m_mutex);
 
-  if (left_amplitude < 0 || left_amplitude > 1 || right_amplitude < 0 || right_amplitude > 1) {
-    throw std::invalid_argument("Amplitude must be in the range [0, 1].");
+  validate_wave_parameters(left_amplitude, right_amplitude, left_frequency, right_frequency);
+
+  m_parameters.left_amplitude = left_amplitude;
+  m_parameters.right_amplitude = right_amplitude;
+  m_parameters.left_frequency = left_frequency;
+  m_parameters.right_frequency = right_frequency;
+  m_parameters.left_waveform = left_waveform;
+  m_parameters.right_waveform = right_waveform;
+  ++m_parameters.wave_generation;
+  if (m_parameters.has_timeline) {
+    m_parameters.has_timeline = false;
+    ++m_parameters.timeline_generation;
   }
-  if (left_frequency <= 0 || right_frequency <= 0) {
-    throw std::invalid_argument("Frequencies must be greater than 0.");
+
+  publish_parameters();
+}
+
+void ToneGenerator::set_noise_parameters(double white_gain, double pink_gain,
+                                         double brown_gain) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  validate_noise_parameters(white_gain, pink_gain, brown_gain);
+
+  m_parameters.white_noise_gain = white_gain;
+  m_parameters.pink_noise_gain = pink_gain;
+  m_parameters.brown_noise_gain = brown_gain;
+  ++m_parameters.noise_generation;
+
+  publish_parameters();
+}
+
+void ToneGenerator::set_channel_routing(const std::vector<double> &left_gains,
+                                        const std::vector<double> &right_gains) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  validate_speaker_gains(left_gains, right_gains);
+
+  m_parameters.channel_routing = !left_gains.empty();
+  m_parameters.left_speaker_gains.fill(0.0);
+  m_parameters.right_speaker_gains.fill(0.0);
+  std::copy(left_gains.begin(), left_gains.end(), m_parameters.left_speaker_gains.begin());
+  std::copy(right_gains.begin(), right_gains.end(), m_parameters.right_speaker_gains.begin());
+
+  publish_parameters();
+}
+
+void ToneGenerator::set_tone_pair(unsigned int index, double amplitude, double left_frequency,
+                                  double right_frequency, const std::vector<double> &left_gains,
+                                  const std::vector<double> &right_gains) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (index >= MAX_TONE_PAIRS) {
+    throw std::invalid_argument("Tone pair index must be less than 8.");
   }
+  validate_wave_parameters(amplitude, amplitude, left_frequency, right_frequency);
+  validate_speaker_gains(left_gains, right_gains);
+
+  TonePairParameters &pair = m_parameters.tone_pairs[index];
+  pair.amplitude = amplitude;
+  pair.left_frequency = left_frequency;
+  pair.right_frequency = right_frequency;
+  pair.channel_routing = !left_gains.empty();
+  pair.left_speaker_gains.fill(0.0);
+  pair.right_speaker_gains.fill(0.0);
+  std::copy(left_gains.begin(), left_gains.end(), pair.left_speaker_gains.begin());
+  std::copy(right_gains.begin(), right_gains.end(), pair.right_speaker_gains.begin());
+  ++m_parameters.tone_pairs_generation;
+
+  publish_parameters();
+}
 
-  m_left_amplitude = left_amplitude;
-  m_right_amplitude = right_amplitude;
-  m_left_frequency = left_frequency;
-  m_right_frequency = right_frequency;
+void ToneGenerator::set_latency(unsigned int latency) {
+  std::lock_guard<std::mutex> lock(m_mutex);
 
-  set_event(m_parameter_changed_event);
+  validate_latency(latency);
+
+  m_parameters.latency = latency;
+  m_parameters.adaptive_latency = false;
+  ++m_parameters.latency_generation;
+
+  publish_parameters();
 }
 
-void ToneGenerator::start() {
+void ToneGenerator::set_adaptive_latency(unsigned int min_latency, unsigned int max_latency) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  validate_latency(min_latency);
+  validate_latency(max_latency);
+  if (min_latency > max_latency) {
+    throw std::invalid_argument("The minimum latency must not exceed the maximum latency.");
+  }
+
+  m_parameters.adaptive_latency = true;
+  m_parameters.min_latency = min_latency;
+  m_parameters.max_latency = max_latency;
+  ++m_parameters.latency_generation;
+
+  publish_parameters();
+}
+
+void ToneGenerator::set_timeline(const Timeline &timeline) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  validate_track(timeline.left_amplitude, 0, 1);
+  validate_track(timeline.right_amplitude, 0, 1);
+  validate_track(timeline.left_frequency, MIN_FREQUENCY, MAX_FREQUENCY);
+  validate_track(timeline.right_frequency, MIN_FREQUENCY, MAX_FREQUENCY);
+
+  m_parameters.timeline = timeline;
+  m_parameters.has_timeline = true;
+  ++m_parameters.timeline_generation;
+
+  publish_parameters();
+}
+
+void ToneGenerator::stop_timeline() {
   std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_parameters.has_timeline) {
+    m_parameters.has_timeline = false;
+    ++m_parameters.timeline_generation;
+    publish_parameters();
+  }
+}
+
+void ToneGenerator::start() {
   m_is_playing = true;
   set_event(m_play_state_changed_event);
 }
 
 void ToneGenerator::stop() {
-  std::lock_guard<std::mutex> lock(m_mutex);
   m_is_playing = false;
   set_event(m_play_state_changed_event);
 }
 
-std::string ToneGenerator::get_device_info() {
+void ToneGenerator::queue_commands(const std::vector<ToneCommand> &commands,
+                                   const QueuedCommand &timing) {
+  for (const ToneCommand &command : commands) {
+    if (command.type == ToneCommand::Type::set_wave_parameters) {
+      validate_wave_parameters(command.left_amplitude, command.right_amplitude,
+                               command.left_frequency, command.right_frequency);
+    } else if (command.type == ToneCommand::Type::set_noise_parameters) {
+      validate_noise_parameters(command.white_noise_gain, command.pink_noise_gain,
+                                command.brown_noise_gain);
+    }
+  }
+
+  std::vector<QueuedCommand> batch(commands.size(), timing);
+  for (std::size_t i = 0; i < commands.size(); ++i) {
+    batch[i].command = commands[i];
+  }
+
   std::lock_guard<std::mutex> lock(m_mutex);
+  // Only the render thread decreases the count, so the queue has enough space after the check.
+  if (m_scheduled_count + commands.size() > MAX_SCHEDULED_COMMANDS) {
+    throw std::runtime_error("Too many commands are scheduled.");
+  }
+  m_scheduled_count += static_cast<unsigned int>(commands.size());
+  m_command_queue.push(batch.begin(), batch.end());
+  set_event(m_command_queued_event);
+}
+
+void ToneGenerator::schedule_commands(std::uint64_t stream_position,
+                                      const std::vector<ToneCommand> &commands) {
+  QueuedCommand timing;
+  timing.stream_position = stream_position;
+  queue_commands(commands, timing);
+}
+
+void ToneGenerator::schedule_commands(std::chrono::steady_clock::time_point time,
+                                      const std::vector<ToneCommand> &commands) {
+  QueuedCommand timing;
+  timing.at_time = true;
+  timing.time = time;
+  queue_commands(commands, timing);
+}
+
+LiveParameters ToneGenerator::get_live_parameters() {
+  std::lock_guard<std::mutex> lock(m_live_mutex);
+  m_live_parameters.update();
+  LiveParameters live = m_live_parameters.front();
+  if (m_render_ahead != 0) {
+    live.render_ahead_depth = m_render_ahead_depth;
+    live.render_ahead_fill = m_render_ahead_fill;
+    live.producer_late_frames = m_producer_late_frames;
+  }
+  live.latency = m_latency;
+  live.adaptive_latency = m_adaptive_latency;
+  live.underruns = m_underruns;
+  return live;
+}
+
+std::string ToneGenerator::get_device_info() {
+  std::lock_guard<std::mutex> lock(m_device_info_mutex);
   if (m_device_info.empty()) {
     throw std::runtime_error("Audio device information is not available.");
   } else {
@@ -10,8 +10,80 @@
 #include <mmdeviceapi.h>
 #include <windows.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <mutex>
+#include <vector>
+
+#include "latency_controller.h"
+#include "realtime_thread.h"
+#include "ring_buffer.h"
+#include "spsc_queue.h"
+#include "tone_data_generator.h"
+#include "triple_buffer.h"
+#include "wave_parameters.h"
+
+// Constants.
+constexpr unsigned int MAX_SCHEDULED_COMMANDS = 256;  // Commands that can be scheduled at once.
+
+/**
+ * @brief A change of the audio rendering scheduled by `ToneGenerator::schedule_commands`.
+ * @details Only the members of the type of the command are used.
+ */
+struct ToneCommand {
+  enum class Type {
+    set_wave_parameters,   // Sets the amplitudes, the frequencies, and the waveforms.
+    set_noise_parameters,  // Sets the gains of the noise.
+    start,                 // Starts to play the audio.
+    stop,                  // Starts to stop the audio at the next zero crossings.
+  };
+
+  Type type = Type::start;
+  double left_amplitude = 1.0;   // Amplitude of the left channel (0.0-1.0).
+  double right_amplitude = 1.0;  // Amplitude of the right channel (0.0-1.0).
+  double left_frequency = 440;   // Frequency of the left channel in Hz.
+  double right_frequency = 440;  // Frequency of the right channel in Hz.
+  Waveform left_waveform = Waveform::sine;   // Waveform of the left channel.
+  Waveform right_waveform = Waveform::sine;  // Waveform of the right channel.
+  double white_noise_gain = 0.0;  // Gain of the white noise (0.0-1.0).
+  double pink_noise_gain = 0.0;   // Gain of the pink noise (0.0-1.0).
+  double brown_noise_gain = 0.0;  // Gain of the brown noise (0.0-1.0).
+};
+
+/**
+ * @brief The state of the audio rendering actually in use, read by `get_live_parameters`.
+ */
+struct LiveParameters {
+  double left_amplitude = 0.0;   // Amplitude of the left channel (0.0-1.0).
+  double right_amplitude = 0.0;  // Amplitude of the right channel (0.0-1.0).
+  double left_frequency = 0.0;   // Frequency of the left channel in Hz.
+  double right_frequency = 0.0;  // Frequency of the right channel in Hz.
+  Waveform left_waveform = Waveform::sine;   // Waveform of the left channel.
+  Waveform right_waveform = Waveform::sine;  // Waveform of the right channel.
+  double white_noise_gain = 0.0;    // Gain of the white noise (0.0-1.0).
+  double pink_noise_gain = 0.0;     // Gain of the pink noise (0.0-1.0).
+  double brown_noise_gain = 0.0;    // Gain of the brown noise (0.0-1.0).
+  bool is_playing = false;          // `true` while the audio client is started.
+  std::uint64_t stream_position = 0;  // Frames rendered for the audio devices so far.
+  double samples_per_second = 0.0;    // Sample rate of the current audio device in Hz.
+  bool timeline_running = false;    // `true` while a timeline is running.
+  double timeline_position = 0.0;   // Seconds of the timeline played.
+  double timeline_duration = 0.0;   // Length of the timeline in seconds.
+  // The last progress report of the timeline (see `ToneGenerator::set_timeline`).
+  std::uint64_t timeline_reports = 0;       // Progress reports of the timelines so far.
+  double reported_timeline_position = 0.0;  // Position of the last report in seconds.
+  double reported_timeline_duration = 0.0;  // Duration of the last report in seconds.
+  RealtimeStatus scheduling;        // Scheduling obtained by the render thread.
+  // The render-ahead ring (see `ToneGenerator::ToneGenerator`). All 0 if it is not used.
+  std::uint32_t render_ahead_depth = 0;  // Capacity of the ring in frames.
+  std::uint32_t render_ahead_fill = 0;   // Frames in the ring after the last device event.
+  std::uint64_t producer_late_frames = 0;  // Frames the device asked for but the ring lacked.
+  unsigned int latency = 0;         // Latency of the audio client in milliseconds.
+  bool adaptive_latency = false;    // `true` if the latency follows the load of the system.
+  std::uint64_t underruns = 0;      // Wakeups that found the audio buffer empty.
+};
 
 /**
  * @brief A class to play a sine wave tone using WASAPI.
@@ -21,46 +93,6 @@
  */
 class ToneGenerator {
  private:
-  /**
-   * @brief A class to generate wave data (sine wave).
-   * @details By setting the waveform data parameters in the public member variables and calling
-   * `write_tone_data`, the waveform data generated by the calculation is written to the buffer.
-   */
-  class ToneDataGenerator {
-   private:
-    double m_left_phase = 0.0;   // Phase of the next generated data (left).
-    double m_right_phase = 0.0;  // Phase of the next generated data (right).
-    int m_left_prev_sign = 0;    // The sign of the last generated data (left). 1, 0, or -1.
-    int m_right_prev_sign = 0;   // The sign of the last generated data (right). 1, 0, or -1.
-
-   public:
-    // Parameters used to generate waveform data.
-    double left_amplitude;         // Amplitude of the left channel (0.0-1.0).
-    double right_amplitude;        // Amplitude of the right channel (0.0-1.0).
-    double left_frequency;         // Frequency of the left channel in Hz.
-    double right_frequency;        // Frequency of the right channel in Hz.
-    unsigned int bits_per_sample;  // Bits per sample (8, 16, or 32).
-    double samples_per_second;     // Samples per second in Hz. Must be greater than the frequency.
-    unsigned int channels_count;   // Number of channels (2 or more).
-
-    /**
-     * If `stopping` is `true` in the call of `write_tone_data`, glitches can occur if
-     * playback is stopped immediately. To prevent this, playback continues until the waveform data
-     * value reaches 0, after which sequence of 0 is written to the buffer. This function is used
-     * to determine if the value has reached 0 for both the left and right channels.
-     */
-    bool is_silent = false;
-
-    /**
-     * @brief Function to write waveform data to the buffer.
-     * @param buffer A pointer to the buffer to write the waveform data.
-     * @param frames_count The number of frames to write.
-     * @param is_stopping If true, sine wave data is written to the point where the value reaches 0,
-     * then sequence of 0 is written after that.
-     */
-    void write_tone_data(BYTE *buffer, unsigned int frames_count, bool is_stopping);
-  };
-
   /**
    * @brief Audio event handler class.
    * @details This class is a COM object that implements the `IMMNotificationClient` and
@@ -119,6 +151,7 @@ class ToneGenerator {
     IAudioRenderClient *m_render_client = NULL;
     IAudioSessionControl *m_session_control = NULL;
     bool m_session_callback_registered = false;
+    IAudioClient *m_retired_client = NULL;  // Client replaced by `resize_buffer`, playing out.
 
     // State variables.
     bool m_is_initialized = false;
@@ -143,11 +176,26 @@ class ToneGenerator {
      */
     bool client_started() const { return m_client_started; }
 
+    /**
+     * @brief `true` while the client replaced by `resize_buffer` is playing out.
+     */
+    bool has_retired_client() const { return m_retired_client != NULL; }
+
     /**
      * @brief Buffer size of the audio client in frames.
      */
     UINT32 buffer_size() const { return m_buffer_size; }
 
+    /**
+     * @brief Channel mask of the format of the audio client (`SPEAKER_*` flags), or 0 if the
+     * format does not have one.
+     */
+    DWORD channel_mask() const {
+      return m_wave_format && m_wave_format->Format.wFormatTag == WAVE_FORMAT_EXTENSIBLE
+                 ? m_wave_format->dwChannelMask
+                 : 0;
+    }
+
     /**
      * @brief Returns the audio client.
      */
@@ -171,14 +219,42 @@ class ToneGenerator {
      * @param latency Latency in milliseconds.
      * @param buffer_ready_event The handle to the event object to signal when the buffer is ready.
      * @param tone_data_generator The reference to the `ToneDataGenerator` instance.
-     * `bits_per_sample`, `samples_per_second`, and `channels_count` are set to the values of the
-     * initialized audio client.
+     * `bits_per_sample`, `valid_bits_per_sample`, `is_float`, `samples_per_second`, and
+     * `channels_count` are set to the values of the initialized audio client.
      * @exception `std::runtime_error` is thrown if the initialization fails.
      * @details `device_initialized` returns `true` if the initialization is successful.
      */
     void initialize_device(unsigned int latency, HANDLE buffer_ready_event,
                            ToneDataGenerator &tone_data_generator);
 
+    /**
+     * @brief Re-creates the audio client with another latency, without a gap.
+     * @param latency Latency in milliseconds.
+     * @param buffer_ready_event The handle to the event object to signal when the buffer is ready.
+     * @return The frames of silence still to be written before the wave data.
+     * @exception `std::runtime_error` is thrown if the new client cannot be created. The current
+     * client is kept then.
+     * @details The new client has the same device and format. If the client is started, the new
+     * client is started at once with silence for the frames that the old client has not played
+     * yet, so that the wave data written next follows the last frame of the old client. The old
+     * client keeps playing until `release_retired_client` finds it drained. The client replaced
+     * by the previous call must have been released.
+     */
+    UINT32 resize_buffer(unsigned int latency, HANDLE buffer_ready_event);
+
+    /**
+     * @brief Releases the client replaced by `resize_buffer` once it has played its buffer.
+     * @param force `true` to release it even if it has not.
+     */
+    void release_retired_client(bool force);
+
+    /**
+     * @brief Writes silence to the audio buffer.
+     * @param frames The frames of silence. Must not exceed the unoccupied frames.
+     * @exception `std::runtime_error` is thrown if the buffer cannot be written.
+     */
+    void write_silence(UINT32 frames);
+
     /**
      * @brief Get the information of the current audio device.
      * @return A string containing the audio device information.
@@ -217,6 +293,24 @@ class ToneGenerator {
     void cleanup();
   };
 
+  /**
+   * @brief A command in the queue from `schedule_commands` to the render thread.
+   */
+  struct QueuedCommand {
+    ToneCommand command;
+    bool at_time = false;                          // `true` if scheduled at `time`.
+    std::uint64_t stream_position = 0;             // Stream position if `at_time` is `false`.
+    std::chrono::steady_clock::time_point time{};  // Time at which the frame is played.
+  };
+
+  /**
+   * @brief A command received by the render thread, waiting for its stream position.
+   */
+  struct PendingCommand {
+    std::uint64_t stream_position;
+    ToneCommand command;
+  };
+
   // Components for audio rendering.
   AudioApiWrapper m_audio_api_wrapper;
   ToneDataGenerator m_tone_data_generator;
@@ -229,25 +323,94 @@ class ToneGenerator {
   HANDLE m_parameter_changed_event = NULL;
   HANDLE m_play_state_changed_event = NULL;
   HANDLE m_buffer_ready_event = NULL;
-  std::mutex m_mutex;
+  HANDLE m_command_queued_event = NULL;
+  HANDLE m_device_settle_timer = NULL;
+  HANDLE m_drain_timer = NULL;
+  HANDLE m_producer_thread = NULL;
+  HANDLE m_producer_exit_event = NULL;
+  HANDLE m_produce_event = NULL;
+  // The render thread never locks `m_mutex` and `m_live_mutex`, so a slow user of this class
+  // does not block the audio rendering.
+  std::mutex m_mutex;              // Serializes the setters of the parameters.
+  std::mutex m_live_mutex;         // Serializes the readers of `m_live_parameters`.
+  std::mutex m_device_info_mutex;  // Guards `m_device_info`.
+  // Serializes the producer thread with the render thread, except for the copy from
+  // `m_render_ahead_ring` to the device, which does not lock it.
+  std::mutex m_render_mutex;
+
+  /**
+   * @brief States of the audio device in the render thread.
+   */
+  enum class DeviceState {
+    active,    // The device is initialized when it is needed.
+    settling,  // The device has been released on a notification, and the render thread waits for
+               // the notifications to settle before it initializes the device again.
+  };
 
   // State variables.
+  DeviceState m_device_state = DeviceState::active;
+  bool m_reinitialization_required = false;  // `true` if a stream switch has been notified.
+  ULONGLONG m_settle_deadline = 0;  // `GetTickCount64` at which the settling ends at the latest.
   bool m_is_stopping = false;  // `true` while the render client is stopping.
   bool m_is_exiting = false;   // `true` while the render thread is exiting.
+  bool m_is_draining = false;  // `true` while `m_drain_timer` waits for the data to be played.
 
   // Parameters for audio rendering.
-  unsigned int m_latency;  // Latency in milliseconds.
+  std::atomic<unsigned int> m_latency;  // Latency of the audio client in milliseconds.
+  std::atomic<bool> m_adaptive_latency = false;  // `true` if `m_latency_controller` adapts it.
+  std::atomic<std::uint64_t> m_underruns = 0;    // Copy of `m_latency_controller.underruns()`.
+  RealtimeOptions m_realtime_options;  // Scheduling requested for the render thread.
+  unsigned int m_render_ahead;  // Depth of the render-ahead ring in milliseconds, or 0.
 
   // These variables are used to control the audio rendering, and not
   // necessarily represent the actual state of the audio device.
-  // Exclusive access is required to modify or read these variables.
-  double m_left_amplitude = 1.0;   // Amplitude of the left channel (0.0-1.0).
-  double m_right_amplitude = 1.0;  // Amplitude of the right channel (0.0-1.0).
-  double m_left_frequency = 440;   // Frequency of the left channel in Hz.
-  double m_right_frequency = 440;  // Frequency of the right channel in Hz.
-  bool m_is_playing = false;       // Set `true` to play the sine wave, `false` to stop.
+  // `m_parameters` is modified only while `m_mutex` is locked, and then published to the
+  // render thread through `m_parameter_buffer`.
+  WaveParameters m_parameters;
+  TripleBuffer<WaveParameters> m_parameter_buffer;
+  std::atomic<bool> m_is_playing = false;  // Set `true` to play the sine wave, `false` to stop.
   std::string m_device_info = "";  // Information of the current audio device. "" if not available.
 
+  // The state published by the render thread for `get_live_parameters`.
+  TripleBuffer<LiveParameters> m_live_parameters;
+
+  // Commands from `schedule_commands`. `m_scheduled_count` counts the commands in the queue and
+  // in `m_pending_commands`, so that the latter never grows beyond `MAX_SCHEDULED_COMMANDS`.
+  SpscQueue<QueuedCommand, MAX_SCHEDULED_COMMANDS> m_command_queue;
+  std::atomic<unsigned int> m_scheduled_count = 0;
+
+  // Variables used only by the render thread.
+  std::uint64_t m_applied_wave_generation = 0;        // `wave_generation` applied last.
+  std::uint64_t m_applied_noise_generation = 0;       // `noise_generation` applied last.
+  std::uint64_t m_applied_tone_pairs_generation = 0;  // `tone_pairs_generation` applied last.
+  std::uint64_t m_applied_timeline_generation = 0;    // `timeline_generation` applied last.
+  bool m_timeline_reported = false;     // `true` if the last progress reported was running.
+  double m_next_progress_position = 0;  // Position of the timeline of the next progress report.
+  std::uint64_t m_timeline_reports = 0;     // Progress reports of the timelines so far.
+  double m_reported_timeline_position = 0;  // Position of the last progress report.
+  double m_reported_timeline_duration = 0;  // Duration of the last progress report.
+  std::uint64_t m_stream_position = 0;  // Frames written to the audio devices so far.
+  RealtimeStatus m_realtime_status;     // Scheduling obtained by the render thread.
+  std::uint64_t m_applied_latency_generation = 0;  // `latency_generation` applied last.
+  LatencyController m_latency_controller;
+  UINT32 m_handover_silence = 0;  // Silence to write before the wave data after a resize.
+  UINT32 m_last_padding = 0;      // Frames in the audio buffer at the last write, before it.
+  UINT32 m_last_frames = 0;       // Frames written at the last write.
+  // Commands received from `m_command_queue`, sorted by the stream position. The capacity is
+  // reserved, so that the render thread does not allocate memory.
+  std::vector<PendingCommand> m_pending_commands;
+
+  // The render-ahead ring, filled by the producer thread and copied to the device by the render
+  // thread. The ring is reset and the capacity is stored only by the render thread while
+  // `m_render_mutex` is locked.
+  RingBuffer m_render_ahead_ring;
+  unsigned int m_render_ahead_block = 0;  // Frames rendered at a time into the ring.
+  std::atomic<std::uint32_t> m_render_ahead_depth = 0;  // Capacity of the ring in frames.
+  std::atomic<std::uint32_t> m_render_ahead_fill = 0;   // Frames in the ring after the copy.
+  std::atomic<std::uint32_t> m_device_padding = 0;  // Frames in the device buffer after the copy.
+  std::atomic<std::uint64_t> m_producer_late_frames = 0;
+  std::atomic<bool> m_render_ahead_finished = false;  // `true` if the producer has faded out.
+
   std::function<void(const std::string &)> m_error_callback;
 
   /**
@@ -258,6 +421,77 @@ class ToneGenerator {
    */
   static DWORD WINAPI render_thread(LPVOID lpParam);
 
+  /**
+   * @brief Producer thread function.
+   * @param lpParam A pointer to the `ToneGenerator` instance.
+   * @details Used if the render-ahead ring is enabled. The thread fills the ring whenever the
+   * render thread signals `m_produce_event`.
+   */
+  static DWORD WINAPI producer_thread(LPVOID lpParam);
+
+  /**
+   * @brief Renders a block into the render-ahead ring. `m_render_mutex` must be locked.
+   * @return `false` if the ring is full, or the playback has finished.
+   */
+  bool render_ahead_block();
+
+  /**
+   * @brief Copies the frames in the render-ahead ring to the audio buffer.
+   * @return `false` if the copy fails. Then `abandon_device` must be called.
+   * @details `m_render_mutex` is not needed, since the ring is not reset meanwhile.
+   */
+  bool copy_wave_data();
+
+  /**
+   * @brief Releases the audio device after a failure of writing. `m_render_mutex` must be locked.
+   */
+  void abandon_device();
+
+  /**
+   * @brief Writes the silence handed over by `change_latency` before the wave data.
+   * @param frames The unoccupied frames in the audio buffer.
+   * @return The frames of silence written.
+   */
+  UINT32 write_handover_silence(UINT32 frames);
+
+  /**
+   * @brief Judges the last write with `m_latency_controller`. `m_render_mutex` need not be
+   * locked, since the controller is used only by the render thread.
+   * @return `true` if `apply_latency` has to be called, i.e., the latency is to be changed or a
+   * replaced client is playing out.
+   */
+  bool update_latency();
+
+  /**
+   * @brief Releases the replaced client if it has drained, and changes the latency to that of
+   * `m_latency_controller`. `m_render_mutex` must be locked.
+   */
+  void apply_latency();
+
+  /**
+   * @brief Re-creates the audio client with a latency, or keeps it for the next initialization
+   * if the device is not initialized.
+   * @details While the client replaced by the previous change is playing out, the change is
+   * deferred, and `apply_latency` makes it when the replaced client has drained.
+   */
+  void change_latency(unsigned int latency);
+
+  /**
+   * @brief Stops the producer thread if it is running.
+   */
+  void stop_producer_thread();
+
+  /**
+   * @brief Fills the audio buffer and starts the audio client.
+   * @details If the render-ahead ring is enabled, the ring is filled first.
+   */
+  void start_playback();
+
+  /**
+   * @brief `true` if the generator has faded out, and the client should stop.
+   */
+  bool playback_finished() const;
+
   /**
    * @brief Initializes the audio device and the related objects.
    * @details `m_audio_api_wrapper.initialize_device` and `update_wave_parameters` are called.
@@ -266,15 +500,86 @@ class ToneGenerator {
   void initialize_device();
 
   /**
-   * @brief Applies the updated wave parameters to `ToneDataGenerator`.
+   * @brief Handles a notification to switch the stream or to release the device.
+   * @param stream_switch `true` if the device should be initialized again.
+   * @details The device is released at once, and `m_device_settle_timer` is set to end the
+   * settling when the notifications stop.
+   */
+  void on_device_notification(bool stream_switch);
+
+  /**
+   * @brief Ends the settling, and initializes the device again if a stream switch has been
+   * notified. The playback is resumed if it was playing or a start is scheduled.
+   */
+  void on_device_settled();
+
+  /**
+   * @brief Initializes the audio device if it is not initialized and not settling.
+   * @return `true` if the audio device is initialized.
+   */
+  bool prepare_device();
+
+  /**
+   * @brief Publishes `m_parameters` to the render thread. `m_mutex` must be locked.
+   */
+  void publish_parameters();
+
+  /**
+   * @brief Applies the latest wave parameters published to `ToneDataGenerator`.
+   * @details The amplitudes and the frequencies are applied only if `set_wave_parameters` has
+   * been called since the last time, so that the last values of a timeline that has ended are
+   * kept.
    */
   void update_wave_parameters();
 
+  /**
+   * @brief Publishes the state of the audio rendering for `get_live_parameters`.
+   */
+  void publish_live_parameters();
+
   /**
    * @brief Writes the wave data to the audio buffer.
    */
   void write_wave_data();
 
+  /**
+   * @brief Renders the wave data, applying the commands at their stream positions.
+   * @param buffer The buffer to render into, in the format of the device.
+   * @param frames_to_write The frames to render.
+   * @param padding The frames queued before `buffer` that have not been played yet.
+   */
+  void render_wave_data(BYTE *buffer, UINT32 frames_to_write, UINT32 padding);
+
+  /**
+   * @brief Moves the commands from `m_command_queue` to `m_pending_commands`.
+   * @param padding The frames written to the audio buffer that have not been played yet.
+   * @details The times of the commands are converted to stream positions with the current time,
+   * assuming that the next frame written is played after `padding` frames.
+   */
+  void receive_commands(UINT32 padding);
+
+  /**
+   * @brief Applies a command to `ToneDataGenerator` and the play state.
+   */
+  void apply_command(const ToneCommand &command);
+
+  /**
+   * @brief `true` if a start command is waiting for its stream position.
+   */
+  bool has_pending_start() const;
+
+  /**
+   * @brief Validates the commands and queues them. `m_mutex` must not be locked.
+   */
+  void queue_commands(const std::vector<ToneCommand> &commands, const QueuedCommand &timing);
+
+  /**
+   * @brief Reports the progress of the timeline about every second, and once when it ends.
+   * @details The report is published in `LiveParameters` with the next state, so that the render
+   * thread does not call into the user of this class.
+   */
+  void report_timeline_progress();
+
   /**
    * @brief Starts the audio client.
    */
@@ -314,11 +619,20 @@ class ToneGenerator {
    * @param latency Latency in milliseconds. This affects the buffer size of the audio client.
    * @param error_callback A callback function to receive error messages. Errors encountered in the
    * audio rendering thread are reported through this function.
+   * @param realtime_options The scheduling of the audio rendering thread. The scheduling actually
+   * obtained is in `LiveParameters::scheduling`.
+   * @param render_ahead The depth of the render-ahead ring in milliseconds, or 0 to render in the
+   * device event. If it is not 0, a producer thread renders the audio ahead into the ring, and
+   * the device event only copies from the ring, so a slow block of rendering does not cause an
+   * underrun as long as the ring has frames. A change of the parameters reaches the device
+   * within `render_ahead` milliseconds plus the latency.
    * @exception `std::runtime_error` is thrown if the initialization fails.
    * @details A new thread is created and the audio rendering is performed in that thread.
    */
   ToneGenerator(unsigned int latency,
-                std::function<void(const std::string &)> error_callback = nullptr);
+                std::function<void(const std::string &)> error_callback = nullptr,
+                const RealtimeOptions &realtime_options = RealtimeOptions(),
+                unsigned int render_ahead = 0);
 
   /**
    * @brief Destroy the `ToneGenerator` object.
@@ -327,18 +641,114 @@ class ToneGenerator {
   ~ToneGenerator();
 
   /**
-   * @brief Set the parameters of the sine wave.
+   * @brief Set the parameters of the waves.
    * @param left_amplitude Amplitude of the left channel (0.0-1.0).
    * @param right_amplitude Amplitude of the right channel (0.0-1.0).
-   * @param left_frequency Frequency of the left channel in Hz.
-   * @param right_frequency Frequency of the right channel in Hz.
+   * @param left_frequency Frequency of the left channel in Hz (0.001-20000).
+   * @param right_frequency Frequency of the right channel in Hz (0.001-20000).
+   * @param left_waveform Waveform of the left channel.
+   * @param right_waveform Waveform of the right channel.
    * @exception `std::invalid_argument` is thrown if the parameters are out of range.
    * @details This function can be called without waiting for the audio device initialization.
    * This function can be called while the audio rendering is running.
    * `set_wave_parameters`, `start`, and `stop` can safely be called in any order.
    */
   void set_wave_parameters(double left_amplitude, double right_amplitude, double left_frequency,
-                           double right_frequency);
+                           double right_frequency, Waveform left_waveform = Waveform::sine,
+                           Waveform right_waveform = Waveform::sine);
+
+  /**
+   * @brief Set the gains of the noise beds mixed under the sine waves.
+   * @param white_gain Gain of the white noise (0.0-1.0).
+   * @param pink_gain Gain of the pink noise (0.0-1.0).
+   * @param brown_gain Gain of the brown noise (0.0-1.0).
+   * @exception `std::invalid_argument` is thrown if the parameters are out of range.
+   * @details This function can be called in the same way as `set_wave_parameters`. The noise is
+   * played and stopped together with the sine waves.
+   */
+  void set_noise_parameters(double white_gain, double pink_gain, double brown_gain);
+
+  /**
+   * @brief Set the gains from the left and right channels to the speaker positions.
+   * @param left_gains Gains of the left channel (0.0-1.0), indexed by the speaker position.
+   * @param right_gains Gains of the right channel (0.0-1.0), indexed by the speaker position.
+   * @exception `std::invalid_argument` is thrown if the parameters are out of range, or the sizes
+   * are different.
+   * @details The speaker position `i` is the bit `1 << i` of the channel mask (`SPEAKER_*`), e.g.,
+   * 0 is the front left, 1 is the front right, 4 is the back left, and 9 is the side left. There
+   * are at most 18 positions. The positions are mapped to the channels of the device with its
+   * channel mask, and the positions that the device does not have are ignored. If the format of
+   * the device has no channel mask, the position is the index of the channel. This is used to
+   * play the tone on several stereo pairs of a multichannel device at once. Empty vectors restore
+   * the default, which plays the left and right channels on the first two channels. This
+   * function can be called in the same way as `set_wave_parameters`.
+   */
+  void set_channel_routing(const std::vector<double> &left_gains,
+                           const std::vector<double> &right_gains);
+
+  /**
+   * @brief Set a tone pair played with the tone, e.g., the tone of another listening station.
+   * @param index The index of the pair (0-7).
+   * @param amplitude Amplitude of both channels of the pair (0.0-1.0). 0 turns the pair off.
+   * @param left_frequency Frequency of the left channel in Hz (0.001-20000).
+   * @param right_frequency Frequency of the right channel in Hz (0.001-20000).
+   * @param left_gains Gains of the left channel (0.0-1.0), indexed by the speaker position.
+   * @param right_gains Gains of the right channel (0.0-1.0), indexed by the speaker position.
+   * @exception `std::invalid_argument` is thrown if the parameters are out of range, or the sizes
+   * of the gains are different.
+   * @details Each pair is a sine wave of its own frequency and phase in each channel. Its gains
+   * are mapped to the channels of the device as those of `set_channel_routing`, so that one
+   * device can play up to 8 independent stereo pairs besides the tone. Empty gains add the pair
+   * to the left and right channels of the tone instead. A pair starts and stops at the zero
+   * crossings of its sine waves without a ramp, and stops with the tone. This function can be
+   * called in the same way as `set_wave_parameters`.
+   */
+  void set_tone_pair(unsigned int index, double amplitude, double left_frequency,
+                     double right_frequency, const std::vector<double> &left_gains,
+                     const std::vector<double> &right_gains);
+
+  /**
+   * @brief Set a timeline of the amplitudes and the frequencies, and start it.
+   * @param timeline The timeline. The durations are in seconds, the amplitudes are in the range
+   * 0.0-1.0, and the frequencies are in Hz (0.001-20000).
+   * @exception `std::invalid_argument` is thrown if the parameters are out of range, a track has
+   * more than `MAX_TIMELINE_SEGMENTS` segments, or an exponential segment does not have positive
+   * values at both ends.
+   * @details The parameters follow the timeline at sample accuracy instead of the values of
+   * `set_wave_parameters`. The timeline advances only while the audio is played. Its progress is
+   * reported in `LiveParameters::timeline_reports` about every second, and once when it ends or
+   * is stopped.
+   * When it ends, the tone continues with its last values. `set_wave_parameters` stops the
+   * timeline. This function can be called in the same way as `set_wave_parameters`.
+   */
+  void set_timeline(const Timeline &timeline);
+
+  /**
+   * @brief Stop the timeline. The parameters ramp to the values of `set_wave_parameters`.
+   * @details This function can be called in the same way as `set_wave_parameters`.
+   */
+  void stop_timeline();
+
+  /**
+   * @brief Set the latency of the audio client. The automatic latency is turned off.
+   * @param latency Latency in milliseconds (1-2000).
+   * @exception `std::invalid_argument` is thrown if the latency is out of range.
+   * @details The stream is re-created at once. While playing, the new stream starts with silence
+   * until the old one has played its buffer, so that the audio continues without a gap or a
+   * jump of the phase.
+   */
+  void set_latency(unsigned int latency);
+
+  /**
+   * @brief Let the latency follow the load of the system.
+   * @param min_latency Minimum latency in milliseconds (1-2000).
+   * @param max_latency Maximum latency in milliseconds (`min_latency`-2000).
+   * @exception `std::invalid_argument` is thrown if the range is invalid.
+   * @details The latency starts from `min_latency`, widens when the audio buffer runs low, and
+   * narrows again while it does not (see `LatencyController`). The stream is re-created in the
+   * same way as `set_latency`.
+   */
+  void set_adaptive_latency(unsigned int min_latency, unsigned int max_latency);
 
   /**
    * @brief Start to play the audio.
@@ -354,6 +764,44 @@ class ToneGenerator {
    */
   void stop();
 
+  /**
+   * @brief Schedule a batch of commands at a stream position.
+   * @param stream_position The frame at which the commands are applied, counted in the frames
+   * written to the audio devices (see `LiveParameters::stream_position`). The commands for a
+   * position already written are applied at the next frame written.
+   * @param commands The commands. They are applied in order at the same frame, and the render
+   * thread sees either all of them or none of them.
+   * @exception `std::invalid_argument` is thrown if the parameters of a command are out of range.
+   * `std::runtime_error` is thrown if more than `MAX_SCHEDULED_COMMANDS` commands would be
+   * waiting. Nothing is scheduled then.
+   * @details The render thread splits the buffer at the frame, so the changes are sample
+   * accurate regardless of the latency. The parameters ramp from the frame over the smoothing
+   * time of `ToneDataGenerator`. While a start is waiting, the audio client is kept running and
+   * silence is written, so that the start is not delayed by the start of the client. A
+   * `set_wave_parameters` command stops the timeline. The commands apply until the parameters
+   * are set again by the other functions.
+   */
+  void schedule_commands(std::uint64_t stream_position, const std::vector<ToneCommand> &commands);
+
+  /**
+   * @brief Schedule a batch of commands at a time.
+   * @param time The time at which the frame of the commands is played. The time is converted to
+   * a stream position with the number of the frames in the audio buffer, so it is accurate to
+   * the clock of the device.
+   * @details Otherwise the same as the other overload.
+   */
+  void schedule_commands(std::chrono::steady_clock::time_point time,
+                         const std::vector<ToneCommand> &commands);
+
+  /**
+   * @brief Get the state of the audio rendering actually in use.
+   * @details The amplitudes and the frequencies are the values of the next frame, which follow
+   * the parameters over the smoothing time, or the timeline. The state is updated by the render
+   * thread after every buffer and every change of the parameters. This function never blocks
+   * the render thread.
+   */
+  LiveParameters get_live_parameters();
+
   /**
    * @brief Get the current audio device information.
    * @return A string containing the audio device information.
@@ -0,0 +1,78 @@
+/**
+ * @file triple_buffer.h
+ * @brief `TripleBuffer` class template.
+ */
+
+#pragma once
+
+#include <atomic>
+
+/**
+ * @brief A wait-free channel that passes the latest value of `T` from a writer to a reader.
+ * @tparam T The type of the value. It is copied into the buffer, so a type that reuses its
+ * storage on assignment (e.g., `std::vector`) does not allocate once its capacity is reached.
+ * @details There are three slots: the writer owns the back slot, the reader owns the front slot,
+ * and the middle slot holds the latest value published. `publish` swaps the back slot with the
+ * middle slot, and `update` swaps the middle slot with the front slot if a value has been
+ * published since the last swap. Each swap is a single atomic exchange, so neither side waits for
+ * the other, and the reader always sees a complete value. Values published between two calls of
+ * `update` are skipped. There must be only one writer and one reader at a time. This class does
+ * not depend on the Windows API.
+ */
+template <class T>
+class TripleBuffer {
+ private:
+  // Constants.
+  static constexpr unsigned int INDEX_MASK = 3;  // Bits of `m_middle` for the index of the slot.
+  static constexpr unsigned int FRESH = 4;       // Bit of `m_middle` set by `publish`.
+
+  // The slots are on separate cache lines, so that the writer and the reader do not share them.
+  struct alignas(64) Slot {
+    T value;
+  };
+
+  Slot m_slots[3];
+  alignas(64) std::atomic<unsigned int> m_middle{1};  // Index of the middle slot and `FRESH`.
+  alignas(64) unsigned int m_back = 0;                // Index of the slot of the writer.
+  alignas(64) unsigned int m_front = 2;               // Index of the slot of the reader.
+
+ public:
+  /**
+   * @brief Construct a new `TripleBuffer` object.
+   * @param value The initial value of the slots.
+   */
+  explicit TripleBuffer(const T &value = T()) : m_slots{{value}, {value}, {value}} {}
+
+  TripleBuffer(const TripleBuffer &) = delete;
+  TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+  /**
+   * @brief Returns the slot of the writer.
+   * @details The slot holds an older value, so the whole value must be written before `publish`.
+   */
+  T &back() { return m_slots[m_back].value; }
+
+  /**
+   * @brief Publishes the value of `back` to the reader. Called by the writer.
+   */
+  void publish() {
+    m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+  }
+
+  /**
+   * @brief Moves the latest value published to `front`. Called by the reader.
+   * @return `true` if a value has been published since the last call.
+   */
+  bool update() {
+    if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+      return false;
+    }
+    m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+  }
+
+  /**
+   * @brief Returns the slot of the reader, i.e., the value moved by the last `update`.
+   */
+  const T &front() const { return m_slots[m_front].value; }
+};
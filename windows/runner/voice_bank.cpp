@@ -0,0 +1,159 @@
+/**
+ * @file voice_bank.cpp
+ * @brief `VoiceBank` class implementation.
+ */
+
+#include "voice_bank.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// Constants.
+constexpr double PI = 3.14159265358979323846;
+
+VoiceBank::VoiceBank(double samples_per_second) : m_samples_per_second(samples_per_second) {}
+
+unsigned int VoiceBank::size() const {
+  return static_cast<unsigned int>(m_phases.size());
+}
+
+bool VoiceBank::is_silent() const {
+  return std::all_of(m_states.begin(), m_states.end(),
+                     [](VoiceState state) { return state == VoiceState::stopped; });
+}
+
+void VoiceBank::set_samples_per_second(double samples_per_second) {
+  m_samples_per_second = samples_per_second;
+}
+
+void VoiceBank::reserve(unsigned int voices_count) {
+  for (auto *values : {&m_phases, &m_phase_deltas}) {
+    values->reserve(voices_count);
+  }
+  for (auto *values : {&m_gains, &m_pans, &m_left_gains, &m_right_gains}) {
+    values->reserve(voices_count);
+  }
+  m_states.reserve(voices_count);
+}
+
+unsigned int VoiceBank::add_voice(double frequency, float gain, float pan) {
+  const unsigned int index = size();
+  m_phases.push_back(0);
+  m_phase_deltas.push_back(0);
+  m_gains.push_back(0.0f);
+  m_pans.push_back(0.0f);
+  m_left_gains.push_back(0.0f);
+  m_right_gains.push_back(0.0f);
+  m_states.push_back(VoiceState::stopped);
+  set_frequency(index, frequency);
+  set_gain(index, gain, pan);
+  return index;
+}
+
+unsigned int VoiceBank::add_pair(double left_frequency, double right_frequency, float gain) {
+  const unsigned int index = add_voice(left_frequency, gain, -1.0f);
+  add_voice(right_frequency, gain, 1.0f);
+  return index;
+}
+
+void VoiceBank::set_frequency(unsigned int index, double frequency) {
+  assert(index < size());
+  assert(frequency > 0);
+
+  m_phase_deltas[index] = phase_delta_of(frequency, m_samples_per_second);
+}
+
+void VoiceBank::set_gain(unsigned int index, float gain, float pan) {
+  assert(index < size());
+  assert(pan >= -1.0f && pan <= 1.0f);
+
+  m_gains[index] = gain;
+  m_pans[index] = pan;
+  if (gain == 0) {
+    // The previous gains are used until the voice stops.
+    if (m_states[index] == VoiceState::playing) {
+      m_states[index] = VoiceState::stopping;
+    }
+    return;
+  }
+  m_states[index] = VoiceState::playing;
+  update_channel_gains(index);
+}
+
+void VoiceBank::reset_phases(std::uint64_t frame) {
+  for (unsigned int i = 0; i < size(); ++i) {
+    if (m_states[i] == VoiceState::stopping) {
+      m_states[i] = VoiceState::stopped;
+    }
+    // The phase advances by an integer per frame and wraps, so the product is exact.
+    m_phases[i] = m_states[i] == VoiceState::stopped ? 0 : frame * m_phase_deltas[i];
+  }
+}
+
+void VoiceBank::update_channel_gains(unsigned int index) {
+  // sin^2 + cos^2 = 1, so the power is constant. Both gains are computed with the sine, so that a
+  // voice panned to one side is exactly 0 on the other.
+  const double pan = m_pans[index];
+  m_left_gains[index] = static_cast<float>(m_gains[index] * std::sin((1.0 - pan) * PI / 4));
+  m_right_gains[index] = static_cast<float>(m_gains[index] * std::sin((1.0 + pan) * PI / 4));
+}
+
+void VoiceBank::clear() {
+  for (auto *values : {&m_phases, &m_phase_deltas}) {
+    values->clear();
+  }
+  for (auto *values : {&m_gains, &m_pans, &m_left_gains, &m_right_gains}) {
+    values->clear();
+  }
+  m_states.clear();
+}
+
+void VoiceBank::render(float *left, float *right, unsigned int frames_count) {
+  std::fill(left, left + frames_count, 0.0f);
+  std::fill(right, right + frames_count, 0.0f);
+  add(left, right, frames_count, false);
+}
+
+unsigned int VoiceBank::add(float *left, float *right, unsigned int frames_count,
+                            bool is_stopping) {
+  // While every voice is played, the voices are mixed in one pass.
+  const auto is_playing = [](VoiceState state) { return state == VoiceState::playing; };
+  if (!is_stopping && std::all_of(m_states.begin(), m_states.end(), is_playing)) {
+    add_sines(left, right, frames_count, size(), m_phases.data(), m_phase_deltas.data(),
+              m_left_gains.data(), m_right_gains.data());
+    return frames_count;
+  }
+
+  unsigned int sound_frames = 0;
+  for (unsigned int i = 0; i < size(); ++i) {
+    if (m_states[i] == VoiceState::stopped) {
+      // A voice stopped by `is_stopping` restarts from the phase 0.
+      if (is_stopping || m_gains[i] == 0) {
+        continue;
+      }
+      m_states[i] = VoiceState::playing;
+    }
+    if (m_states[i] == VoiceState::playing && !is_stopping) {
+      add_sines(left, right, frames_count, 1, &m_phases[i], &m_phase_deltas[i], &m_left_gains[i],
+                &m_right_gains[i]);
+      sound_frames = frames_count;
+    } else {
+      sound_frames = std::max(sound_frames, add_until_zero_crossing(i, left, right, frames_count));
+    }
+  }
+  return sound_frames;
+}
+
+unsigned int VoiceBank::add_until_zero_crossing(unsigned int index, float *left, float *right,
+                                                unsigned int frames_count) {
+  const unsigned int frames = frames_until_zero_crossing(Waveform::sine, m_phases[index],
+                                                         m_phase_deltas[index], frames_count);
+  add_sines(left, right, frames, 1, &m_phases[index], &m_phase_deltas[index],
+            &m_left_gains[index], &m_right_gains[index]);
+  if (frames < frames_count) {
+    m_states[index] = VoiceState::stopped;
+    m_phases[index] = 0;
+  }
+  return frames;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file voice_bank.h
+ * @brief `VoiceBank` class declaration.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "oscillator.h"
+
+/**
+ * @brief A bank of sine oscillators mixed into a stereo pair.
+ * @details The state of the voices is stored as a structure of arrays (phases, phase deltas,
+ * gains, and pans in separate contiguous arrays), so that `render` reads each array
+ * sequentially and mixes every voice with `add_sines` in one pass. This is used to layer several
+ * carrier/beat pairs, e.g., a delta and a theta layer.
+ *
+ * Voices per core at 48 kHz with 10 ms (480 frames) buffers, i.e., the number of voices that
+ * would use 100 % of a core in real time, measured with 64 to 256 voices on an x86-64 Xeon core:
+ *
+ * | Instruction set | Voices per core | Time per voice and frame |
+ * |-----------------|-----------------|--------------------------|
+ * | SSE2            | about 8,500     | 2.4 ns                   |
+ * | AVX2            | about 23,000    | 0.9 ns                   |
+ *
+ * Rendering each voice with `render_sine` and mixing it in a second pass is 1.1 to 3.3 times
+ * slower.
+ *
+ * A voice starts and stops at zero crossings: a voice whose gain is set to 0 plays until its next
+ * zero crossing, and restarts from the phase 0 when its gain is set again, so that the voices can
+ * be switched on and off during playback without clicks. `ToneDataGenerator` renders each of its
+ * tone pairs with a bank of this class.
+ *
+ * No memory is allocated by `render` and `add`. Call `reserve` before playback to avoid the
+ * allocation in `add_voice`. This class does not depend on the Windows API.
+ */
+class VoiceBank {
+ private:
+  /**
+   * @brief States of a voice.
+   */
+  enum class VoiceState : std::uint8_t {
+    playing,   // The voice is played.
+    stopping,  // The voice is played up to its next zero crossing, and then stopped.
+    stopped,   // The voice is silent, and its phase is 0.
+  };
+
+  double m_samples_per_second;
+
+  // Structure of arrays. The element `i` of each array is the voice `i`.
+  std::vector<Phase> m_phases;        // Phases of the next samples.
+  std::vector<Phase> m_phase_deltas;  // Phase advances per sample.
+  std::vector<float> m_gains;         // Gains (0.0-1.0).
+  std::vector<float> m_pans;          // Pans (-1.0 is left, 0.0 is center, and 1.0 is right).
+  std::vector<float> m_left_gains;    // Gains of the left channel computed from the pans.
+  std::vector<float> m_right_gains;   // Gains of the right channel computed from the pans.
+  std::vector<VoiceState> m_states;   // States of the voices.
+
+  /**
+   * @brief Updates the gains of the channels of the voice from its gain and pan.
+   */
+  void update_channel_gains(unsigned int index);
+
+  /**
+   * @brief Adds a voice up to the frame before its next zero crossing, and stops it there.
+   * @return The number of frames added.
+   */
+  unsigned int add_until_zero_crossing(unsigned int index, float *left, float *right,
+                                       unsigned int frames_count);
+
+ public:
+  /**
+   * @brief Constructor.
+   * @param samples_per_second Samples per second in Hz.
+   */
+  explicit VoiceBank(double samples_per_second);
+
+  /**
+   * @brief Returns the number of voices.
+   */
+  unsigned int size() const;
+
+  /**
+   * @brief `true` if every voice is stopped.
+   */
+  bool is_silent() const;
+
+  /**
+   * @brief Changes the sample rate. The frequencies must be set again with `set_frequency`.
+   */
+  void set_samples_per_second(double samples_per_second);
+
+  /**
+   * @brief Allocates the memory for the voices.
+   * @param voices_count The number of voices.
+   */
+  void reserve(unsigned int voices_count);
+
+  /**
+   * @brief Adds a voice that starts at the phase 0.
+   * @param frequency The frequency in Hz. A frequency above the Nyquist frequency is clamped.
+   * @param gain The gain (0.0-1.0). The voice is stopped if it is 0.
+   * @param pan The pan (-1.0 to 1.0). The constant power panning law is used.
+   * @return The index of the voice.
+   */
+  unsigned int add_voice(double frequency, float gain, float pan);
+
+  /**
+   * @brief Adds a binaural pair, i.e., a voice on each channel.
+   * @param left_frequency The frequency of the left voice in Hz.
+   * @param right_frequency The frequency of the right voice in Hz.
+   * @param gain The gain of both voices (0.0-1.0).
+   * @return The index of the left voice. The right voice is the next index.
+   */
+  unsigned int add_pair(double left_frequency, double right_frequency, float gain);
+
+  /**
+   * @brief Changes the frequency of the voice. The phase is continuous.
+   */
+  void set_frequency(unsigned int index, double frequency);
+
+  /**
+   * @brief Changes the gain and the pan of the voice.
+   * @details If the gain is 0, the voice keeps its previous gains up to its next zero crossing,
+   * and then stops. A stopped voice restarts from the phase 0 when its gain is set to a value
+   * other than 0.
+   */
+  void set_gain(unsigned int index, float gain, float pan);
+
+  /**
+   * @brief Sets the phase of each voice that is not stopped to its phase at a frame, as if it had
+   * been played from the phase 0 at the frame 0. A voice that is stopping is stopped.
+   */
+  void reset_phases(std::uint64_t frame);
+
+  /**
+   * @brief Removes all voices.
+   */
+  void clear();
+
+  /**
+   * @brief Renders the mix of the voices.
+   * @param left A pointer to the buffer to write `frames_count` samples of the left channel.
+   * @param right A pointer to the buffer to write `frames_count` samples of the right channel.
+   * @param frames_count The number of samples to write to each channel.
+   * @details The buffers are overwritten. They are filled with 0 if there are no voices.
+   */
+  void render(float *left, float *right, unsigned int frames_count);
+
+  /**
+   * @brief Adds the mix of the voices to a stereo pair.
+   * @param left A pointer to the buffer of `frames_count` samples of the left channel.
+   * @param right A pointer to the buffer of `frames_count` samples of the right channel.
+   * @param frames_count The number of samples to add to each channel.
+   * @param is_stopping If `true`, every voice is stopped at its next zero crossing. The voices
+   * that have a gain restart from the phase 0 at the next call without `is_stopping`.
+   * @return The number of frames to the end of the last voice that has sounded, i.e.,
+   * `frames_count` unless every voice has stopped within the call.
+   */
+  unsigned int add(float *left, float *right, unsigned int frames_count, bool is_stopping);
+};
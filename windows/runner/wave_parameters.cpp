@@ -0,0 +1,63 @@
+/**
+ * @file wave_parameters.cpp
+ * @brief `WaveParameters` structure implementation.
+ */
+
+#include "wave_parameters.h"
+
+namespace {
+
+/**
+ * @brief Maps the gains of the speaker positions to the channels of a device.
+ * @param speaker_gains The gains of the speaker positions.
+ * @param channel_mask The channel mask of the device, or 0 (see `apply_channel_routing`).
+ * @param channels_count The number of channels of the device.
+ * @param channel_gains The gains of the channels to set. The other channels are set to 0.
+ */
+void map_speaker_gains(const SpeakerGains &speaker_gains, std::uint32_t channel_mask,
+                       unsigned int channels_count, ChannelGains &channel_gains) {
+  channel_gains.fill(0.0f);
+  // The channels of the device are in the order of the bits of its channel mask.
+  unsigned int channel = 0;
+  for (unsigned int position = 0; position < SPEAKER_POSITIONS_COUNT &&
+                                   channel < channels_count && channel < MAX_ROUTED_CHANNELS;
+       ++position) {
+    if (channel_mask != 0 && (channel_mask & (std::uint32_t{1} << position)) == 0) {
+      continue;
+    }
+    channel_gains[channel] = static_cast<float>(speaker_gains[position]);
+    ++channel;
+  }
+}
+
+}  // namespace
+
+void apply_channel_routing(const WaveParameters &parameters, std::uint32_t channel_mask,
+                           ToneDataGenerator &generator) {
+  const unsigned int channels_count = generator.channels_count;
+  generator.channel_routing = parameters.channel_routing;
+  if (parameters.channel_routing) {
+    map_speaker_gains(parameters.left_speaker_gains, channel_mask, channels_count,
+                      generator.left_channel_gains);
+    map_speaker_gains(parameters.right_speaker_gains, channel_mask, channels_count,
+                      generator.right_channel_gains);
+  } else {
+    generator.left_channel_gains.fill(0.0f);
+    generator.right_channel_gains.fill(0.0f);
+  }
+
+  for (unsigned int i = 0; i < MAX_TONE_PAIRS; ++i) {
+    const TonePairParameters &source = parameters.tone_pairs[i];
+    TonePair &pair = generator.pairs[i];
+    pair.channel_routing = source.channel_routing;
+    if (source.channel_routing) {
+      map_speaker_gains(source.left_speaker_gains, channel_mask, channels_count,
+                        pair.left_channel_gains);
+      map_speaker_gains(source.right_speaker_gains, channel_mask, channels_count,
+                        pair.right_channel_gains);
+    } else {
+      pair.left_channel_gains.fill(0.0f);
+      pair.right_channel_gains.fill(0.0f);
+    }
+  }
+}
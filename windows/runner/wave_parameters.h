@@ -0,0 +1,88 @@
+/**
+ * @file wave_parameters.h
+ * @brief `WaveParameters` structure declaration.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "oscillator.h"
+#include "timeline.h"
+#include "tone_data_generator.h"
+
+// Constants.
+// Number of the speaker positions of the channel mask (`SPEAKER_FRONT_LEFT` to
+// `SPEAKER_TOP_BACK_RIGHT`).
+constexpr unsigned int SPEAKER_POSITIONS_COUNT = 18;
+
+/**
+ * @brief Gains from a channel of the tone to each speaker position (0.0-1.0). The position `i` is
+ * the bit `1 << i` of a channel mask.
+ */
+using SpeakerGains = std::array<double, SPEAKER_POSITIONS_COUNT>;
+
+/**
+ * @brief The parameters of a tone pair set by `ToneGenerator::set_tone_pair`.
+ */
+struct TonePairParameters {
+  double amplitude = 0.0;        // Amplitude of both channels (0.0-1.0). 0 if the pair is off.
+  double left_frequency = 440;   // Frequency of the left channel in Hz.
+  double right_frequency = 440;  // Frequency of the right channel in Hz.
+  // Gains from the left and right channels to the speaker positions, used if `channel_routing`
+  // is `true`. Otherwise, the pair is added to the left and right channels of the tone.
+  bool channel_routing = false;
+  SpeakerGains left_speaker_gains{};
+  SpeakerGains right_speaker_gains{};
+};
+
+/**
+ * @brief The parameters set by the user of `ToneGenerator`.
+ * @details They are copied to the render thread as a whole through a `TripleBuffer`, so the render
+ * thread never waits for the user. The generations tell the render thread which of them have been
+ * set since it applied them last. Every member has a fixed size except the segments of
+ * `timeline`, which the render thread copies into the storage reserved by
+ * `ToneDataGenerator::reserve_timeline`, so applying them does not allocate memory. This
+ * structure does not depend on the Windows API.
+ */
+struct WaveParameters {
+  double left_amplitude = 1.0;   // Amplitude of the left channel (0.0-1.0).
+  double right_amplitude = 1.0;  // Amplitude of the right channel (0.0-1.0).
+  double left_frequency = 440;   // Frequency of the left channel in Hz.
+  double right_frequency = 440;  // Frequency of the right channel in Hz.
+  Waveform left_waveform = Waveform::sine;   // Waveform of the left channel.
+  Waveform right_waveform = Waveform::sine;  // Waveform of the right channel.
+  double white_noise_gain = 0.0;  // Gain of the white noise (0.0-1.0).
+  double pink_noise_gain = 0.0;   // Gain of the pink noise (0.0-1.0).
+  double brown_noise_gain = 0.0;  // Gain of the brown noise (0.0-1.0).
+  // Gains from the left and right channels to the speaker positions (see
+  // `ToneGenerator::set_channel_routing`), used if `channel_routing` is `true`.
+  bool channel_routing = false;
+  SpeakerGains left_speaker_gains{};
+  SpeakerGains right_speaker_gains{};
+  std::array<TonePairParameters, MAX_TONE_PAIRS> tone_pairs{};  // Pairs set by `set_tone_pair`.
+  Timeline timeline;          // Timeline set by `set_timeline`.
+  bool has_timeline = false;  // `true` from `set_timeline` to `stop_timeline`.
+  unsigned int latency = 0;        // Latency set by `set_latency` in milliseconds.
+  bool adaptive_latency = false;   // `true` from `set_adaptive_latency` to `set_latency`.
+  unsigned int min_latency = 0;    // Range of the latency set by `set_adaptive_latency`.
+  unsigned int max_latency = 0;
+  std::uint64_t wave_generation = 1;        // Incremented by `set_wave_parameters`.
+  std::uint64_t noise_generation = 1;       // Incremented by `set_noise_parameters`.
+  std::uint64_t tone_pairs_generation = 0;  // Incremented by `set_tone_pair`.
+  std::uint64_t timeline_generation = 0;    // Incremented when `has_timeline` or `timeline` is set.
+  std::uint64_t latency_generation = 0;     // Incremented when the latency is set.
+};
+
+/**
+ * @brief Sets the routing of a generator and its tone pairs from the speaker gains of the
+ * parameters.
+ * @param parameters The parameters.
+ * @param channel_mask The channel mask of the device. The channels of the device are in the order
+ * of its bits, and the positions that the device lacks are ignored. If 0, the channel `i` is the
+ * position `i`.
+ * @param generator The generator, whose `channels_count` is set.
+ */
+void apply_channel_routing(const WaveParameters &parameters, std::uint32_t channel_mask,
+                           ToneDataGenerator &generator);
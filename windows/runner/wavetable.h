@@ -0,0 +1,111 @@
+/**
+ * @file wavetable.h
+ * @brief Wavetables generated at compile time for the wavetable oscillator.
+ */
+
+#pragma once
+
+#include <cmath>
+
+#include "oscillator.h"
+
+/**
+ * @brief A single period of a waveform sampled at `Size` points.
+ * @tparam Size The number of points per period.
+ * @details `samples` holds one guard point before and two after the period, so that the
+ * interpolation can read the points -1 to `Size` + 1 without wrapping the index. The point `i` of
+ * the period is stored in `samples[i + 1]`.
+ */
+template <unsigned int Size>
+struct Wavetable {
+  static constexpr unsigned int size = Size;
+  float samples[Size + 3];
+};
+
+/**
+ * @brief Creates a wavetable of a waveform at compile time.
+ * @tparam Size The number of points per period.
+ * @tparam Shape A class with `static constexpr double value(double cycle)`, which returns the
+ * value of the waveform in [-1, 1] at the phase `cycle` in [0, 1).
+ */
+template <unsigned int Size, class Shape>
+constexpr Wavetable<Size> make_wavetable() {
+  Wavetable<Size> table{};
+  for (unsigned int i = 0; i < Size + 3; ++i) {
+    // The first point is the last point of the period, and the last two are its first two.
+    const unsigned int point = (i + Size - 1) % Size;
+    table.samples[i] = static_cast<float>(Shape::value(static_cast<double>(point) / Size));
+  }
+  return table;
+}
+
+/**
+ * @brief The sine wave shape for `make_wavetable`.
+ * @details `std::sin` is not `constexpr`, so the sine is computed with its Taylor series after
+ * folding the phase into [-PI / 2, PI / 2]. The truncation error is below 1e-13.
+ */
+struct SineShape {
+  static constexpr double value(double cycle) {
+    constexpr double PI = 3.14159265358979323846;
+    // Fold the phase into [-0.25, 0.25] cycles.
+    double x = cycle >= 0.5 ? cycle - 1.0 : cycle;  // [-0.5, 0.5)
+    if (x > 0.25) {
+      x = 0.5 - x;
+    } else if (x < -0.25) {
+      x = -0.5 - x;
+    }
+    x *= 2 * PI;
+
+    double term = x;
+    double sum = x;
+    for (int n = 1; n <= 9; ++n) {
+      term *= -x * x / ((2 * n) * (2 * n + 1));
+      sum += term;
+    }
+    return sum;
+  }
+};
+
+/**
+ * @brief Sine wavetables. Only the sizes used by the oscillator are instantiated.
+ */
+template <unsigned int Size>
+inline constexpr Wavetable<Size> SINE_WAVETABLE = make_wavetable<Size, SineShape>();
+
+/**
+ * @brief Writes a block of samples read from a wavetable with interpolation.
+ * @tparam Size The size of the wavetable.
+ * @tparam Cubic `true` to use cubic (Catmull-Rom) interpolation, `false` to use linear
+ * interpolation.
+ * @param table The wavetable of the waveform.
+ * @details The other parameters and the return value are the same as `render_sine`. Each sample
+ * costs a lookup and an interpolation regardless of the waveform. `Size` is a power of 2, so the
+ * upper bits of the phase are the index in the table and the lower bits are the position between
+ * the points, without any conversion or reduction.
+ */
+template <unsigned int Size, bool Cubic>
+Phase render_wavetable(const Wavetable<Size> &table, float *output, unsigned int frames_count,
+                       Phase phase, Phase phase_delta, float amplitude) {
+  static_assert((Size & (Size - 1)) == 0, "The size must be a power of 2.");
+  constexpr Phase FRACTION_MASK = ~Phase{0} / Size;  // The bits below the index.
+  constexpr double FRACTION_SCALE = 1.0 / (static_cast<double>(FRACTION_MASK) + 1.0);
+
+  for (unsigned int i = 0; i < frames_count; ++i, phase += phase_delta) {
+    // `samples[index]` to `samples[index + 3]` are the points -1 to 2 around the position.
+    const auto index = static_cast<unsigned int>(phase / (FRACTION_MASK + 1));
+    const auto t = static_cast<float>(static_cast<double>(phase & FRACTION_MASK) * FRACTION_SCALE);
+    const float *p = table.samples + index;
+    float value;
+    if constexpr (Cubic) {
+      value = p[1] + 0.5f * t *
+                         (p[2] - p[0] +
+                          t * (2 * p[0] - 5 * p[1] + 4 * p[2] - p[3] +
+                               t * (3 * (p[1] - p[2]) + p[3] - p[0])));
+    } else {
+      value = p[1] + t * (p[2] - p[1]);
+    }
+    output[i] = amplitude * value;
+  }
+
+  return phase;
+}
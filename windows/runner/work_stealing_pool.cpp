@@ -0,0 +1,125 @@
+/**
+ * @file work_stealing_pool.cpp
+ * @brief `WorkStealingPool` class implementation.
+ */
+
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+WorkStealingPool::WorkStealingPool(unsigned int threads_count)
+    : m_threads_count(threads_count != 0 ? threads_count
+                                         : std::max(std::thread::hardware_concurrency(), 1u)) {
+  m_queues = std::make_unique<Queue[]>(m_threads_count);
+  for (unsigned int i = 1; i < m_threads_count; ++i) {
+    m_threads.emplace_back(&WorkStealingPool::thread_main, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_batch_started.notify_all();
+  for (std::thread &thread : m_threads) {
+    thread.join();
+  }
+}
+
+bool WorkStealingPool::take_job(unsigned int thread, std::size_t &job) {
+  {
+    Queue &queue = m_queues[thread];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.jobs.empty()) {
+      job = queue.jobs.front();
+      queue.jobs.pop_front();
+      return true;
+    }
+  }
+
+  // Steal from the other threads, starting from the next one, so that the thieves spread over
+  // the victims.
+  for (unsigned int i = 1; i < m_threads_count; ++i) {
+    Queue &queue = m_queues[(thread + i) % m_threads_count];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.jobs.empty()) {
+      job = queue.jobs.back();
+      queue.jobs.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::run_jobs(unsigned int thread) {
+  std::size_t job;
+  while (take_job(thread, job)) {
+    try {
+      (*m_function)(job, thread);
+    } catch (...) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error) {
+          m_error = std::current_exception();
+        }
+      }
+      // Skip the jobs that have not started.
+      for (unsigned int i = 0; i < m_threads_count; ++i) {
+        std::lock_guard<std::mutex> lock(m_queues[i].mutex);
+        m_queues[i].jobs.clear();
+      }
+    }
+  }
+}
+
+void WorkStealingPool::thread_main(unsigned int thread) {
+  std::uint64_t batch = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_batch_started.wait(lock, [&] { return m_stopping || m_batch != batch; });
+      if (m_stopping) {
+        return;
+      }
+      batch = m_batch;
+    }
+
+    run_jobs(thread);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_running_threads == 0) {
+      m_batch_finished.notify_one();
+    }
+  }
+}
+
+void WorkStealingPool::run(std::size_t jobs_count, const Function &function) {
+  for (std::size_t job = 0; job < jobs_count; ++job) {
+    Queue &queue = m_queues[job % m_threads_count];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs.push_back(job);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_function = &function;
+    m_error = nullptr;
+    m_running_threads = m_threads_count - 1;
+    ++m_batch;
+  }
+  m_batch_started.notify_all();
+  run_jobs(0);
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_batch_finished.wait(lock, [this] { return m_running_threads == 0; });
+    m_function = nullptr;
+    error = std::exchange(m_error, nullptr);
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
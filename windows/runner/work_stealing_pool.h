@@ -0,0 +1,105 @@
+/**
+ * @file work_stealing_pool.h
+ * @brief `WorkStealingPool` class declaration.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A pool of threads that run batches of independent jobs.
+ * @details The jobs of a batch are dealt to a queue per thread in order. Each thread runs the
+ * jobs from the front of its own queue, and when the queue is empty, it steals a job from the
+ * back of the queue of another thread. The queues are locked separately, so the threads contend
+ * only while stealing. The threads are created once and wait for the next batch between the
+ * batches. The thread that calls `run` works as the thread 0. This class does not depend on the
+ * Windows API.
+ */
+class WorkStealingPool {
+ private:
+  /**
+   * @brief The queue of the jobs of a thread.
+   */
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::size_t> jobs;
+  };
+
+  using Function = std::function<void(std::size_t job, unsigned int thread)>;
+
+  std::vector<std::thread> m_threads;      // Threads 1 and later. The thread 0 is the caller.
+  std::unique_ptr<Queue[]> m_queues;       // Queues of the threads, indexed by the thread.
+  unsigned int m_threads_count;            // Number of threads including the caller.
+
+  // State of the batch, guarded by `m_mutex`.
+  std::mutex m_mutex;
+  std::condition_variable m_batch_started;   // Notified when a batch starts or the pool stops.
+  std::condition_variable m_batch_finished;  // Notified when the last thread finishes a batch.
+  const Function *m_function = nullptr;      // Function of the jobs of the current batch.
+  std::uint64_t m_batch = 0;                 // Number of the batches started.
+  unsigned int m_running_threads = 0;        // Threads 1 and later still running the batch.
+  std::exception_ptr m_error;                // First exception thrown by the jobs of the batch.
+  bool m_stopping = false;                   // `true` when the pool is destroyed.
+
+  /**
+   * @brief Takes the next job of a thread from its own queue, or steals one.
+   * @param thread The index of the thread.
+   * @param job The job taken.
+   * @return `false` if all queues are empty.
+   */
+  bool take_job(unsigned int thread, std::size_t &job);
+
+  /**
+   * @brief Runs the jobs until all queues are empty.
+   * @param thread The index of the thread.
+   */
+  void run_jobs(unsigned int thread);
+
+  /**
+   * @brief Function of the threads 1 and later.
+   */
+  void thread_main(unsigned int thread);
+
+ public:
+  /**
+   * @brief Construct a new `WorkStealingPool` object.
+   * @param threads_count The number of threads including the caller of `run`. 0 uses one thread
+   * per core.
+   */
+  explicit WorkStealingPool(unsigned int threads_count = 0);
+
+  /**
+   * @brief Destroy the `WorkStealingPool` object. The threads are stopped and joined.
+   */
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  /**
+   * @brief Returns the number of threads including the caller of `run`.
+   */
+  unsigned int threads_count() const { return m_threads_count; }
+
+  /**
+   * @brief Runs a batch of jobs and waits for them.
+   * @param jobs_count The number of jobs. The jobs are numbered from 0.
+   * @param function The function called for each job with the number of the job and the index of
+   * the thread (less than `threads_count()`), which can be used to reuse a buffer per thread.
+   * @exception The first exception thrown by `function` is rethrown after the batch. The jobs
+   * that have not started are skipped.
+   * @details The jobs are dealt to the threads round-robin, so if they are sorted from the
+   * longest, each thread starts with one of the longest jobs. Must not be called concurrently.
+   */
+  void run(std::size_t jobs_count, const Function &function);
+};